@@ -0,0 +1,957 @@
+/**
+ * В файле 44_kahan_summation.c мы познакомились с суммированием Кэхэна
+ * на примере гармонического ряда: члены ряда складывались по одному,
+ * а младшие разряды сохранялись в специальной переменной.
+ * Если членов ряда сотни миллионов, то важна не только точность, но и
+ * скорость суммирования. Современные процессоры умеют выполнять одну
+ * операцию сразу над несколькими числами - это SIMD инструкции
+ * (Single Instruction Multiple Data): SSE работает с 4-мя float или
+ * 2-мя double одновременно, AVX - с 8-ю float или 4-мя double.
+ *
+ * Рассмотрим пять алгоритмов суммирования массивов float и double:
+ * 1) наивное суммирование;
+ * 2) суммирование Кэхэна;
+ * 3) суммирование Ноймайера (улучшенный вариант Кэхэна);
+ * 4) попарное (каскадное) суммирование;
+ * 5) точное суммирование с помощью суперсумматора.
+ * Для первых четырёх напишем простой скалярный вариант и вариант,
+ * в котором каждая "полоса" (lane) SIMD регистра хранит свою частичную
+ * сумму и свою поправку, а в конце полосы объединяются в одну сумму.
+ *
+ * Компиляция:
+ * gcc 46_summation_algorithms.c -o summation -std=c99 -O2 -mavx2
+ * Без ключа -mavx2 будут использованы инструкции SSE2 (на x86-64 они есть всегда).
+ * Внимание! Нельзя использовать ключ -ffast-math: он разрешает компилятору
+ * считать сложение ассоциативным и "упростить" поправку Кэхэна до нуля.
+ * */
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h> //size_t
+#include <stdlib.h> //malloc free
+#include <math.h>   //fabs fabsf fabsl ldexp ldexpl
+#include <time.h>   //clock
+
+#if defined(__SSE2__)
+#include <immintrin.h> //заголовок со встроенными функциями (intrinsics) для SSE и AVX
+#endif
+
+/**
+ * Способы суммирования, которые мы будем выбирать при вызове
+ * универсальных функций float_sum и double_sum.
+ * */
+typedef enum {
+    SUM_NAIVE,
+    SUM_KAHAN,
+    SUM_NEUMAIER,
+    SUM_PAIRWISE,
+    SUM_EXACT
+} summation_mode_t;
+
+/**
+ * Скалярные алгоритмы: по одному слагаемому за шаг.
+ * */
+
+float float_naive_sum(float const *arr, size_t size) {
+    float s = 0.f;
+    for (size_t idx = 0; idx != size; ++idx)
+        s += arr[idx];
+    return s;
+}
+
+//тот же алгоритм, что и в kahan_summation_harmonic_series_test, но для массива
+float float_kahan_sum(float const *arr, size_t size) {
+    float s = 0.f, r = 0.f; //r - младшие разряды, не попавшие в сумму
+    for (size_t idx = 0; idx != size; ++idx) {
+        float y = arr[idx] - r;
+        float t = s + y;
+        r = (t - s) - y;
+        s = t;
+    }
+    return s;
+}
+
+/**
+ * Алгоритм Кэхэна теряет точность, если очередное слагаемое больше
+ * накопленной суммы: тогда теряются младшие разряды суммы, а не слагаемого.
+ * Ноймайер предложил проверять, какое из двух чисел больше по модулю,
+ * и сохранять младшие разряды именно меньшего из них.
+ * Поправка c в этом варианте прибавляется к сумме только в самом конце.
+ * Обратите внимание: сама поправка накапливается наивно, потому при очень
+ * большом количестве слагаемых в типе float она тоже начинает терять разряды,
+ * тогда как Кэхэн возвращает потерянные разряды в сумму на каждом шаге.
+ * */
+float float_neumaier_sum(float const *arr, size_t size) {
+    float s = 0.f, c = 0.f;
+    for (size_t idx = 0; idx != size; ++idx) {
+        float t = s + arr[idx];
+        if (fabsf(s) >= fabsf(arr[idx]))
+            c += (s - t) + arr[idx]; //потерялись младшие разряды arr[idx]
+        else
+            c += (arr[idx] - t) + s; //потерялись младшие разряды s
+        s = t;
+    }
+    return s + c;
+}
+
+/**
+ * Попарное суммирование: делим массив пополам, суммируем каждую половину
+ * (рекурсивно) и складываем результаты. Ошибка растёт как O(log N), а не O(N),
+ * как в наивном алгоритме. Небольшие куски суммируем наивно, чтобы не тратить
+ * время на рекурсивные вызовы.
+ * */
+#define PAIRWISE_BLOCK 128u
+
+float float_pairwise_sum(float const *arr, size_t size) {
+    if (size <= PAIRWISE_BLOCK)
+        return float_naive_sum(arr,size);
+    size_t half = size / 2;
+    return float_pairwise_sum(arr,half) + float_pairwise_sum(arr + half,size - half);
+}
+
+double double_naive_sum(double const *arr, size_t size) {
+    double s = 0.;
+    for (size_t idx = 0; idx != size; ++idx)
+        s += arr[idx];
+    return s;
+}
+
+double double_kahan_sum(double const *arr, size_t size) {
+    double s = 0., r = 0.;
+    for (size_t idx = 0; idx != size; ++idx) {
+        double y = arr[idx] - r;
+        double t = s + y;
+        r = (t - s) - y;
+        s = t;
+    }
+    return s;
+}
+
+double double_neumaier_sum(double const *arr, size_t size) {
+    double s = 0., c = 0.;
+    for (size_t idx = 0; idx != size; ++idx) {
+        double t = s + arr[idx];
+        if (fabs(s) >= fabs(arr[idx]))
+            c += (s - t) + arr[idx];
+        else
+            c += (arr[idx] - t) + s;
+        s = t;
+    }
+    return s + c;
+}
+
+double double_pairwise_sum(double const *arr, size_t size) {
+    if (size <= PAIRWISE_BLOCK)
+        return double_naive_sum(arr,size);
+    size_t half = size / 2;
+    return double_pairwise_sum(arr,half) + double_pairwise_sum(arr + half,size - half);
+}
+
+/**
+ * Тип long double на x86 хранит 64 бита мантиссы вместо 53.
+ * Векторных инструкций для него нет, потому ограничимся скалярными вариантами.
+ * */
+long double long_double_naive_sum(long double const *arr, size_t size) {
+    long double s = 0.L;
+    for (size_t idx = 0; idx != size; ++idx)
+        s += arr[idx];
+    return s;
+}
+
+long double long_double_kahan_sum(long double const *arr, size_t size) {
+    long double s = 0.L, r = 0.L;
+    for (size_t idx = 0; idx != size; ++idx) {
+        long double y = arr[idx] - r;
+        long double t = s + y;
+        r = (t - s) - y;
+        s = t;
+    }
+    return s;
+}
+
+long double long_double_neumaier_sum(long double const *arr, size_t size) {
+    long double s = 0.L, c = 0.L;
+    for (size_t idx = 0; idx != size; ++idx) {
+        long double t = s + arr[idx];
+        if (fabsl(s) >= fabsl(arr[idx]))
+            c += (s - t) + arr[idx];
+        else
+            c += (arr[idx] - t) + s;
+        s = t;
+    }
+    return s + c;
+}
+
+long double long_double_pairwise_sum(long double const *arr, size_t size) {
+    if (size <= PAIRWISE_BLOCK)
+        return long_double_naive_sum(arr,size);
+    size_t half = size / 2;
+    return long_double_pairwise_sum(arr,half) + long_double_pairwise_sum(arr + half,size - half);
+}
+
+/**
+ * Векторные алгоритмы.
+ * Чтобы не писать каждый алгоритм отдельно для AVX, SSE и обычных
+ * скалярных операций, введём тип "вектор из нескольких float" floatv_t
+ * и несколько маленьких функций для работы с ним. В зависимости от того,
+ * какие инструкции разрешены при компиляции, эти функции реализуются
+ * по-разному, а сами алгоритмы суммирования остаются одинаковыми.
+ * Ключевое слово inline подсказывает компилятору, что вызов функции
+ * лучше заменить её телом.
+ * */
+#if defined(__AVX__)
+
+typedef __m256 floatv_t;
+typedef __m256d doublev_t;
+#define FLOATV_LANES 8u
+#define DOUBLEV_LANES 4u
+
+static inline floatv_t floatv_zero(void) { return _mm256_setzero_ps(); }
+static inline floatv_t floatv_load(float const *p) { return _mm256_loadu_ps(p); }
+static inline void floatv_store(float *p, floatv_t v) { _mm256_storeu_ps(p,v); }
+static inline floatv_t floatv_add(floatv_t a, floatv_t b) { return _mm256_add_ps(a,b); }
+static inline floatv_t floatv_sub(floatv_t a, floatv_t b) { return _mm256_sub_ps(a,b); }
+static inline floatv_t floatv_abs(floatv_t a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.f),a); } //сбрасываем знаковый бит
+//покомпонентно a >= b ? x : y
+static inline floatv_t floatv_select_ge(floatv_t a, floatv_t b, floatv_t x, floatv_t y) {
+    return _mm256_blendv_ps(y,x,_mm256_cmp_ps(a,b,_CMP_GE_OQ));
+}
+
+static inline doublev_t doublev_zero(void) { return _mm256_setzero_pd(); }
+static inline doublev_t doublev_load(double const *p) { return _mm256_loadu_pd(p); }
+static inline void doublev_store(double *p, doublev_t v) { _mm256_storeu_pd(p,v); }
+static inline doublev_t doublev_add(doublev_t a, doublev_t b) { return _mm256_add_pd(a,b); }
+static inline doublev_t doublev_sub(doublev_t a, doublev_t b) { return _mm256_sub_pd(a,b); }
+static inline doublev_t doublev_abs(doublev_t a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.),a); }
+static inline doublev_t doublev_select_ge(doublev_t a, doublev_t b, doublev_t x, doublev_t y) {
+    return _mm256_blendv_pd(y,x,_mm256_cmp_pd(a,b,_CMP_GE_OQ));
+}
+
+#elif defined(__SSE2__)
+
+typedef __m128 floatv_t;
+typedef __m128d doublev_t;
+#define FLOATV_LANES 4u
+#define DOUBLEV_LANES 2u
+
+static inline floatv_t floatv_zero(void) { return _mm_setzero_ps(); }
+static inline floatv_t floatv_load(float const *p) { return _mm_loadu_ps(p); }
+static inline void floatv_store(float *p, floatv_t v) { _mm_storeu_ps(p,v); }
+static inline floatv_t floatv_add(floatv_t a, floatv_t b) { return _mm_add_ps(a,b); }
+static inline floatv_t floatv_sub(floatv_t a, floatv_t b) { return _mm_sub_ps(a,b); }
+static inline floatv_t floatv_abs(floatv_t a) { return _mm_andnot_ps(_mm_set1_ps(-0.f),a); }
+//в SSE2 нет инструкции blend, потому выбираем через битовые маски: (m & x) | (~m & y)
+static inline floatv_t floatv_select_ge(floatv_t a, floatv_t b, floatv_t x, floatv_t y) {
+    floatv_t m = _mm_cmpge_ps(a,b);
+    return _mm_or_ps(_mm_and_ps(m,x),_mm_andnot_ps(m,y));
+}
+
+static inline doublev_t doublev_zero(void) { return _mm_setzero_pd(); }
+static inline doublev_t doublev_load(double const *p) { return _mm_loadu_pd(p); }
+static inline void doublev_store(double *p, doublev_t v) { _mm_storeu_pd(p,v); }
+static inline doublev_t doublev_add(doublev_t a, doublev_t b) { return _mm_add_pd(a,b); }
+static inline doublev_t doublev_sub(doublev_t a, doublev_t b) { return _mm_sub_pd(a,b); }
+static inline doublev_t doublev_abs(doublev_t a) { return _mm_andnot_pd(_mm_set1_pd(-0.),a); }
+static inline doublev_t doublev_select_ge(doublev_t a, doublev_t b, doublev_t x, doublev_t y) {
+    doublev_t m = _mm_cmpge_pd(a,b);
+    return _mm_or_pd(_mm_and_pd(m,x),_mm_andnot_pd(m,y));
+}
+
+#else //нет векторных инструкций - "вектор" из одного числа
+
+typedef float floatv_t;
+typedef double doublev_t;
+#define FLOATV_LANES 1u
+#define DOUBLEV_LANES 1u
+
+static inline floatv_t floatv_zero(void) { return 0.f; }
+static inline floatv_t floatv_load(float const *p) { return *p; }
+static inline void floatv_store(float *p, floatv_t v) { *p = v; }
+static inline floatv_t floatv_add(floatv_t a, floatv_t b) { return a + b; }
+static inline floatv_t floatv_sub(floatv_t a, floatv_t b) { return a - b; }
+static inline floatv_t floatv_abs(floatv_t a) { return fabsf(a); }
+static inline floatv_t floatv_select_ge(floatv_t a, floatv_t b, floatv_t x, floatv_t y) { return a >= b ? x : y; }
+
+static inline doublev_t doublev_zero(void) { return 0.; }
+static inline doublev_t doublev_load(double const *p) { return *p; }
+static inline void doublev_store(double *p, doublev_t v) { *p = v; }
+static inline doublev_t doublev_add(doublev_t a, doublev_t b) { return a + b; }
+static inline doublev_t doublev_sub(doublev_t a, doublev_t b) { return a - b; }
+static inline doublev_t doublev_abs(doublev_t a) { return fabs(a); }
+static inline doublev_t doublev_select_ge(doublev_t a, doublev_t b, doublev_t x, doublev_t y) { return a >= b ? x : y; }
+
+#endif
+
+/**
+ * Объединение полос.
+ * После векторного цикла у нас есть FLOATV_LANES частичных сумм s,
+ * столько же поправок c и несколько "хвостовых" элементов массива,
+ * которые не поместились в целый вектор. Сложим всё это скалярным
+ * алгоритмом Ноймайера - элементов немного, а точность сохранится.
+ * Поправки Кэхэна хранят потерянные разряды с обратным знаком,
+ * потому для них передаётся c_sign = -1.
+ * */
+static float float_lanes_merge(floatv_t s, floatv_t c, float c_sign, float const *tail, size_t tail_size) {
+    float s_lanes[FLOATV_LANES], c_lanes[FLOATV_LANES];
+    floatv_store(s_lanes,s);
+    floatv_store(c_lanes,c);
+
+    float parts[3*FLOATV_LANES]; //tail_size всегда меньше FLOATV_LANES
+    size_t count = 0;
+    for (size_t lane = 0; lane != FLOATV_LANES; ++lane) {
+        parts[count++] = s_lanes[lane];
+        parts[count++] = c_sign * c_lanes[lane];
+    }
+    for (size_t idx = 0; idx != tail_size; ++idx)
+        parts[count++] = tail[idx];
+    return float_neumaier_sum(parts,count);
+}
+
+static double double_lanes_merge(doublev_t s, doublev_t c, double c_sign, double const *tail, size_t tail_size) {
+    double s_lanes[DOUBLEV_LANES], c_lanes[DOUBLEV_LANES];
+    doublev_store(s_lanes,s);
+    doublev_store(c_lanes,c);
+
+    double parts[3*DOUBLEV_LANES];
+    size_t count = 0;
+    for (size_t lane = 0; lane != DOUBLEV_LANES; ++lane) {
+        parts[count++] = s_lanes[lane];
+        parts[count++] = c_sign * c_lanes[lane];
+    }
+    for (size_t idx = 0; idx != tail_size; ++idx)
+        parts[count++] = tail[idx];
+    return double_neumaier_sum(parts,count);
+}
+
+/**
+ * Каждая полоса суммирует свои элементы: полоса 0 - элементы 0, 8, 16...,
+ * полоса 1 - элементы 1, 9, 17... (для AVX и float).
+ * */
+float float_naive_sum_simd(float const *arr, size_t size) {
+    floatv_t s = floatv_zero();
+    size_t idx = 0;
+    for (; idx + FLOATV_LANES <= size; idx += FLOATV_LANES)
+        s = floatv_add(s,floatv_load(arr + idx));
+    return float_lanes_merge(s,floatv_zero(),0.f,arr + idx,size - idx);
+}
+
+//в каждой полосе выполняется ровно тот же алгоритм Кэхэна, что и в скалярном варианте
+float float_kahan_sum_simd(float const *arr, size_t size) {
+    floatv_t s = floatv_zero(), r = floatv_zero();
+    size_t idx = 0;
+    for (; idx + FLOATV_LANES <= size; idx += FLOATV_LANES) {
+        floatv_t y = floatv_sub(floatv_load(arr + idx),r);
+        floatv_t t = floatv_add(s,y);
+        r = floatv_sub(floatv_sub(t,s),y);
+        s = t;
+    }
+    return float_lanes_merge(s,r,-1.f,arr + idx,size - idx);
+}
+
+//условие if из скалярного алгоритма заменяется покомпонентным выбором, без ветвлений
+float float_neumaier_sum_simd(float const *arr, size_t size) {
+    floatv_t s = floatv_zero(), c = floatv_zero();
+    size_t idx = 0;
+    for (; idx + FLOATV_LANES <= size; idx += FLOATV_LANES) {
+        floatv_t x = floatv_load(arr + idx);
+        floatv_t t = floatv_add(s,x);
+        floatv_t lost_x = floatv_add(floatv_sub(s,t),x);
+        floatv_t lost_s = floatv_add(floatv_sub(x,t),s);
+        c = floatv_add(c,floatv_select_ge(floatv_abs(s),floatv_abs(x),lost_x,lost_s));
+        s = t;
+    }
+    return float_lanes_merge(s,c,1.f,arr + idx,size - idx);
+}
+
+/**
+ * Для векторного попарного суммирования базовый блок можно взять больше:
+ * внутри блока каждая полоса складывает лишь PAIRWISE_SIMD_BLOCK / FLOATV_LANES чисел.
+ * */
+#define PAIRWISE_SIMD_BLOCK 1024u
+
+float float_pairwise_sum_simd(float const *arr, size_t size) {
+    if (size <= PAIRWISE_SIMD_BLOCK)
+        return float_naive_sum_simd(arr,size);
+    size_t half = size / 2;
+    return float_pairwise_sum_simd(arr,half) + float_pairwise_sum_simd(arr + half,size - half);
+}
+
+double double_naive_sum_simd(double const *arr, size_t size) {
+    doublev_t s = doublev_zero();
+    size_t idx = 0;
+    for (; idx + DOUBLEV_LANES <= size; idx += DOUBLEV_LANES)
+        s = doublev_add(s,doublev_load(arr + idx));
+    return double_lanes_merge(s,doublev_zero(),0.,arr + idx,size - idx);
+}
+
+double double_kahan_sum_simd(double const *arr, size_t size) {
+    doublev_t s = doublev_zero(), r = doublev_zero();
+    size_t idx = 0;
+    for (; idx + DOUBLEV_LANES <= size; idx += DOUBLEV_LANES) {
+        doublev_t y = doublev_sub(doublev_load(arr + idx),r);
+        doublev_t t = doublev_add(s,y);
+        r = doublev_sub(doublev_sub(t,s),y);
+        s = t;
+    }
+    return double_lanes_merge(s,r,-1.,arr + idx,size - idx);
+}
+
+double double_neumaier_sum_simd(double const *arr, size_t size) {
+    doublev_t s = doublev_zero(), c = doublev_zero();
+    size_t idx = 0;
+    for (; idx + DOUBLEV_LANES <= size; idx += DOUBLEV_LANES) {
+        doublev_t x = doublev_load(arr + idx);
+        doublev_t t = doublev_add(s,x);
+        doublev_t lost_x = doublev_add(doublev_sub(s,t),x);
+        doublev_t lost_s = doublev_add(doublev_sub(x,t),s);
+        c = doublev_add(c,doublev_select_ge(doublev_abs(s),doublev_abs(x),lost_x,lost_s));
+        s = t;
+    }
+    return double_lanes_merge(s,c,1.,arr + idx,size - idx);
+}
+
+double double_pairwise_sum_simd(double const *arr, size_t size) {
+    if (size <= PAIRWISE_SIMD_BLOCK)
+        return double_naive_sum_simd(arr,size);
+    size_t half = size / 2;
+    return double_pairwise_sum_simd(arr,half) + double_pairwise_sum_simd(arr + half,size - half);
+}
+
+/**
+ * Точное суммирование.
+ * Все алгоритмы выше зависят от порядка слагаемых: если переставить элементы
+ * массива или разделить массив между потоками иначе, результат может
+ * измениться в последних разрядах. Избавиться от этого можно, если
+ * суммировать точно, без округлений, а округлить только итоговую сумму.
+ *
+ * Любое конечное число double - это целое число m (не более 53 бит),
+ * умноженное на 2^e, где e от -1074 до 971. Значит, все double можно
+ * представить как целые числа в единицах 2^-1074, если взять "длинное"
+ * целое примерно из 2100 бит. Такое число называется суперсумматором
+ * (superaccumulator). Сложение целых чисел ассоциативно, потому итог не
+ * зависит ни от порядка слагаемых, ни от количества потоков.
+ *
+ * Длинное число хранится в "цифрах" (limbs) по 32 бита, но каждая цифра
+ * лежит в 64-битной знаковой переменной. Свободные старшие биты позволяют
+ * не переносить разряды после каждого сложения: перенос (нормализация)
+ * выполняется один раз на SUPERACC_NORMALIZE_PERIOD слагаемых.
+ * */
+#include <stdint.h> //int64_t uint64_t
+#include <string.h> //memcpy memset
+
+#define SUPERACC_BIAS 1088          //бит с номером SUPERACC_BIAS соответствует 2^0; 1088 - кратное 32 число, не меньшее 1074
+#define SUPERACC_LIMBS 70           //(1088 + 1024) / 32 = 66 цифр и запас для переносов
+#define SUPERACC_NORMALIZE_PERIOD (1u << 29)
+
+typedef struct {
+    int64_t limb[SUPERACC_LIMBS];
+    unsigned pending;                     //количество сложений с последней нормализации
+    bool has_nan, has_pos_inf, has_neg_inf;
+} superaccumulator_t;
+
+void superacc_init(superaccumulator_t *acc) {
+    memset(acc,0,sizeof(superaccumulator_t));
+}
+
+//перенос разрядов: после нормализации все цифры, кроме старшей, лежат в [0, 2^32)
+static void superacc_normalize(superaccumulator_t *acc) {
+    for (unsigned idx = 0; idx + 1 != SUPERACC_LIMBS; ++idx) {
+        int64_t low = (int64_t)((uint64_t)acc->limb[idx] & 0xffffffffu);
+        acc->limb[idx + 1] += (acc->limb[idx] - low) / 4294967296; //деление нацело точное
+        acc->limb[idx] = low;
+    }
+    acc->pending = 0;
+}
+
+void superacc_add(superaccumulator_t *acc, double x) {
+    uint64_t bits;
+    memcpy(&bits,&x,sizeof(double)); //разбираем число на знак, порядок и мантиссу
+    bool negative = bits >> 63;
+    unsigned exp_field = (bits >> 52) & 0x7ffu;
+    uint64_t m = bits & ((1ull << 52) - 1);
+
+    if (0x7ffu == exp_field) { //бесконечность или NaN
+        if (0 != m) acc->has_nan = true;
+        else if (negative) acc->has_neg_inf = true;
+        else acc->has_pos_inf = true;
+        return;
+    }
+    if (0 != exp_field) m |= 1ull << 52; //неявная единица нормализованного числа
+    else exp_field = 1;                   //субнормальное число
+    if (0 == m) return;
+
+    unsigned pos = exp_field - 1075 + SUPERACC_BIAS; //номер младшего бита m в суперсумматоре
+    unsigned idx = pos / 32, shift = pos % 32;
+    //m << shift занимает не более 85 бит - три цифры
+    int64_t lo = (int64_t)((m << shift) & 0xffffffffu);
+    int64_t mid = (int64_t)((m << shift) >> 32);
+    int64_t hi = 0 == shift ? 0 : (int64_t)(m >> (64 - shift));
+    if (negative) {
+        acc->limb[idx] -= lo;
+        acc->limb[idx + 1] -= mid;
+        acc->limb[idx + 2] -= hi;
+    } else {
+        acc->limb[idx] += lo;
+        acc->limb[idx + 1] += mid;
+        acc->limb[idx + 2] += hi;
+    }
+    if (++acc->pending == SUPERACC_NORMALIZE_PERIOD)
+        superacc_normalize(acc);
+}
+
+/**
+ * Объединение двух суперсумматоров, например, посчитанных разными потоками.
+ * Результат dst + src не зависит от того, в каком порядке объединять части.
+ * */
+void superacc_merge(superaccumulator_t *dst, superaccumulator_t const *src) {
+    superaccumulator_t tmp = *src;
+    superacc_normalize(&tmp);
+    superacc_normalize(dst);
+    for (unsigned idx = 0; idx != SUPERACC_LIMBS; ++idx)
+        dst->limb[idx] += tmp.limb[idx];
+    dst->pending = 1;
+    dst->has_nan |= tmp.has_nan;
+    dst->has_pos_inf |= tmp.has_pos_inf;
+    dst->has_neg_inf |= tmp.has_neg_inf;
+}
+
+static unsigned superacc_bit(superaccumulator_t const *acc, int pos) {
+    return (unsigned)(((uint64_t)acc->limb[pos / 32] >> (pos % 32)) & 1u);
+}
+
+/**
+ * Округление длинного числа к ближайшему числу из mant_bits значащих бит,
+ * при равенстве - к чётному (так же округляет сам процессор).
+ * min_exp - порядок младшего бита самого маленького субнормального числа:
+ * -1074 для double, -149 для float.
+ * Результат возвращается как long double: в нём помещаются все 64 бита
+ * мантиссы long double, а для float и double преобразование точное.
+ * */
+static long double superacc_round(superaccumulator_t const *src, unsigned mant_bits, int min_exp) {
+    if (src->has_nan || (src->has_pos_inf && src->has_neg_inf)) return NAN;
+    if (src->has_pos_inf) return INFINITY;
+    if (src->has_neg_inf) return -INFINITY;
+
+    superaccumulator_t acc = *src;
+    superacc_normalize(&acc);
+    bool negative = acc.limb[SUPERACC_LIMBS - 1] < 0;
+    if (negative) { //работаем с модулем числа
+        for (unsigned idx = 0; idx != SUPERACC_LIMBS; ++idx)
+            acc.limb[idx] = -acc.limb[idx];
+        superacc_normalize(&acc);
+    }
+
+    int top = SUPERACC_LIMBS - 1;
+    while (top >= 0 && 0 == acc.limb[top]) --top;
+    if (top < 0) return 0.;
+
+    int msb = top * 32; //номер старшего ненулевого бита
+    while ((uint64_t)acc.limb[top] >> (msb - top * 32 + 1)) ++msb;
+
+    int lsb = msb - (int)(mant_bits - 1); //номер младшего бита, который попадёт в результат
+    if (lsb < min_exp + SUPERACC_BIAS) lsb = min_exp + SUPERACC_BIAS;
+
+    uint64_t mantissa = 0;
+    for (int pos = msb; pos >= lsb; --pos)
+        mantissa = mantissa << 1 | superacc_bit(&acc,pos);
+    bool guard = lsb > 0 && superacc_bit(&acc,lsb - 1), sticky = false; //первый отброшенный бит и "есть ли ещё что-то ниже"
+    for (int pos = lsb - 2; pos >= 0 && !sticky; --pos)
+        sticky = superacc_bit(&acc,pos);
+    //для 64-битной мантиссы ++mantissa могло бы переполниться, потому прибавляем единицу уже в long double
+    long double rounded = (long double)mantissa + (guard && (sticky || (mantissa & 1u)) ? 1.L : 0.L);
+
+    long double res = ldexpl(rounded,lsb - SUPERACC_BIAS); //rounded * 2^(lsb - BIAS), переполнение даёт бесконечность при приведении типа
+    return negative ? -res : res;
+}
+
+double superacc_double(superaccumulator_t const *acc) {
+    return (double)superacc_round(acc,53,-1074);
+}
+
+//округляем сразу до 24 бит: округление сначала до double, а потом до float могло бы дать другой результат
+float superacc_float(superaccumulator_t const *acc) {
+    return (float)superacc_round(acc,24,-149);
+}
+
+/**
+ * Число long double (80 бит на x86) раскладывается в сумму двух double без потерь:
+ * hi - первые 53 бита мантиссы, lo - оставшиеся 11. Это верно, пока порядок числа
+ * не выходит за пределы double - для сумм рядов этого достаточно.
+ * */
+void superacc_add_long_double(superaccumulator_t *acc, long double x) {
+    double hi = (double)x;
+    superacc_add(acc,hi);
+    superacc_add(acc,(double)(x - hi));
+}
+
+//64 бита мантиссы; младший бит суперсумматора соответствует 2^-1088
+long double superacc_long_double(superaccumulator_t const *acc) {
+    return superacc_round(acc,64,-SUPERACC_BIAS);
+}
+
+double double_exact_sum(double const *arr, size_t size) {
+    superaccumulator_t acc;
+    superacc_init(&acc);
+    for (size_t idx = 0; idx != size; ++idx)
+        superacc_add(&acc,arr[idx]);
+    return superacc_double(&acc);
+}
+
+float float_exact_sum(float const *arr, size_t size) {
+    superaccumulator_t acc;
+    superacc_init(&acc);
+    for (size_t idx = 0; idx != size; ++idx)
+        superacc_add(&acc,arr[idx]); //преобразование float в double точное
+    return superacc_float(&acc);
+}
+
+/**
+ * Универсальные функции: выбор алгоритма по параметру mode.
+ * Используются векторные варианты, т.к. они дают ту же точность быстрее.
+ * Точный режим SUM_EXACT не зависит от порядка слагаемых.
+ * */
+float float_sum(float const *arr, size_t size, summation_mode_t mode) {
+    switch (mode) {
+        case SUM_NAIVE:    return float_naive_sum_simd(arr,size);
+        case SUM_KAHAN:    return float_kahan_sum_simd(arr,size);
+        case SUM_NEUMAIER: return float_neumaier_sum_simd(arr,size);
+        case SUM_PAIRWISE: return float_pairwise_sum_simd(arr,size);
+        case SUM_EXACT:    return float_exact_sum(arr,size);
+    }
+    return 0.f;
+}
+
+double double_sum(double const *arr, size_t size, summation_mode_t mode) {
+    switch (mode) {
+        case SUM_NAIVE:    return double_naive_sum_simd(arr,size);
+        case SUM_KAHAN:    return double_kahan_sum_simd(arr,size);
+        case SUM_NEUMAIER: return double_neumaier_sum_simd(arr,size);
+        case SUM_PAIRWISE: return double_pairwise_sum_simd(arr,size);
+        case SUM_EXACT:    return double_exact_sum(arr,size);
+    }
+    return 0.;
+}
+
+/**
+ * Сравним алгоритмы на гармоническом ряде из 44_kahan_summation.c.
+ * Точное значение посчитаем в типе double алгоритмом Ноймайера -
+ * для ряда из float этого более чем достаточно.
+ * */
+void float_summation_harmonic_series_test() {
+    size_t const size = 100000000u;
+    float *arr = malloc(size * sizeof(float));
+    if (NULL == arr) {
+        printf("Can't allocate memory!\n");
+        return;
+    }
+    double exact = 0., c = 0.;
+    for (size_t idx = 0; idx != size; ++idx) {
+        arr[idx] = 1.f/(idx+1);
+        double t = exact + arr[idx];
+        c += fabs(exact) >= arr[idx] ? (exact - t) + arr[idx] : (arr[idx] - t) + exact;
+        exact = t;
+    }
+    exact += c;
+
+    char const *names[4] = {"naive", "kahan", "neumaier", "pairwise"};
+    float (*scalar[4])(float const*, size_t) = {float_naive_sum, float_kahan_sum, float_neumaier_sum, float_pairwise_sum};
+    float (*simd[4])(float const*, size_t) = {float_naive_sum_simd, float_kahan_sum_simd, float_neumaier_sum_simd, float_pairwise_sum_simd};
+    printf("%u lanes, exact sum %.10f\n",FLOATV_LANES,exact);
+    for (unsigned mode = 0; mode != 4; ++mode) {
+        clock_t start = clock();
+        float res = scalar[mode](arr,size);
+        clock_t middle = clock();
+        float res_simd = simd[mode](arr,size);
+        clock_t finish = clock();
+        printf("%-9s scalar %f (err %e, %.3f s)  simd %f (err %e, %.3f s)\n", names[mode],
+            res, fabs(res - exact)/exact, (double)(middle - start)/CLOCKS_PER_SEC,
+            res_simd, fabs(res_simd - exact)/exact, (double)(finish - middle)/CLOCKS_PER_SEC);
+    }
+
+    free(arr);
+}
+
+void double_summation_test() {
+    //сумма чисел 0.1 ровно 10^7 раз, ожидаем 10^6
+    size_t const size = 10000000u;
+    double *arr = malloc(size * sizeof(double));
+    if (NULL == arr) {
+        printf("Can't allocate memory!\n");
+        return;
+    }
+    for (size_t idx = 0; idx != size; ++idx)
+        arr[idx] = 0.1;
+
+    char const *names[5] = {"naive", "kahan", "neumaier", "pairwise", "exact"};
+    for (unsigned mode = SUM_NAIVE; mode <= SUM_EXACT; ++mode)
+        printf("%-9s %.10f\n",names[mode],double_sum(arr,size,(summation_mode_t)mode));
+
+    free(arr);
+}
+
+/**
+ * Точная сумма не зависит от порядка слагаемых. Проверим это на массиве
+ * случайных чисел с разными знаками и сильно различающимися порядками:
+ * просуммируем его в прямом и обратном порядке, а также по частям,
+ * как это сделали бы несколько потоков, объединив части в разном порядке.
+ * Заодно сравним скорость точного суммирования с наивным и с Кэхэном.
+ * */
+void exact_summation_test() {
+    size_t const size = 10000000u;
+    double *arr = malloc(size * sizeof(double)), *rev = malloc(size * sizeof(double));
+    if (NULL == arr || NULL == rev) {
+        printf("Can't allocate memory!\n");
+        goto CLEAR;
+    }
+    srand(46);
+    for (size_t idx = 0; idx != size; ++idx) {
+        double mantissa = (double)rand() / RAND_MAX - 0.5;
+        arr[idx] = ldexp(mantissa,rand() % 80 - 40);
+    }
+    for (size_t idx = 0; idx != size; ++idx)
+        rev[idx] = arr[size - 1 - idx];
+
+    char const *names[3] = {"naive", "kahan", "exact"};
+    double (*algorithms[3])(double const*, size_t) = {double_naive_sum, double_kahan_sum, double_exact_sum};
+    for (unsigned alg = 0; alg != 3; ++alg) {
+        clock_t start = clock();
+        double forward = algorithms[alg](arr,size);
+        clock_t finish = clock();
+        double backward = algorithms[alg](rev,size);
+        printf("%-6s forward %a backward %a %s, %.2f ns/term\n", names[alg], forward, backward,
+            forward == backward ? "same" : "differ", 1.e9 * (finish - start) / CLOCKS_PER_SEC / size);
+    }
+
+    //четыре "потока" считают свои четверти массива, части объединяются в разном порядке
+    superaccumulator_t parts[4], direct, reverse;
+    for (unsigned part = 0; part != 4; ++part) {
+        superacc_init(parts + part);
+        for (size_t idx = part * (size / 4); idx != (part + 1) * (size / 4); ++idx)
+            superacc_add(parts + part,arr[idx]);
+    }
+    superacc_init(&direct);
+    superacc_init(&reverse);
+    for (unsigned part = 0; part != 4; ++part) {
+        superacc_merge(&direct,parts + part);
+        superacc_merge(&reverse,parts + 3 - part);
+    }
+    printf("merged 0123 %a, merged 3210 %a\n",superacc_double(&direct),superacc_double(&reverse));
+
+    //классический пример: 1e100 + 1 - 1e100 == 1
+    double tricky[3] = {1.e100, 1., -1.e100};
+    printf("1e100 + 1 - 1e100: naive %g, kahan %g, exact %g\n",
+        double_naive_sum(tricky,3), double_kahan_sum(tricky,3), double_exact_sum(tricky,3));
+
+CLEAR:
+    free(rev);
+    free(arr);
+}
+
+/**
+ * Набор тестов производительности: точность и скорость всех алгоритмов
+ * в зависимости от количества слагаемых и типа данных.
+ * Слагаемые - члены гармонического ряда 1/k, записанные в массив нужного типа.
+ * Эталоном служит точная сумма именно этих (уже округлённых) чисел,
+ * посчитанная суперсумматором, т.е. измеряется только ошибка суммирования.
+ *
+ * Результаты записываются в файл в формате CSV (comma separated values) -
+ * такой файл легко открыть в электронной таблице или прочитать программой:
+ * type,algorithm,terms,seconds,ns_per_term,gb_per_s,result,reference,rel_error
+ *
+ * Если слагаемых слишком много, чтобы держать их в памяти (10^10 чисел double -
+ * это 80 ГБ), массив обрабатывается частями по BENCH_CHUNK_BYTES байт.
+ * Суммы частей складываются алгоритмом Кэхэна в long double, потому для
+ * таких размеров ошибка наивного алгоритма соответствует наивному
+ * суммированию внутри каждой части.
+ * */
+#define BENCH_CHUNK_BYTES (128u << 20)
+#define BENCH_MIN_SECONDS 0.02 //короткие замеры повторяются, пока не наберётся хотя бы столько времени
+
+//все алгоритмы приводятся к одной сигнатуре, как qsort в 41_function_pointers.c
+typedef long double (*bench_sum_t)(void const *arr, size_t size);
+
+typedef struct {
+    char const *name;
+    bench_sum_t sum;
+} bench_algorithm_t;
+
+typedef struct {
+    char const *name;
+    size_t element_size;
+    void (*fill)(void *buf, unsigned long long first, size_t count);                  //buf[idx] = 1/(first + idx)
+    void (*exact_add)(superaccumulator_t *acc, void const *buf, size_t count);
+    bench_algorithm_t const *algorithms;
+    unsigned algorithm_count;
+} bench_type_t;
+
+static long double bench_float_naive(void const *arr, size_t size) { return float_naive_sum(arr,size); }
+static long double bench_float_kahan(void const *arr, size_t size) { return float_kahan_sum(arr,size); }
+static long double bench_float_neumaier(void const *arr, size_t size) { return float_neumaier_sum(arr,size); }
+static long double bench_float_pairwise(void const *arr, size_t size) { return float_pairwise_sum(arr,size); }
+static long double bench_float_naive_simd(void const *arr, size_t size) { return float_naive_sum_simd(arr,size); }
+static long double bench_float_kahan_simd(void const *arr, size_t size) { return float_kahan_sum_simd(arr,size); }
+static long double bench_float_neumaier_simd(void const *arr, size_t size) { return float_neumaier_sum_simd(arr,size); }
+static long double bench_float_pairwise_simd(void const *arr, size_t size) { return float_pairwise_sum_simd(arr,size); }
+static long double bench_float_exact(void const *arr, size_t size) { return float_exact_sum(arr,size); }
+
+static long double bench_double_naive(void const *arr, size_t size) { return double_naive_sum(arr,size); }
+static long double bench_double_kahan(void const *arr, size_t size) { return double_kahan_sum(arr,size); }
+static long double bench_double_neumaier(void const *arr, size_t size) { return double_neumaier_sum(arr,size); }
+static long double bench_double_pairwise(void const *arr, size_t size) { return double_pairwise_sum(arr,size); }
+static long double bench_double_naive_simd(void const *arr, size_t size) { return double_naive_sum_simd(arr,size); }
+static long double bench_double_kahan_simd(void const *arr, size_t size) { return double_kahan_sum_simd(arr,size); }
+static long double bench_double_neumaier_simd(void const *arr, size_t size) { return double_neumaier_sum_simd(arr,size); }
+static long double bench_double_pairwise_simd(void const *arr, size_t size) { return double_pairwise_sum_simd(arr,size); }
+static long double bench_double_exact(void const *arr, size_t size) { return double_exact_sum(arr,size); }
+
+static long double bench_long_double_naive(void const *arr, size_t size) { return long_double_naive_sum(arr,size); }
+static long double bench_long_double_kahan(void const *arr, size_t size) { return long_double_kahan_sum(arr,size); }
+static long double bench_long_double_neumaier(void const *arr, size_t size) { return long_double_neumaier_sum(arr,size); }
+static long double bench_long_double_pairwise(void const *arr, size_t size) { return long_double_pairwise_sum(arr,size); }
+
+static void bench_float_fill(void *buf, unsigned long long first, size_t count) {
+    float *arr = buf;
+    for (size_t idx = 0; idx != count; ++idx)
+        arr[idx] = 1.f / (float)(first + idx);
+}
+
+static void bench_double_fill(void *buf, unsigned long long first, size_t count) {
+    double *arr = buf;
+    for (size_t idx = 0; idx != count; ++idx)
+        arr[idx] = 1. / (double)(first + idx);
+}
+
+static void bench_long_double_fill(void *buf, unsigned long long first, size_t count) {
+    long double *arr = buf;
+    for (size_t idx = 0; idx != count; ++idx)
+        arr[idx] = 1.L / (long double)(first + idx);
+}
+
+static void bench_float_exact_add(superaccumulator_t *acc, void const *buf, size_t count) {
+    float const *arr = buf;
+    for (size_t idx = 0; idx != count; ++idx)
+        superacc_add(acc,arr[idx]);
+}
+
+static void bench_double_exact_add(superaccumulator_t *acc, void const *buf, size_t count) {
+    double const *arr = buf;
+    for (size_t idx = 0; idx != count; ++idx)
+        superacc_add(acc,arr[idx]);
+}
+
+static void bench_long_double_exact_add(superaccumulator_t *acc, void const *buf, size_t count) {
+    long double const *arr = buf;
+    for (size_t idx = 0; idx != count; ++idx)
+        superacc_add_long_double(acc,arr[idx]);
+}
+
+static bench_algorithm_t const bench_float_algorithms[] = {
+    {"naive", bench_float_naive}, {"kahan", bench_float_kahan}, {"neumaier", bench_float_neumaier}, {"pairwise", bench_float_pairwise},
+    {"naive_simd", bench_float_naive_simd}, {"kahan_simd", bench_float_kahan_simd}, {"neumaier_simd", bench_float_neumaier_simd},
+    {"pairwise_simd", bench_float_pairwise_simd}, {"exact", bench_float_exact}
+};
+
+static bench_algorithm_t const bench_double_algorithms[] = {
+    {"naive", bench_double_naive}, {"kahan", bench_double_kahan}, {"neumaier", bench_double_neumaier}, {"pairwise", bench_double_pairwise},
+    {"naive_simd", bench_double_naive_simd}, {"kahan_simd", bench_double_kahan_simd}, {"neumaier_simd", bench_double_neumaier_simd},
+    {"pairwise_simd", bench_double_pairwise_simd}, {"exact", bench_double_exact}
+};
+
+static bench_algorithm_t const bench_long_double_algorithms[] = {
+    {"naive", bench_long_double_naive}, {"kahan", bench_long_double_kahan},
+    {"neumaier", bench_long_double_neumaier}, {"pairwise", bench_long_double_pairwise}
+};
+
+#define BENCH_MAX_ALGORITHMS 9u
+
+static bench_type_t const bench_types[3] = {
+    {"float", sizeof(float), bench_float_fill, bench_float_exact_add, bench_float_algorithms, 9},
+    {"double", sizeof(double), bench_double_fill, bench_double_exact_add, bench_double_algorithms, 9},
+    {"long double", sizeof(long double), bench_long_double_fill, bench_long_double_exact_add, bench_long_double_algorithms, 4}
+};
+
+/**
+ * Прогон всех типов и алгоритмов для количества слагаемых 10^3, 10^4, ..., max_terms.
+ * Возвращает false, если не удалось выделить память или записать данные.
+ * */
+bool summation_benchmark(unsigned long long max_terms, FILE *out) {
+    fprintf(out,"type,algorithm,terms,seconds,ns_per_term,gb_per_s,result,reference,rel_error\n");
+    for (unsigned type_idx = 0; type_idx != 3; ++type_idx) {
+        bench_type_t const *type = bench_types + type_idx;
+        size_t chunk = BENCH_CHUNK_BYTES / type->element_size;
+        void *buf = malloc(BENCH_CHUNK_BYTES);
+        if (NULL == buf)
+            return false;
+
+        for (unsigned long long terms = 1000; terms <= max_terms; terms *= 10) {
+            long double sums[BENCH_MAX_ALGORITHMS] = {0.L}, corrections[BENCH_MAX_ALGORITHMS] = {0.L};
+            double seconds[BENCH_MAX_ALGORITHMS] = {0.};
+            superaccumulator_t reference;
+            superacc_init(&reference);
+
+            for (unsigned long long first = 1; first <= terms; first += chunk) {
+                size_t count = terms - first + 1 < chunk ? (size_t)(terms - first + 1) : chunk;
+                type->fill(buf,first,count);
+                type->exact_add(&reference,buf,count);
+
+                for (unsigned alg = 0; alg != type->algorithm_count; ++alg) {
+                    long double part;
+                    unsigned repeats = 0;
+                    clock_t start = clock(), now;
+                    do {
+                        part = type->algorithms[alg].sum(buf,count);
+                        ++repeats;
+                        now = clock();
+                    } while ((double)(now - start) / CLOCKS_PER_SEC < BENCH_MIN_SECONDS);
+                    seconds[alg] += (double)(now - start) / CLOCKS_PER_SEC / repeats;
+
+                    long double y = part - corrections[alg]; //суммы частей складываем алгоритмом Кэхэна
+                    long double t = sums[alg] + y;
+                    corrections[alg] = (t - sums[alg]) - y;
+                    sums[alg] = t;
+                }
+            }
+
+            long double exact = superacc_long_double(&reference);
+            for (unsigned alg = 0; alg != type->algorithm_count; ++alg)
+                fprintf(out,"%s,%s,%llu,%.6e,%.4f,%.3f,%.21Lg,%.21Lg,%.3Le\n", type->name, type->algorithms[alg].name, terms,
+                    seconds[alg], 1.e9 * seconds[alg] / terms, (double)terms * type->element_size / seconds[alg] / 1.e9,
+                    sums[alg], exact, fabsl(sums[alg] - exact) / exact);
+            fflush(out);
+            if (ferror(out)) {
+                free(buf);
+                return false;
+            }
+        }
+        free(buf);
+    }
+    return true;
+}
+
+void summation_benchmark_test() {
+    unsigned long long max_terms;
+    printf("Enter maximum number of terms (1000 ... 10000000000):"); fflush(stdout);
+    if (1 != scanf("%llu",&max_terms)) {
+        printf("Input format error!\n");
+        return;
+    }
+
+    FILE *out = fopen("./summation_benchmark.csv","w");
+    if (NULL == out) {
+        printf("Can't open file to write!\n");
+        return;
+    }
+    if (!summation_benchmark(max_terms,out))
+        printf("Benchmark failed: not enough memory or file stream error!\n");
+    else
+        printf("Results are in summation_benchmark.csv\n");
+    fclose(out);
+}
+
+int main() {
+    if (false) float_summation_harmonic_series_test();
+    if (false) double_summation_test();
+    if (false) exact_summation_test();
+    if (false) summation_benchmark_test();
+    return 0;
+}
@@ -0,0 +1,228 @@
+/**
+ * В 44_kahan_summation.c гармонический ряд суммировался до миллиона
+ * членов одним потоком выполнения. Если членов ряда 10^11, то
+ * одному ядру процессора потребуются минуты, а то и часы.
+ * Задачу можно разделить между несколькими потоками (threads), которые
+ * выполняются одновременно на разных ядрах. Каждый поток считает
+ * сумму своей части ряда, а затем частичные суммы складываются.
+ *
+ * Однако сложение чисел с плавающей точкой не ассоциативно:
+ * (a + b) + c может не совпадать с a + (b + c). Если разбиение ряда
+ * на части зависит от количества потоков, то и результат будет
+ * зависеть от количества потоков. Чтобы этого избежать:
+ * 1) разобьём ряд на блоки фиксированного размера, не зависящего от
+ *    количества потоков - сумма каждого блока всегда одна и та же;
+ * 2) потоки лишь распределяют блоки между собой;
+ * 3) суммы блоков складываются в фиксированном порядке - попарно,
+ *    по дереву, которое зависит только от количества блоков.
+ * Тогда результат побитово совпадает при любом количестве потоков.
+ *
+ * Для работы с потоками используется библиотека POSIX threads.
+ * Компиляция:
+ * gcc 47_parallel_harmonic_series.c -o harmonic -std=c99 -O3 -march=native -pthread
+ * Ключ -ffast-math использовать нельзя (см. 46_summation_algorithms.c).
+ * */
+
+#define _POSIX_C_SOURCE 200809L //объявления POSIX функций: sysconf, clock_gettime
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>  //malloc free
+#include <string.h>  //memcmp
+#include <math.h>    //log
+#include <time.h>    //clock_gettime
+#include <unistd.h>  //sysconf
+#include <pthread.h> //pthread_create pthread_join
+
+/**
+ * Частичная сумма с поправкой: точное значение примерно равно s + c.
+ * */
+typedef struct {
+    double s, c;
+} compensated_t;
+
+/**
+ * Сложение без потери разрядов (алгоритм TwoSum Кнута):
+ * s - округлённая сумма a + b, c - ошибка округления, a + b == s + c точно.
+ * */
+compensated_t two_sum(double a, double b) {
+    double s = a + b;
+    double bb = s - a;
+    double c = (a - (s - bb)) + (b - bb);
+    return (compensated_t){s, c};
+}
+
+compensated_t compensated_add(compensated_t x, compensated_t y) {
+    compensated_t res = two_sum(x.s,y.s);
+    res.c += x.c + y.c;
+    return two_sum(res.s,res.c); //переносим старшие разряды поправки в сумму
+}
+
+/**
+ * Сумма 1/k для k из [first, last).
+ * Внутри блока суммирование ведётся в LANES независимых "полосах"
+ * алгоритмом Кэхэна. Такой цикл компилятор с ключом -O3 превращает
+ * в векторные инструкции (см. 46_summation_algorithms.c), а результат
+ * зависит только от first и last.
+ * */
+#define LANES 8u
+
+compensated_t harmonic_block_sum(unsigned long long first, unsigned long long last) {
+    double s[LANES] = {0.}, r[LANES] = {0.};
+    unsigned long long k = first;
+    for (; k + LANES <= last; k += LANES)
+        for (unsigned lane = 0; lane != LANES; ++lane) {
+            double y = 1. / (double)(k + lane) - r[lane];
+            double t = s[lane] + y;
+            r[lane] = (t - s[lane]) - y;
+            s[lane] = t;
+        }
+
+    compensated_t res = {0., 0.};
+    for (unsigned lane = 0; lane != LANES; ++lane)
+        res = compensated_add(res,(compensated_t){s[lane], -r[lane]});
+    for (; k != last; ++k)
+        res = compensated_add(res,(compensated_t){1. / (double)k, 0.});
+    return res;
+}
+
+/**
+ * Попарное сложение частичных сумм. Порядок сложения определяется только
+ * количеством частей count, а не тем, какой поток какую часть посчитал.
+ * */
+compensated_t compensated_tree_reduce(compensated_t const *parts, size_t count) {
+    if (0 == count) return (compensated_t){0., 0.};
+    if (1 == count) return parts[0];
+    size_t half = count / 2;
+    return compensated_add(compensated_tree_reduce(parts,half), compensated_tree_reduce(parts + half,count - half));
+}
+
+/**
+ * Размер блока в членах ряда. Он не должен зависеть от количества потоков!
+ * */
+#define HARMONIC_BLOCK (1ull << 20)
+
+//данные, которые получает каждый поток
+typedef struct {
+    unsigned long long N;     //суммируем 1/k для k от 1 до N
+    size_t block_count;
+    size_t thread_idx, thread_count;
+    compensated_t *block_sums; //общий для всех потоков массив, каждый поток пишет только в свои элементы
+} harmonic_task_t;
+
+/**
+ * Функция, которую выполняет поток. Сигнатуру void *(*)(void *) требует pthread_create.
+ * Поток с номером thread_idx берёт блоки thread_idx, thread_idx + thread_count, ...
+ * */
+void *harmonic_worker(void *arg) {
+    harmonic_task_t *task = arg;
+    for (size_t block = task->thread_idx; block < task->block_count; block += task->thread_count) {
+        unsigned long long first = 1 + block * HARMONIC_BLOCK;
+        unsigned long long last = first + HARMONIC_BLOCK;
+        if (last > task->N + 1) last = task->N + 1;
+        task->block_sums[block] = harmonic_block_sum(first,last);
+    }
+    return NULL;
+}
+
+/**
+ * Сумма 1 + 1/2 + ... + 1/N, рассчитанная thread_count потоками.
+ * Результат не зависит от thread_count. В случае ошибки возвращает false.
+ * */
+bool parallel_harmonic_sum(unsigned long long N, size_t thread_count, double *result) {
+    if (0 == N) { //пустая сумма: блоков нет, потоки не нужны
+        *result = 0.;
+        return true;
+    }
+    if (0 == thread_count) thread_count = 1;
+    size_t block_count = (N + HARMONIC_BLOCK - 1) / HARMONIC_BLOCK;
+    if (thread_count > block_count) thread_count = block_count;
+
+    compensated_t *block_sums = malloc(block_count * sizeof(compensated_t));
+    harmonic_task_t *tasks = malloc(thread_count * sizeof(harmonic_task_t));
+    pthread_t *threads = malloc(thread_count * sizeof(pthread_t));
+    bool success = false;
+    if (NULL == block_sums || NULL == tasks || NULL == threads)
+        goto CLEAR;
+
+    //задачи заполняются заранее: их выполнит и поток, и мы сами, если поток не запустится
+    for (size_t idx = 0; idx != thread_count; ++idx)
+        tasks[idx] = (harmonic_task_t){N, block_count, idx, thread_count, block_sums};
+    size_t started = 1; //нулевой поток - это мы сами, его задачу выполним без создания нового потока
+    for (; started != thread_count; ++started)
+        if (0 != pthread_create(threads + started,NULL,harmonic_worker,tasks + started))
+            break;
+    harmonic_worker(tasks + 0);
+    for (size_t idx = 1; idx < started; ++idx)
+        pthread_join(threads[idx],NULL); //ждём завершения каждого потока
+    if (started != thread_count) //не все потоки удалось запустить - доделаем их работу сами
+        for (size_t idx = started; idx != thread_count; ++idx)
+            harmonic_worker(tasks + idx);
+
+    compensated_t total = compensated_tree_reduce(block_sums,block_count);
+    *result = total.s + total.c;
+    success = true;
+
+CLEAR:
+    free(threads);
+    free(tasks);
+    free(block_sums);
+    return success;
+}
+
+double seconds_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec + ts.tv_nsec * 1.e-9;
+}
+
+/**
+ * Проверим, что результат побитово одинаков при разном количестве потоков.
+ * Для сравнения используем асимптотическую формулу H(N) ~ ln N + gamma + 1/(2N) - 1/(12N^2).
+ * */
+void parallel_harmonic_series_test() {
+    unsigned long long const N = 1000000000ull;
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t thread_counts[5] = {1, 2, 3, 8, cores > 0 ? (size_t)cores : 1};
+
+    double first_result = 0.;
+    for (unsigned idx = 0; idx != 5; ++idx) {
+        double res, start = seconds_now();
+        if (!parallel_harmonic_sum(N,thread_counts[idx],&res)) {
+            printf("Can't allocate memory!\n");
+            return;
+        }
+        if (0 == idx) first_result = res;
+        printf("%zu threads: %.17g (%a) %.3f s %s\n", thread_counts[idx], res, res, seconds_now() - start,
+            0 == memcmp(&res,&first_result,sizeof(double)) ? "identical" : "DIFFERENT!");
+    }
+    double const gamma = 0.57721566490153286061;
+    printf("asymptotic: %.17g\n", log((double)N) + gamma + 1./(2.*N) - 1./(12.*N*N));
+}
+
+/**
+ * Для N = 10^11 понадобится около сотни тысяч блоков. На одном ядре
+ * это займёт порядка минуты, а на 32 ядрах - пару секунд.
+ * */
+void parallel_harmonic_series_huge_test() {
+    unsigned long long N;
+    size_t thread_count;
+    printf("Enter N and number of threads:"); fflush(stdout);
+    if (2 != scanf("%llu%zu",&N,&thread_count)) {
+        printf("Input format error!\n");
+        return;
+    }
+
+    double res, start = seconds_now();
+    if (!parallel_harmonic_sum(N,thread_count,&res)) {
+        printf("Can't allocate memory!\n");
+        return;
+    }
+    printf("H(%llu) = %.17g, %.3f s\n",N,res,seconds_now() - start);
+}
+
+int main() {
+    if (false) parallel_harmonic_series_test();
+    if (false) parallel_harmonic_series_huge_test();
+    return 0;
+}
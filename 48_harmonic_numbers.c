@@ -0,0 +1,167 @@
+/**
+ * Гармоническое число H(n) = 1 + 1/2 + ... + 1/n.
+ * В 44_kahan_summation.c и 47_parallel_harmonic_series.c мы вычисляли
+ * H(n) суммированием, т.е. за O(n) операций. Если требуется ответить
+ * на миллионы запросов H(n) для разных n, то общее время будет
+ * пропорционально сумме всех n. Этого можно избежать:
+ * 1) для небольших n один раз посчитаем таблицу H(1), H(2), ... -
+ *    каждый следующий элемент таблицы равен предыдущему плюс 1/n
+ *    (такая таблица называется таблицей префиксных сумм);
+ * 2) для больших n воспользуемся асимптотическим разложением
+ *    Эйлера-Маклорена:
+ *    H(n) = ln n + gamma + 1/(2n) - 1/(12n^2) + 1/(120n^4) - 1/(252n^6) + R,
+ *    где gamma - постоянная Эйлера-Масчерони, а остаток R по модулю не
+ *    превосходит первого отброшенного члена 1/(240n^8).
+ * Тогда каждый запрос выполняется за O(1).
+ *
+ * Компиляция:
+ * gcc 48_harmonic_numbers.c -o harmonic_numbers -std=c99 -O2 -lm
+ * */
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h> //malloc free rand
+#include <math.h>   //log fabs
+#include <float.h>  //DBL_EPSILON
+#include <time.h>   //clock
+
+/**
+ * Размер таблицы. Уже при n = 64 остаток R меньше 10^-16, т.е.
+ * асимптотика точна до последнего разряда double, потому таблица
+ * нужна не для точности, а для скорости: взять элемент из таблицы
+ * быстрее, чем вычислить логарифм. 4096 чисел double занимают 32 КБ
+ * и помещаются в кэш процессора.
+ * */
+#define HARMONIC_TABLE_SIZE 4096u
+
+static double harmonic_table[HARMONIC_TABLE_SIZE];
+static bool harmonic_table_ready = false;
+
+/**
+ * Таблица строится "лениво" - при первом обращении, а не при старте программы.
+ * Суммирование ведётся с поправкой (алгоритм TwoSum, см. 47_parallel_harmonic_series.c),
+ * чтобы каждый элемент таблицы был верен до последнего разряда.
+ * Внимание! Функция не рассчитана на одновременный первый вызов из нескольких потоков:
+ * если это возможно, вызовите harmonic_number(0) до запуска потоков.
+ * */
+static void harmonic_table_build() {
+    double s = 0., c = 0.;
+    harmonic_table[0] = 0.;
+    for (unsigned n = 1; n != HARMONIC_TABLE_SIZE; ++n) {
+        double x = 1. / n;
+        double t = s + x;
+        double bb = t - s;
+        c += (s - (t - bb)) + (x - bb);
+        s = t;
+        harmonic_table[n] = s + c;
+    }
+    harmonic_table_ready = true;
+}
+
+double harmonic_asymptotic(unsigned long long n) {
+    double const gamma = 0.57721566490153286061;
+    double x = 1. / (double)n, x2 = x * x;
+    //поправки складываем от меньших к большим, схема Горнера
+    double tail = x2 * (-1./12. + x2 * (1./120. - x2 * (1./252.)));
+    return log((double)n) + (gamma + (0.5 * x + tail));
+}
+
+/**
+ * Запрос H(n) за O(1).
+ * */
+double harmonic_number(unsigned long long n) {
+    if (!harmonic_table_ready)
+        harmonic_table_build();
+    if (n < HARMONIC_TABLE_SIZE)
+        return harmonic_table[n];
+    return harmonic_asymptotic(n);
+}
+
+/**
+ * Оценка сверху абсолютной ошибки harmonic_number(n).
+ * Для табличных значений это половина единицы последнего разряда (ulp) и
+ * небольшой запас на поправку. Для асимптотики - остаток разложения
+ * 1/(240n^8) плюс ошибки округления: логарифм в стандартной библиотеке
+ * точен до 1 ulp, сложение четырёх слагаемых добавляет не более 2 ulp.
+ * */
+double harmonic_error_bound(unsigned long long n) {
+    double h = harmonic_number(n);
+    if (n < HARMONIC_TABLE_SIZE)
+        return 0.5 * DBL_EPSILON * h + DBL_EPSILON * DBL_EPSILON * h;
+    double x = 1. / (double)n, x4 = x * x * x * x;
+    return x4 * x4 / 240. + 3. * DBL_EPSILON * h;
+}
+
+/**
+ * Пакетная обработка запросов: res[idx] = H(n[idx]).
+ * */
+void harmonic_numbers(unsigned long long const *n, double *res, size_t count) {
+    if (!harmonic_table_ready)
+        harmonic_table_build();
+    for (size_t idx = 0; idx != count; ++idx)
+        res[idx] = n[idx] < HARMONIC_TABLE_SIZE ? harmonic_table[n[idx]] : harmonic_asymptotic(n[idx]);
+}
+
+/**
+ * Проверка оценки ошибки: сравним harmonic_number(n) с суммой, посчитанной
+ * "в лоб" с поправкой, для всех n до 10^7. Асимптотика проверяется и для
+ * табличных n, начиная с 64, - там она тоже должна укладываться в оценку.
+ * */
+void harmonic_number_error_test() {
+    double s = 0., c = 0., max_err = 0., max_ratio = 0., max_asym_ratio = 0.;
+    unsigned long long worst_n = 0;
+    for (unsigned long long n = 1; n != 10000001ull; ++n) {
+        double x = 1. / (double)n;
+        double t = s + x;
+        double bb = t - s;
+        c += (s - (t - bb)) + (x - bb);
+        s = t;
+        double exact = s + c;
+
+        double err = fabs(harmonic_number(n) - exact);
+        double ratio = err / harmonic_error_bound(n);
+        if (err > max_err) { max_err = err; worst_n = n; }
+        if (ratio > max_ratio) max_ratio = ratio;
+        if (n >= 64 && n < HARMONIC_TABLE_SIZE) {
+            double asym_ratio = fabs(harmonic_asymptotic(n) - exact) / (1. / (240. * pow((double)n,8.)) + 3. * DBL_EPSILON * exact);
+            if (asym_ratio > max_asym_ratio) max_asym_ratio = asym_ratio;
+        }
+    }
+    printf("max error %e at n = %llu\n",max_err,worst_n);
+    printf("max error / bound: %f (table and asymptotic), %f (asymptotic on small n)\n",max_ratio,max_asym_ratio);
+    printf("%s\n", max_ratio <= 1. && max_asym_ratio <= 1. ? "bound holds" : "BOUND VIOLATED!");
+}
+
+/**
+ * Миллионы запросов для случайных n: время не зависит от величины n.
+ * */
+void harmonic_numbers_batch_test() {
+    size_t const count = 10000000u;
+    unsigned long long *n = malloc(count * sizeof(unsigned long long));
+    double *res = malloc(count * sizeof(double));
+    if (NULL == n || NULL == res) {
+        printf("Can't allocate memory!\n");
+        goto CLEAR;
+    }
+
+    srand(48);
+    for (size_t idx = 0; idx != count; ++idx) //n от 0 до примерно 10^18
+        n[idx] = ((unsigned long long)rand() * RAND_MAX + rand()) % (idx % 2 ? HARMONIC_TABLE_SIZE : 1000000000000000000ull);
+
+    clock_t start = clock();
+    harmonic_numbers(n,res,count);
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    printf("%zu queries in %.3f s (%.1f ns/query)\n",count,seconds,1.e9 * seconds / count);
+    for (size_t idx = 0; idx != 4; ++idx)
+        printf("H(%llu) = %.17g +- %.1e\n",n[idx],res[idx],harmonic_error_bound(n[idx]));
+
+CLEAR:
+    free(res);
+    free(n);
+}
+
+int main() {
+    if (false) harmonic_number_error_test();
+    if (false) harmonic_numbers_batch_test();
+    return 0;
+}
@@ -0,0 +1,23 @@
+/**
+ * Отдельная единица трансляции: без LTO компилятор, обрабатывая main.c,
+ * не видит тела этих функций и не может встроить их в циклы.
+ * Переполнение int - неопределённое поведение, поэтому сложение, вычитание
+ * и умножение выполняются над unsigned, где результат берётся по модулю 2^32.
+ * */
+#include "arithmetic.h"
+
+int sum(int x, int y) {
+    return (int)((unsigned)x + (unsigned)y);
+}
+
+int sub(int x, int y) {
+    return (int)((unsigned)x - (unsigned)y);
+}
+
+int mul(int x, int y) {
+    return (int)((unsigned)x * (unsigned)y);
+}
+
+int divv(int x, int y) {
+    return x / y;
+}
@@ -0,0 +1,18 @@
+/**
+ * Заголовок библиотеки arithmetic из 45_increment_compilation.c.
+ * "Стражи включения" (include guards) защищают от повторного
+ * включения заголовка, если он попадёт в файл дважды через другие заголовки.
+ * */
+#ifndef ARITHMETIC_H
+#define ARITHMETIC_H
+
+/**
+ * sum, sub и mul при переполнении дают результат по модулю 2^32
+ * (как в 50_simd_array_arithmetic.c), divv - частное как у оператора /.
+ * */
+int sum(int,int);
+int sub(int,int);
+int mul(int,int);
+int divv(int,int);
+
+#endif
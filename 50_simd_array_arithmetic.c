@@ -0,0 +1,308 @@
+/**
+ * В 49_libraries_lto_pgo/main.c мы увидели, что вызов sum(x,y) для каждой
+ * пары чисел стоит дороже самого сложения. Если пар миллионы, то
+ * выгоднее, чтобы библиотека принимала сразу массивы:
+ * sum_n(a, b, res, n) вычисляет res[idx] = a[idx] + b[idx] для всех idx.
+ * Тогда цена вызова делится на n, а внутри функции можно
+ * использовать векторные инструкции AVX2, которые обрабатывают
+ * по 8 чисел int за одну инструкцию.
+ *
+ * Но не каждый процессор поддерживает AVX2. Если собрать программу
+ * с ключом -mavx2, то на старом процессоре она аварийно завершится.
+ * Решение - выбор реализации во время выполнения (runtime dispatch):
+ * в программе есть и обычный, и векторный варианты, а при первом вызове
+ * мы спрашиваем процессор, что он умеет, и запоминаем адрес подходящей
+ * функции в указателе (см. 41_function_pointers.c).
+ *
+ * Компиляция (ключ -mavx2 не нужен):
+ * gcc 50_simd_array_arithmetic.c -o simd_arithmetic -std=c99 -O2
+ * */
+
+/*---------------- arithmetic.h -------------*/
+#ifndef ARITHMETIC_H
+#define ARITHMETIC_H
+
+#include <stddef.h> //size_t
+
+int sum(int,int);
+int sub(int,int);
+int mul(int,int);
+int divv(int,int);
+
+/**
+ * Пакетные варианты: res[idx] = op(a[idx], b[idx]) для idx от 0 до n-1.
+ * Переполнение при sum_n, sub_n и mul_n происходит по модулю 2^32.
+ * Для divv_n, как и для divv, делитель не должен быть нулём,
+ * а INT_MIN / -1 даёт INT_MIN.
+ * */
+void sum_n(int const *a, int const *b, int *res, size_t n);
+void sub_n(int const *a, int const *b, int *res, size_t n);
+void mul_n(int const *a, int const *b, int *res, size_t n);
+void divv_n(int const *a, int const *b, int *res, size_t n);
+
+#endif
+/*-------------------------------------------*/
+
+/*---------------- arithmetic.c -------------*/
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h> //malloc free rand
+#include <limits.h> //INT_MIN INT_MAX
+#include <time.h>   //clock
+
+int sum(int x, int y) {
+    return x + y;
+}
+
+int sub(int x, int y) {
+    return x - y;
+}
+
+int mul(int x, int y) {
+    return x * y;
+}
+
+int divv(int x, int y) {
+    return x / y;
+}
+
+/**
+ * Обычные (скалярные) варианты. Переполнение знаковых целых - неопределённое
+ * поведение, потому вычисляем в беззнаковом типе, где переполнение происходит
+ * по модулю 2^32, так же, как в векторных инструкциях.
+ * */
+static void sum_n_scalar(int const *a, int const *b, int *res, size_t n) {
+    for (size_t idx = 0; idx != n; ++idx)
+        res[idx] = (int)((unsigned)a[idx] + (unsigned)b[idx]);
+}
+
+static void sub_n_scalar(int const *a, int const *b, int *res, size_t n) {
+    for (size_t idx = 0; idx != n; ++idx)
+        res[idx] = (int)((unsigned)a[idx] - (unsigned)b[idx]);
+}
+
+static void mul_n_scalar(int const *a, int const *b, int *res, size_t n) {
+    for (size_t idx = 0; idx != n; ++idx)
+        res[idx] = (int)((unsigned)a[idx] * (unsigned)b[idx]);
+}
+
+static void divv_n_scalar(int const *a, int const *b, int *res, size_t n) {
+    for (size_t idx = 0; idx != n; ++idx)
+        res[idx] = (-1 == b[idx]) ? (int)(0u - (unsigned)a[idx]) : a[idx] / b[idx];
+}
+
+/**
+ * Векторные варианты для AVX2.
+ * Атрибут target("avx2") разрешает компилятору использовать AVX2 только
+ * внутри этой функции, даже если весь файл собран без ключа -mavx2.
+ * Вызывать такую функцию можно только на процессоре с поддержкой AVX2.
+ * */
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+#define ARITHMETIC_AVX2 1
+
+__attribute__((target("avx2")))
+static void sum_n_avx2(int const *a, int const *b, int *res, size_t n) {
+    size_t idx = 0;
+    for (; idx + 8 <= n; idx += 8) {
+        __m256i va = _mm256_loadu_si256((__m256i const *)(a + idx));
+        __m256i vb = _mm256_loadu_si256((__m256i const *)(b + idx));
+        _mm256_storeu_si256((__m256i *)(res + idx),_mm256_add_epi32(va,vb));
+    }
+    sum_n_scalar(a + idx,b + idx,res + idx,n - idx); //"хвост" короче 8 элементов
+}
+
+__attribute__((target("avx2")))
+static void sub_n_avx2(int const *a, int const *b, int *res, size_t n) {
+    size_t idx = 0;
+    for (; idx + 8 <= n; idx += 8) {
+        __m256i va = _mm256_loadu_si256((__m256i const *)(a + idx));
+        __m256i vb = _mm256_loadu_si256((__m256i const *)(b + idx));
+        _mm256_storeu_si256((__m256i *)(res + idx),_mm256_sub_epi32(va,vb));
+    }
+    sub_n_scalar(a + idx,b + idx,res + idx,n - idx);
+}
+
+__attribute__((target("avx2")))
+static void mul_n_avx2(int const *a, int const *b, int *res, size_t n) {
+    size_t idx = 0;
+    for (; idx + 8 <= n; idx += 8) {
+        __m256i va = _mm256_loadu_si256((__m256i const *)(a + idx));
+        __m256i vb = _mm256_loadu_si256((__m256i const *)(b + idx));
+        _mm256_storeu_si256((__m256i *)(res + idx),_mm256_mullo_epi32(va,vb)); //младшие 32 бита произведения
+    }
+    mul_n_scalar(a + idx,b + idx,res + idx,n - idx);
+}
+
+/**
+ * Инструкции целочисленного деления в AVX2 нет.
+ * Частное можно получить через деление чисел с плавающей точкой, но float
+ * хранит только 24 бита мантиссы, а int - 31 бит и знак, потому a/b во float
+ * может ошибиться на десятки единиц. В double (53 бита) любое int
+ * представимо точно, а округлённое частное double(a)/double(b) никогда
+ * не "перескакивает" через целое число: если бы точное частное было чуть
+ * меньше целого k, то оно отличалось бы от k не менее чем на 1/|b|,
+ * а ошибка округления не больше |a/b| * 2^-53, и так как |a| <= 2^31,
+ * она не больше 2^-22/|b| < 1/|b|. Потому отбрасывание дробной части
+ * (как при делении целых в C) даёт точный результат для всех int.
+ * 4 числа double помещаются в один регистр AVX, потому обрабатываем
+ * 8 чисел двумя половинами.
+ * */
+__attribute__((target("avx2")))
+static void divv_n_avx2(int const *a, int const *b, int *res, size_t n) {
+    size_t idx = 0;
+    for (; idx + 8 <= n; idx += 8) {
+        __m128i a_lo = _mm_loadu_si128((__m128i const *)(a + idx)), a_hi = _mm_loadu_si128((__m128i const *)(a + idx + 4));
+        __m128i b_lo = _mm_loadu_si128((__m128i const *)(b + idx)), b_hi = _mm_loadu_si128((__m128i const *)(b + idx + 4));
+        __m256d q_lo = _mm256_div_pd(_mm256_cvtepi32_pd(a_lo),_mm256_cvtepi32_pd(b_lo));
+        __m256d q_hi = _mm256_div_pd(_mm256_cvtepi32_pd(a_hi),_mm256_cvtepi32_pd(b_hi));
+        //cvtt - преобразование с отбрасыванием дробной части; 2^31 (INT_MIN / -1) превращается в INT_MIN
+        __m256i q = _mm256_set_m128i(_mm256_cvttpd_epi32(q_hi),_mm256_cvttpd_epi32(q_lo));
+        _mm256_storeu_si256((__m256i *)(res + idx),q);
+    }
+    divv_n_scalar(a + idx,b + idx,res + idx,n - idx);
+}
+#endif
+
+/**
+ * Выбор реализации. Указатели инициализируются при первом вызове любой
+ * из пакетных функций.
+ * */
+typedef void (*array_operation_t)(int const*, int const*, int*, size_t);
+
+static array_operation_t sum_n_impl, sub_n_impl, mul_n_impl, divv_n_impl;
+static bool array_operations_selected = false;
+
+//переменная окружения ARITHMETIC_SCALAR позволяет принудительно выбрать скалярные варианты, например, для сравнения
+static void select_array_operations() {
+    sum_n_impl = sum_n_scalar;
+    sub_n_impl = sub_n_scalar;
+    mul_n_impl = mul_n_scalar;
+    divv_n_impl = divv_n_scalar;
+#if defined(ARITHMETIC_AVX2)
+    __builtin_cpu_init(); //встроенная функция gcc: опрашивает процессор инструкцией cpuid
+    if (__builtin_cpu_supports("avx2") && NULL == getenv("ARITHMETIC_SCALAR")) {
+        sum_n_impl = sum_n_avx2;
+        sub_n_impl = sub_n_avx2;
+        mul_n_impl = mul_n_avx2;
+        divv_n_impl = divv_n_avx2;
+    }
+#endif
+    array_operations_selected = true;
+}
+
+void sum_n(int const *a, int const *b, int *res, size_t n) {
+    if (!array_operations_selected) select_array_operations();
+    sum_n_impl(a,b,res,n);
+}
+
+void sub_n(int const *a, int const *b, int *res, size_t n) {
+    if (!array_operations_selected) select_array_operations();
+    sub_n_impl(a,b,res,n);
+}
+
+void mul_n(int const *a, int const *b, int *res, size_t n) {
+    if (!array_operations_selected) select_array_operations();
+    mul_n_impl(a,b,res,n);
+}
+
+void divv_n(int const *a, int const *b, int *res, size_t n) {
+    if (!array_operations_selected) select_array_operations();
+    divv_n_impl(a,b,res,n);
+}
+/*-------------------------------------------*/
+
+/**
+ * Проверка: пакетные функции должны совпадать с поэлементными вызовами
+ * sum, sub, mul, divv. Для деления проверяем и крайние значения int.
+ * */
+void array_operations_correctness_test() {
+    size_t const size = 10000003u; //не кратно 8, чтобы проверить "хвост"
+    int *a = malloc(size * sizeof(int)), *b = malloc(size * sizeof(int)), *res = malloc(size * sizeof(int));
+    if (NULL == a || NULL == b || NULL == res) {
+        printf("Can't allocate memory!\n");
+        goto CLEAR;
+    }
+
+    int const extremes[8] = {INT_MAX, INT_MIN + 1, INT_MAX - 1, 1, -1, 2, -2, 46341};
+    srand(50);
+    for (size_t idx = 0; idx != size; ++idx) {
+        unsigned r = (unsigned)rand() << 16 ^ (unsigned)rand();
+        a[idx] = idx % 5 ? (int)r : extremes[idx % 8];
+        r = (unsigned)rand() << 16 ^ (unsigned)rand();
+        b[idx] = idx % 3 ? (int)(r >> (r % 31)) : extremes[(idx / 3) % 8]; //делители разной величины
+        if (0 == b[idx]) b[idx] = 7;
+    }
+
+    char const *names[4] = {"sum_n", "sub_n", "mul_n", "divv_n"};
+    void (*batch[4])(int const*, int const*, int*, size_t) = {sum_n, sub_n, mul_n, divv_n};
+    int (*single[4])(int,int) = {sum, sub, mul, divv};
+    for (unsigned op = 0; op != 4; ++op) {
+        batch[op](a,b,res,size);
+        size_t errors = 0;
+        for (size_t idx = 0; idx != size; ++idx) {
+            //в скалярной проверке избегаем переполнения: сравниваем только там, где результат представим в int
+            long long wide = 0 == op ? (long long)a[idx] + b[idx] : 1 == op ? (long long)a[idx] - b[idx] :
+                             2 == op ? (long long)a[idx] * b[idx] : (long long)a[idx] / b[idx];
+            if (wide >= INT_MIN && wide <= INT_MAX && res[idx] != single[op](a[idx],b[idx]))
+                ++errors;
+        }
+        printf("%-7s %zu errors\n",names[op],errors);
+    }
+
+CLEAR:
+    free(res);
+    free(b);
+    free(a);
+}
+
+/**
+ * Скорость: поэлементный вызов функции против пакетной обработки.
+ * Запустите тест дважды - обычным образом и с переменной окружения
+ * ARITHMETIC_SCALAR=1, чтобы сравнить AVX2 и скалярный варианты.
+ * */
+void array_operations_speed_test() {
+    size_t const size = 1u << 20;
+    unsigned const repeats = 100;
+    int *a = malloc(size * sizeof(int)), *b = malloc(size * sizeof(int)), *res = malloc(size * sizeof(int));
+    if (NULL == a || NULL == b || NULL == res) {
+        printf("Can't allocate memory!\n");
+        goto CLEAR;
+    }
+    srand(50);
+    for (size_t idx = 0; idx != size; ++idx) {
+        a[idx] = rand() - RAND_MAX / 2;
+        b[idx] = rand() % 1000 + 1;
+    }
+
+    select_array_operations();
+    printf("%s kernels\n", sum_n_impl == sum_n_scalar ? "scalar" : "AVX2");
+    char const *names[4] = {"sum", "sub", "mul", "divv"};
+    void (*batch[4])(int const*, int const*, int*, size_t) = {sum_n, sub_n, mul_n, divv_n};
+    int (*volatile single[4])(int,int) = {sum, sub, mul, divv}; //volatile - чтобы компилятор не встроил функции
+    for (unsigned op = 0; op != 4; ++op) {
+        clock_t start = clock();
+        for (unsigned rep = 0; rep != repeats; ++rep)
+            for (size_t idx = 0; idx != size; ++idx)
+                res[idx] = single[op](a[idx],b[idx]);
+        clock_t middle = clock();
+        for (unsigned rep = 0; rep != repeats; ++rep)
+            batch[op](a,b,res,size);
+        clock_t finish = clock();
+        printf("%-5s single %.3f ns/element, batch %.3f ns/element\n", names[op],
+            1.e9 * (middle - start) / CLOCKS_PER_SEC / ((double)size * repeats),
+            1.e9 * (finish - middle) / CLOCKS_PER_SEC / ((double)size * repeats));
+    }
+
+CLEAR:
+    free(res);
+    free(b);
+    free(a);
+}
+
+int main() {
+    if (false) array_operations_correctness_test();
+    if (false) array_operations_speed_test();
+    return 0;
+}
@@ -0,0 +1,657 @@
+/**
+ * Калькулятор из 45_increment_compilation.c и функция
+ * switch_choose_operation из 41_function_pointers.c выполняют одну
+ * операцию за один ввод пользователя. Если требуется вычислять миллионы
+ * выражений вида (a + b) * (c - 3) / d, то разбирать текст выражения
+ * каждый раз заново слишком дорого.
+ *
+ * Так поступают интерпретаторы многих языков программирования:
+ * 1) текст выражения один раз переводится (компилируется) в "байт-код" -
+ *    последовательность простых команд для воображаемой машины;
+ * 2) виртуальная машина (VM) выполняет эти команды столько раз, сколько нужно.
+ *
+ * Наша машина - стековая. Выражение (a + b) * 3 превращается в команды:
+ * VAR a; VAR b; ADD; CONST 3; MUL; HALT
+ * VAR и CONST кладут число на стек, ADD и MUL снимают два числа со стека
+ * и кладут результат, HALT завершает работу - результат на вершине стека.
+ *
+ * Главный цикл виртуальной машины - взять очередную команду и выполнить её.
+ * Способ перехода к обработчику команды (dispatch) сильно влияет на скорость.
+ * Сравним три способа:
+ * 1) оператор switch (см. 21_switch.c);
+ * 2) таблица указателей на функции-обработчики (см. 41_function_pointers.c);
+ * 3) "вычисляемый goto" (computed goto) - расширение компилятора gcc,
+ *    которое позволяет хранить адреса меток в массиве и переходить по ним.
+ * А для x86-64 Linux - ещё и перевод байт-кода в машинный код (JIT).
+ *
+ * Компиляция:
+ * gcc 51_expression_bytecode_vm.c -o vm -std=c99 -O2
+ * */
+
+#define _DEFAULT_SOURCE //объявления mmap и MAP_ANONYMOUS недоступны в строгом режиме -std=c99
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h> //malloc free rand
+#include <string.h> //strcspn memcpy
+#include <ctype.h>  //isdigit isspace islower
+#include <time.h>   //clock
+
+/**
+ * Команды виртуальной машины.
+ * CONST и VAR занимают в байт-коде две ячейки: код команды и операнд
+ * (само число или номер переменной), остальные команды - одну.
+ * */
+typedef enum {
+    OP_CONST,
+    OP_VAR,
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_NEG,
+    OP_HALT,
+    OP_COUNT //количество команд, удобно для размеров массивов
+} opcode_t;
+
+#define BYTECODE_MAX_SIZE 1024
+#define VM_STACK_SIZE 64
+#define VM_VARIABLES 26 //переменные обозначаются строчными латинскими буквами a...z
+
+typedef struct {
+    int code[BYTECODE_MAX_SIZE];
+    unsigned size;         //количество занятых ячеек
+    unsigned instructions; //количество команд без учёта HALT
+    unsigned depth, max_depth; //глубина стека при компиляции: машине не нужно проверять переполнение стека во время работы
+} bytecode_t;
+
+/**
+ * Компилятор: рекурсивный спуск (см. 30_function_recursion.c).
+ * Грамматика выражений:
+ * expression = term { ('+' | '-') term }
+ * term       = factor { ('*' | '/') factor }
+ * factor     = number | variable | '-' factor | '(' expression ')'
+ * Каждое правило - отдельная функция. Операция записывается в байт-код
+ * после обоих операндов, потому приоритет операций получается "сам собой".
+ * */
+typedef struct {
+    char const *pos;       //текущая позиция в тексте
+    bytecode_t *bc;
+    char const *error;     //NULL, пока ошибок нет
+    char const *error_pos;
+} parser_t;
+
+static void parser_fail(parser_t *p, char const *message) {
+    if (NULL == p->error) { //сохраняем только первую ошибку
+        p->error = message;
+        p->error_pos = p->pos;
+    }
+}
+
+static void skip_spaces(parser_t *p) {
+    while (isspace((unsigned char)*p->pos)) ++p->pos;
+}
+
+//stack_change - на сколько команда изменяет глубину стека
+static void emit(parser_t *p, opcode_t op, int stack_change) {
+    bytecode_t *bc = p->bc;
+    if (bc->size + 1 > BYTECODE_MAX_SIZE) { parser_fail(p,"expression is too long"); return; }
+    bc->code[bc->size++] = op;
+    if (OP_HALT != op) ++bc->instructions;
+    bc->depth += stack_change;
+    if (bc->depth > bc->max_depth) bc->max_depth = bc->depth;
+    if (bc->max_depth > VM_STACK_SIZE) parser_fail(p,"expression is too deep");
+}
+
+static void emit_operand(parser_t *p, int operand) {
+    bytecode_t *bc = p->bc;
+    if (bc->size + 1 > BYTECODE_MAX_SIZE) { parser_fail(p,"expression is too long"); return; }
+    bc->code[bc->size++] = operand;
+}
+
+static void parse_expression(parser_t *p);
+
+static void parse_factor(parser_t *p) {
+    skip_spaces(p);
+    char c = *p->pos;
+    if (isdigit((unsigned char)c)) {
+        long long value = 0;
+        while (isdigit((unsigned char)*p->pos)) {
+            value = value * 10 + (*p->pos - '0');
+            if (value > 2147483647ll) { parser_fail(p,"number is too big"); return; }
+            ++p->pos;
+        }
+        emit(p,OP_CONST,+1);
+        emit_operand(p,(int)value);
+    } else if (islower((unsigned char)c)) {
+        ++p->pos;
+        emit(p,OP_VAR,+1);
+        emit_operand(p,c - 'a');
+    } else if ('-' == c) {
+        ++p->pos;
+        parse_factor(p);
+        emit(p,OP_NEG,0);
+    } else if ('(' == c) {
+        ++p->pos;
+        parse_expression(p);
+        skip_spaces(p);
+        if (')' != *p->pos) { parser_fail(p,"')' expected"); return; }
+        ++p->pos;
+    } else {
+        parser_fail(p,"number, variable or '(' expected");
+    }
+}
+
+static void parse_term(parser_t *p) {
+    parse_factor(p);
+    for (skip_spaces(p); NULL == p->error && ('*' == *p->pos || '/' == *p->pos); skip_spaces(p)) {
+        char op = *p->pos++;
+        parse_factor(p);
+        emit(p,'*' == op ? OP_MUL : OP_DIV,-1);
+    }
+}
+
+static void parse_expression(parser_t *p) {
+    parse_term(p);
+    for (skip_spaces(p); NULL == p->error && ('+' == *p->pos || '-' == *p->pos); skip_spaces(p)) {
+        char op = *p->pos++;
+        parse_term(p);
+        emit(p,'+' == op ? OP_ADD : OP_SUB,-1);
+    }
+}
+
+/**
+ * Компиляция текста в байт-код. При ошибке возвращает false, а через
+ * error и error_offset сообщает, что и где не так.
+ * */
+bool compile_expression(char const *text, bytecode_t *bc, char const **error, size_t *error_offset) {
+    *bc = (bytecode_t){.size = 0};
+    parser_t p = {text, bc, NULL, NULL};
+    parse_expression(&p);
+    skip_spaces(&p);
+    if (NULL == p.error && '\0' != *p.pos)
+        parser_fail(&p,"unexpected symbol");
+    emit(&p,OP_HALT,0);
+    if (NULL != p.error) {
+        *error = p.error;
+        *error_offset = (size_t)(p.error_pos - text);
+        return false;
+    }
+    return true;
+}
+
+void print_bytecode(bytecode_t const *bc) {
+    char const *names[OP_COUNT] = {"CONST", "VAR", "ADD", "SUB", "MUL", "DIV", "NEG", "HALT"};
+    for (unsigned pc = 0; pc < bc->size; ++pc) {
+        printf("%s",names[bc->code[pc]]);
+        if (OP_CONST == bc->code[pc]) printf(" %d",bc->code[++pc]);
+        else if (OP_VAR == bc->code[pc]) printf(" %c",'a' + bc->code[++pc]);
+        printf("; ");
+    }
+    printf("(max stack %u)\n",bc->max_depth);
+}
+
+/**
+ * Арифметика виртуальной машины. Как и в 50_simd_array_arithmetic.c,
+ * переполнение происходит по модулю 2^32, а INT_MIN / -1 даёт INT_MIN,
+ * чтобы ни одно выражение не приводило к неопределённому поведению.
+ * Деление на ноль - ошибка выполнения.
+ * */
+typedef enum {
+    VM_OK,
+    VM_DIVISION_BY_ZERO
+} vm_status_t;
+
+static inline int vm_add(int x, int y) { return (int)((unsigned)x + (unsigned)y); }
+static inline int vm_sub(int x, int y) { return (int)((unsigned)x - (unsigned)y); }
+static inline int vm_mul(int x, int y) { return (int)((unsigned)x * (unsigned)y); }
+static inline int vm_neg(int x) { return (int)(0u - (unsigned)x); }
+static inline int vm_div(int x, int y) { return -1 == y ? vm_neg(x) : x / y; }
+
+/**
+ * 1) Диспетчеризация через switch.
+ * Компилятор превращает switch в таблицу переходов, но все команды
+ * возвращаются в одну точку - начало цикла - и переходят из неё по
+ * одной и той же инструкции косвенного перехода. Процессору трудно
+ * предсказать, куда будет следующий переход.
+ * */
+vm_status_t vm_run_switch(bytecode_t const *bc, int const *vars, int *result) {
+    int stack[VM_STACK_SIZE], *sp = stack; //sp указывает на первую свободную ячейку стека
+    int const *pc = bc->code;             //pc (program counter) - текущая команда
+    for (;;) {
+        switch (*pc) {
+            case OP_CONST: *sp++ = pc[1]; pc += 2; break;
+            case OP_VAR:   *sp++ = vars[pc[1]]; pc += 2; break;
+            case OP_ADD:   --sp; sp[-1] = vm_add(sp[-1],sp[0]); ++pc; break;
+            case OP_SUB:   --sp; sp[-1] = vm_sub(sp[-1],sp[0]); ++pc; break;
+            case OP_MUL:   --sp; sp[-1] = vm_mul(sp[-1],sp[0]); ++pc; break;
+            case OP_DIV:
+                --sp;
+                if (0 == sp[0]) return VM_DIVISION_BY_ZERO;
+                sp[-1] = vm_div(sp[-1],sp[0]); ++pc;
+                break;
+            case OP_NEG:   sp[-1] = vm_neg(sp[-1]); ++pc; break;
+            case OP_HALT:  *result = sp[-1]; return VM_OK;
+        }
+    }
+}
+
+/**
+ * 2) Таблица функций-обработчиков.
+ * Каждая команда - отдельная функция, все функции имеют одну сигнатуру:
+ * получают состояние машины и возвращают true, если работу нужно продолжить.
+ * Выбор обработчика - просто индекс в массиве, как в function_pointers_choose_operation.
+ * */
+typedef struct {
+    int const *pc;
+    int *sp;
+    int const *vars;
+    vm_status_t status;
+} vm_state_t;
+
+static bool vm_op_const(vm_state_t *s) { *s->sp++ = s->pc[1]; s->pc += 2; return true; }
+static bool vm_op_var(vm_state_t *s)   { *s->sp++ = s->vars[s->pc[1]]; s->pc += 2; return true; }
+static bool vm_op_add(vm_state_t *s)   { --s->sp; s->sp[-1] = vm_add(s->sp[-1],s->sp[0]); ++s->pc; return true; }
+static bool vm_op_sub(vm_state_t *s)   { --s->sp; s->sp[-1] = vm_sub(s->sp[-1],s->sp[0]); ++s->pc; return true; }
+static bool vm_op_mul(vm_state_t *s)   { --s->sp; s->sp[-1] = vm_mul(s->sp[-1],s->sp[0]); ++s->pc; return true; }
+static bool vm_op_div(vm_state_t *s) {
+    --s->sp;
+    if (0 == s->sp[0]) { s->status = VM_DIVISION_BY_ZERO; return false; }
+    s->sp[-1] = vm_div(s->sp[-1],s->sp[0]); ++s->pc;
+    return true;
+}
+static bool vm_op_neg(vm_state_t *s)  { s->sp[-1] = vm_neg(s->sp[-1]); ++s->pc; return true; }
+static bool vm_op_halt(vm_state_t *s) { (void)s; return false; }
+
+typedef bool (*vm_handler_t)(vm_state_t *);
+static vm_handler_t const vm_handlers[OP_COUNT] = {
+    vm_op_const, vm_op_var, vm_op_add, vm_op_sub, vm_op_mul, vm_op_div, vm_op_neg, vm_op_halt
+};
+
+vm_status_t vm_run_table(bytecode_t const *bc, int const *vars, int *result) {
+    int stack[VM_STACK_SIZE];
+    vm_state_t s = {bc->code, stack, vars, VM_OK};
+    while (vm_handlers[*s.pc](&s))
+        ;
+    if (VM_OK == s.status)
+        *result = s.sp[-1];
+    return s.status;
+}
+
+/**
+ * 3) Вычисляемый goto.
+ * gcc позволяет получить адрес метки выражением &&метка и перейти по нему
+ * оператором goto *адрес. Каждый обработчик сам переходит к следующей
+ * команде - инструкций косвенного перехода столько же, сколько команд,
+ * и процессор предсказывает каждую из них отдельно. Кроме того, нет
+ * проверки границ, которую switch выполняет перед переходом по таблице.
+ * Это не часть стандарта C, потому для других компиляторов используем switch.
+ * */
+vm_status_t vm_run_goto(bytecode_t const *bc, int const *vars, int *result) {
+#if defined(__GNUC__)
+    static void *const labels[OP_COUNT] = {
+        &&L_CONST, &&L_VAR, &&L_ADD, &&L_SUB, &&L_MUL, &&L_DIV, &&L_NEG, &&L_HALT
+    };
+    int stack[VM_STACK_SIZE], *sp = stack;
+    int const *pc = bc->code;
+
+    goto *labels[*pc];
+L_CONST: *sp++ = pc[1]; pc += 2; goto *labels[*pc];
+L_VAR:   *sp++ = vars[pc[1]]; pc += 2; goto *labels[*pc];
+L_ADD:   --sp; sp[-1] = vm_add(sp[-1],sp[0]); ++pc; goto *labels[*pc];
+L_SUB:   --sp; sp[-1] = vm_sub(sp[-1],sp[0]); ++pc; goto *labels[*pc];
+L_MUL:   --sp; sp[-1] = vm_mul(sp[-1],sp[0]); ++pc; goto *labels[*pc];
+L_DIV:
+    --sp;
+    if (0 == sp[0]) return VM_DIVISION_BY_ZERO;
+    sp[-1] = vm_div(sp[-1],sp[0]); ++pc;
+    goto *labels[*pc];
+L_NEG:   sp[-1] = vm_neg(sp[-1]); ++pc; goto *labels[*pc];
+L_HALT:  *result = sp[-1]; return VM_OK;
+#else
+    return vm_run_switch(bc,vars,result);
+#endif
+}
+
+/**
+ * 4) JIT-компиляция (just in time - "точно в срок").
+ * Даже самая быстрая диспетчеризация тратит время на выбор обработчика
+ * и на работу со стеком в памяти. Можно пойти дальше: перевести байт-код
+ * прямо в машинный код процессора x86-64 во время работы программы,
+ * записать его в память и вызвать как обычную функцию через указатель
+ * (см. 41_function_pointers.c). Тогда выражение вычисляется со скоростью
+ * скомпилированной программы.
+ *
+ * Машинный код - это просто байты. Например, байты 01 C8 означают
+ * инструкцию add eax, ecx. Коды инструкций можно найти в документации
+ * Intel или посмотреть, во что компилирует gcc: objdump -d программа.
+ *
+ * Сгенерированная функция имеет ту же сигнатуру, что и vm_run_*, только
+ * без байт-кода: vm_status_t f(int const *vars, int *result).
+ * По соглашению о вызовах Linux x86-64 первый параметр (vars) приходит
+ * в регистре rdi, второй (result) - в rsi, возвращаемое значение - в eax.
+ *
+ * Стек машины превращается в настоящий стек процессора (инструкции push
+ * и pop), а вершина стека всё время хранится в регистре eax - так
+ * большинство команд обходится без обращения к памяти.
+ *
+ * Память для кода выделяется функцией mmap, а затем функцией mprotect
+ * ей запрещается запись и разрешается выполнение: в одну и ту же память
+ * нельзя одновременно писать и выполнять из неё код (правило W^X).
+ * На других процессорах и системах JIT недоступен, и вычисление
+ * выполняется интерпретатором.
+ * */
+typedef vm_status_t (*jit_function_t)(int const *vars, int *result);
+
+typedef struct {
+    jit_function_t fn; //NULL, если JIT недоступен
+    void *memory;
+    size_t size;
+} jit_code_t;
+
+#if defined(__x86_64__) && defined(__linux__)
+#include <sys/mman.h> //mmap mprotect munmap
+
+#define JIT_MAX_INSTRUCTION_BYTES 32 //ни одна команда байт-кода не превращается в большее число байт
+
+typedef struct {
+    unsigned char *code;
+    size_t size;
+} jit_buffer_t;
+
+static void jit_bytes(jit_buffer_t *b, unsigned char const *bytes, size_t count) {
+    for (size_t idx = 0; idx != count; ++idx)
+        b->code[b->size++] = bytes[idx];
+}
+
+static void jit_int32(jit_buffer_t *b, int value) {
+    unsigned u = (unsigned)value;
+    for (unsigned byte = 0; byte != 4; ++byte)
+        b->code[b->size++] = (unsigned char)(u >> (8 * byte)); //x86 хранит числа младшим байтом вперёд
+}
+
+bool jit_compile(bytecode_t const *bc, jit_code_t *jit) {
+    *jit = (jit_code_t){NULL, NULL, 0};
+    size_t capacity = (size_t)bc->size * JIT_MAX_INSTRUCTION_BYTES + 64;
+    void *memory = mmap(NULL,capacity,PROT_READ | PROT_WRITE,MAP_PRIVATE | MAP_ANONYMOUS,-1,0);
+    if (MAP_FAILED == memory)
+        return false;
+
+    jit_buffer_t b = {memory, 0};
+    size_t error_jumps[BYTECODE_MAX_SIZE / 2]; //места, где нужно дописать адрес перехода на обработку деления на ноль
+    unsigned error_jump_count = 0;
+
+    unsigned char const prologue[] = {0x55, 0x48, 0x89, 0xE5}; //push rbp; mov rbp, rsp - запоминаем вершину стека процессора
+    jit_bytes(&b,prologue,sizeof(prologue));
+
+    unsigned depth = 0; //глубина стека машины: при depth >= 1 вершина находится в eax
+    for (unsigned pc = 0; pc < bc->size; ++pc) {
+        switch (bc->code[pc]) {
+            case OP_CONST:
+                if (depth > 0) jit_bytes(&b,(unsigned char const[]){0x50},1); //push rax
+                jit_bytes(&b,(unsigned char const[]){0xB8},1);               //mov eax, imm32
+                jit_int32(&b,bc->code[++pc]);
+                ++depth;
+                break;
+            case OP_VAR:
+                if (depth > 0) jit_bytes(&b,(unsigned char const[]){0x50},1); //push rax
+                jit_bytes(&b,(unsigned char const[]){0x8B, 0x87},2);         //mov eax, [rdi + disp32]
+                jit_int32(&b,bc->code[++pc] * (int)sizeof(int));
+                ++depth;
+                break;
+            case OP_ADD: //pop rcx; add eax, ecx
+                jit_bytes(&b,(unsigned char const[]){0x59, 0x01, 0xC8},3);
+                --depth;
+                break;
+            case OP_SUB: //pop rcx; sub ecx, eax; mov eax, ecx - левый операнд был ниже на стеке
+                jit_bytes(&b,(unsigned char const[]){0x59, 0x29, 0xC1, 0x89, 0xC8},5);
+                --depth;
+                break;
+            case OP_MUL: //pop rcx; imul eax, ecx
+                jit_bytes(&b,(unsigned char const[]){0x59, 0x0F, 0xAF, 0xC1},4);
+                --depth;
+                break;
+            case OP_DIV:
+                //pop rcx; xchg eax, ecx - теперь делимое в eax, делитель в ecx; test ecx, ecx; jz error
+                jit_bytes(&b,(unsigned char const[]){0x59, 0x91, 0x85, 0xC9, 0x0F, 0x84},6);
+                error_jumps[error_jump_count++] = b.size;
+                jit_int32(&b,0); //адрес перехода допишем, когда код обработки ошибки будет сгенерирован
+                //cmp ecx, -1; je +5; cdq; idiv ecx; jmp +2; neg eax - деление на -1 заменяем сменой знака, как vm_div
+                jit_bytes(&b,(unsigned char const[]){0x83, 0xF9, 0xFF, 0x74, 0x05, 0x99, 0xF7, 0xF9, 0xEB, 0x02, 0xF7, 0xD8},12);
+                --depth;
+                break;
+            case OP_NEG: //neg eax
+                jit_bytes(&b,(unsigned char const[]){0xF7, 0xD8},2);
+                break;
+            case OP_HALT: //mov [rsi], eax; xor eax, eax (VM_OK); mov rsp, rbp; pop rbp; ret
+                jit_bytes(&b,(unsigned char const[]){0x89, 0x06, 0x31, 0xC0, 0x48, 0x89, 0xEC, 0x5D, 0xC3},9);
+                break;
+        }
+    }
+
+    //обработка деления на ноль: mov eax, VM_DIVISION_BY_ZERO; mov rsp, rbp; pop rbp; ret
+    size_t error_handler = b.size;
+    jit_bytes(&b,(unsigned char const[]){0xB8},1);
+    jit_int32(&b,VM_DIVISION_BY_ZERO);
+    jit_bytes(&b,(unsigned char const[]){0x48, 0x89, 0xEC, 0x5D, 0xC3},5);
+    for (unsigned idx = 0; idx != error_jump_count; ++idx) {
+        size_t at = error_jumps[idx];
+        size_t saved = b.size;
+        b.size = at;
+        jit_int32(&b,(int)(error_handler - (at + 4))); //смещение считается от конца инструкции перехода
+        b.size = saved;
+    }
+
+    if (0 != mprotect(memory,capacity,PROT_READ | PROT_EXEC)) {
+        munmap(memory,capacity);
+        return false;
+    }
+    jit->memory = memory;
+    jit->size = capacity;
+    memcpy(&jit->fn,&memory,sizeof(void *)); //стандарт C не разрешает приводить void * к указателю на функцию, POSIX разрешает копирование
+    return true;
+}
+
+void jit_free(jit_code_t *jit) {
+    if (NULL != jit->memory)
+        munmap(jit->memory,jit->size);
+    *jit = (jit_code_t){NULL, NULL, 0};
+}
+
+#else
+
+bool jit_compile(bytecode_t const *bc, jit_code_t *jit) {
+    (void)bc;
+    *jit = (jit_code_t){NULL, NULL, 0};
+    return false;
+}
+
+void jit_free(jit_code_t *jit) {
+    *jit = (jit_code_t){NULL, NULL, 0};
+}
+
+#endif
+
+/**
+ * Скомпилированное выражение: байт-код и, если получилось, машинный код.
+ * Если JIT недоступен, вычисление выполняет интерпретатор.
+ * */
+typedef struct {
+    bytecode_t bc;
+    jit_code_t jit;
+} compiled_expression_t;
+
+bool expression_compile(char const *text, compiled_expression_t *e, char const **error, size_t *error_offset) {
+    if (!compile_expression(text,&e->bc,error,error_offset))
+        return false;
+    jit_compile(&e->bc,&e->jit);
+    return true;
+}
+
+vm_status_t expression_eval(compiled_expression_t const *e, int const *vars, int *result) {
+    if (NULL != e->jit.fn)
+        return e->jit.fn(vars,result);
+    return vm_run_goto(&e->bc,vars,result);
+}
+
+void expression_free(compiled_expression_t *e) {
+    jit_free(&e->jit);
+}
+
+/**
+ * Проверка JIT: генерируем случайные выражения и сравниваем результаты
+ * машинного кода и интерпретатора, в том числе при делении на ноль
+ * и на -1, и при переполнении.
+ * */
+static void random_expression(char *buf, size_t *len, unsigned depth) {
+    int kind = depth == 0 ? rand() % 2 : rand() % 8;
+    if (0 == kind) {
+        *len += sprintf(buf + *len,"%d",rand() % 5 ? rand() % 10 : rand());
+    } else if (1 == kind) {
+        buf[(*len)++] = (char)('a' + rand() % 6);
+    } else if (2 == kind) {
+        buf[(*len)++] = '-';
+        random_expression(buf,len,depth - 1);
+    } else {
+        char const ops[4] = {'+', '-', '*', '/'};
+        buf[(*len)++] = '(';
+        random_expression(buf,len,depth - 1);
+        buf[(*len)++] = ops[rand() % 4];
+        random_expression(buf,len,depth - 1);
+        buf[(*len)++] = ')';
+    }
+    buf[*len] = '\0';
+}
+
+void jit_cross_check_test() {
+    srand(9);
+    unsigned mismatches = 0, expressions = 0, evaluations = 0;
+    for (unsigned test = 0; test != 2000; ++test) {
+        char text[4096];
+        size_t len = 0;
+        random_expression(text,&len,1 + rand() % 7);
+
+        compiled_expression_t e;
+        char const *error;
+        size_t error_offset;
+        if (!expression_compile(text,&e,&error,&error_offset)) {
+            printf("%s\n%*s^ %s\n",text,(int)error_offset,"",error);
+            continue;
+        }
+        if (NULL == e.jit.fn) {
+            printf("JIT is not available on this platform\n");
+            return;
+        }
+        ++expressions;
+        for (unsigned set = 0; set != 100; ++set) {
+            int vars[VM_VARIABLES];
+            int const special[6] = {0, 1, -1, 2147483647, -2147483647 - 1, 7};
+            for (unsigned v = 0; v != VM_VARIABLES; ++v)
+                vars[v] = rand() % 3 ? rand() % 201 - 100 : special[rand() % 6];
+
+            int jit_result = 0, vm_result = 0;
+            vm_status_t jit_status = e.jit.fn(vars,&jit_result);
+            vm_status_t vm_status = vm_run_switch(&e.bc,vars,&vm_result);
+            ++evaluations;
+            if (jit_status != vm_status || (VM_OK == vm_status && jit_result != vm_result)) {
+                if (mismatches++ < 5)
+                    printf("mismatch: %s -> jit %d (%d), vm %d (%d)\n",text,jit_result,jit_status,vm_result,vm_status);
+            }
+        }
+        expression_free(&e);
+    }
+    printf("%u expressions, %u evaluations, %u mismatches\n",expressions,evaluations,mismatches);
+}
+
+/**
+ * Калькулятор: пользователь вводит выражение (переменные не используются,
+ * все они равны нулю), программа печатает байт-код и результат.
+ * */
+void expression_calculator_test() {
+    char line[256];
+    printf("Enter expression:"); fflush(stdout);
+    if (NULL == fgets(line,sizeof(line),stdin)) {
+        printf("Can't read expression!\n");
+        return;
+    }
+    line[strcspn(line,"\n")] = '\0';
+
+    bytecode_t bc;
+    char const *error;
+    size_t error_offset;
+    if (!compile_expression(line,&bc,&error,&error_offset)) {
+        printf("%s\n%*s^ %s\n",line,(int)error_offset,"",error);
+        return;
+    }
+    print_bytecode(&bc);
+
+    int vars[VM_VARIABLES] = {0}, result;
+    if (VM_OK != vm_run_switch(&bc,vars,&result))
+        printf("Division by zero!\n");
+    else
+        printf("%s = %d\n",line,result);
+}
+
+/**
+ * Сравнение скорости трёх способов диспетчеризации.
+ * Каждое выражение вычисляется для миллиона наборов значений переменных.
+ * */
+void vm_dispatch_benchmark() {
+    char const *expressions[4] = {
+        "a + b",
+        "(a + b) * (c - d) / (e * e + 1) - -f * 3",
+        "a*a*a + b*b*b + c*c*c - 3*a*b*c + (d - e) / (f*f + 7) + (a + b + c + d + e + f) * 1000",
+        "((((a + 1) * (b + 2) - (c + 3)) * ((d + 4) - (e + 5) * (f + 6))) / (a*a + b*b + 1))"
+    };
+    size_t const sets = 1000000u;
+    int *vars = malloc(sets * VM_VARIABLES * sizeof(int));
+    if (NULL == vars) {
+        printf("Can't allocate memory!\n");
+        return;
+    }
+    srand(51);
+    for (size_t idx = 0; idx != sets * VM_VARIABLES; ++idx)
+        vars[idx] = rand() % 2001 - 1000;
+
+    char const *names[4] = {"switch", "table", "goto", "jit"};
+    vm_status_t (*runners[3])(bytecode_t const*, int const*, int*) = {vm_run_switch, vm_run_table, vm_run_goto};
+    for (unsigned e = 0; e != 4; ++e) {
+        bytecode_t bc;
+        char const *error;
+        size_t error_offset;
+        printf("%s\n",expressions[e]);
+        if (!compile_expression(expressions[e],&bc,&error,&error_offset)) {
+            printf("%*s^ %s\n",(int)error_offset,"",error);
+            continue;
+        }
+
+        jit_code_t jit;
+        unsigned runner_count = jit_compile(&bc,&jit) ? 4 : 3; //четвёртый вариант - машинный код, если он доступен
+        long long checksums[4] = {0};
+        for (unsigned r = 0; r != runner_count; ++r) {
+            long long checksum = 0;
+            clock_t start = clock();
+            for (size_t set = 0; set != sets; ++set) {
+                int result;
+                vm_status_t status = 3 == r ? jit.fn(vars + set * VM_VARIABLES,&result) : runners[r](&bc,vars + set * VM_VARIABLES,&result);
+                if (VM_OK == status)
+                    checksum += result;
+            }
+            double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+            checksums[r] = checksum;
+            printf("  %-7s %7.1f M instructions/s, %6.2f M expressions/s\n", names[r],
+                (double)bc.instructions * sets / seconds / 1.e6, sets / seconds / 1.e6);
+        }
+        if (checksums[0] != checksums[1] || checksums[1] != checksums[2] || (4 == runner_count && checksums[2] != checksums[3]))
+            printf("  RESULTS DIFFER!\n");
+        jit_free(&jit);
+    }
+    free(vars);
+}
+
+int main() {
+    if (false) expression_calculator_test();
+    if (false) vm_dispatch_benchmark();
+    if (false) jit_cross_check_test();
+    return 0;
+}
@@ -0,0 +1,378 @@
+/**
+ * В 42_files_ascii.c целые числа читались из файла по одному вызовом
+ * fscanf(descriptor,"%d",&num). Функция fscanf универсальна: она разбирает
+ * строку формата, блокирует поток, читает по одному символу. Для файла
+ * в десятки гигабайт это слишком медленно - несколько мегабайт в секунду.
+ *
+ * Напишем собственное чтение целых чисел:
+ * 1) файл читается большими блоками функцией fread в буфер;
+ * 2) в буфере сразу по 64 символа классифицируются векторными
+ *    инструкциями (SSE2 или AVX2): какие символы - пробельные, какие - цифры;
+ *    результат - битовые маски, по одному биту на символ;
+ * 3) по маскам находятся начала и концы чисел, а сами числа
+ *    переводятся из текста простым циклом.
+ *
+ * Поведение при ошибках такое же, как в fscanf_return_value_test и
+ * read_file_to_the_end: мы различаем ошибку формата (в файле встретилось
+ * не число), ошибку чтения (ferror) и достижение конца файла (feof).
+ *
+ * Компиляция:
+ * gcc 52_fast_integer_parsing.c -o parse -std=c99 -O2 -mavx2
+ * */
+
+#define _POSIX_C_SOURCE 200809L //clock_gettime
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h> //malloc free rand
+#include <stdint.h> //uint64_t
+#include <string.h> //memcpy memmove memset
+#include <limits.h> //INT_MIN INT_MAX
+#include <time.h>   //clock_gettime
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/**
+ * Результат чтения, аналог возвращаемого значения fscanf вместе с ferror и feof.
+ * */
+typedef enum {
+    PARSE_OK,           //прочитано столько чисел, сколько просили
+    PARSE_EOF,          //файл прочитан до конца
+    PARSE_FORMAT_ERROR, //встретилось не число (или число, которое не помещается в int)
+    PARSE_IO_ERROR      //ошибка чтения файла
+} parse_status_t;
+
+#define INT_READER_BUFFER (1u << 20) //читаем файл блоками по мегабайту
+
+typedef struct {
+    FILE *stream;
+    char *buf;
+    size_t begin, limit, end;       //[begin, limit) - ещё не разобранные целые числа, [limit, end) - начало числа, которое продолжится в следующем блоке
+    unsigned long long buf_offset;  //смещение начала буфера от начала файла
+    unsigned long long error_offset; //где встретилась ошибка формата
+    bool eof;
+} int_reader_t;
+
+bool int_reader_init(int_reader_t *r, FILE *stream) {
+    *r = (int_reader_t){stream, malloc(INT_READER_BUFFER), 0, 0, 0, 0, 0, false};
+    return NULL != r->buf;
+}
+
+void int_reader_free(int_reader_t *r) {
+    free(r->buf);
+    r->buf = NULL;
+}
+
+static bool is_space(char c) {
+    return ' ' == c || ('\t' <= c && c <= '\r'); //те же символы, что пропускает fscanf: пробел, \t \n \v \f \r
+}
+
+/**
+ * Чтение следующего блока. Незаконченное число в конце буфера переносится
+ * в начало, а разбирать разрешается только до последнего пробельного символа:
+ * число, разрезанное границей блока, будет разобрано после следующего чтения.
+ * */
+static parse_status_t int_reader_refill(int_reader_t *r) {
+    size_t rest = r->end - r->begin;
+    memmove(r->buf,r->buf + r->begin,rest);
+    r->buf_offset += r->begin;
+    r->begin = 0;
+    r->end = rest;
+
+    while (!r->eof && r->end != INT_READER_BUFFER) {
+        size_t got = fread(r->buf + r->end,1,INT_READER_BUFFER - r->end,r->stream);
+        r->end += got;
+        if (ferror(r->stream))
+            return PARSE_IO_ERROR;
+        if (feof(r->stream))
+            r->eof = true;
+        if (0 != got)
+            break;
+    }
+
+    if (r->eof) {
+        r->limit = r->end;
+    } else {
+        r->limit = r->end;
+        while (r->limit != 0 && !is_space(r->buf[r->limit - 1])) --r->limit;
+        if (0 == r->limit) { //в целом мегабайте нет ни одного пробела - это точно не int
+            r->error_offset = r->buf_offset;
+            return PARSE_FORMAT_ERROR;
+        }
+    }
+    return r->begin == r->limit ? PARSE_EOF : PARSE_OK;
+}
+
+/**
+ * Классификация 64 символов: бит номер i в *space равен 1, если p[i] -
+ * пробельный символ, в *digit - если p[i] - цифра.
+ * Сравнение "символ в диапазоне [lo, lo + n)" выполняется одной проверкой
+ * без знака: (unsigned)(c - lo) < n, а в SSE2 - через min: min(x, n-1) == x.
+ * */
+#if defined(__AVX2__)
+static void classify64(char const *p, uint64_t *space, uint64_t *digit) {
+    uint64_t s = 0, d = 0;
+    for (unsigned half = 0; half != 2; ++half) {
+        __m256i v = _mm256_loadu_si256((__m256i const *)(p + 32 * half));
+        __m256i ctl = _mm256_sub_epi8(v,_mm256_set1_epi8('\t'));
+        __m256i is_ctl = _mm256_cmpeq_epi8(_mm256_min_epu8(ctl,_mm256_set1_epi8(4)),ctl);
+        __m256i is_sp = _mm256_or_si256(is_ctl,_mm256_cmpeq_epi8(v,_mm256_set1_epi8(' ')));
+        __m256i dig = _mm256_sub_epi8(v,_mm256_set1_epi8('0'));
+        __m256i is_dig = _mm256_cmpeq_epi8(_mm256_min_epu8(dig,_mm256_set1_epi8(9)),dig);
+        s |= (uint64_t)(uint32_t)_mm256_movemask_epi8(is_sp) << (32 * half);
+        d |= (uint64_t)(uint32_t)_mm256_movemask_epi8(is_dig) << (32 * half);
+    }
+    *space = s;
+    *digit = d;
+}
+#elif defined(__SSE2__)
+static void classify64(char const *p, uint64_t *space, uint64_t *digit) {
+    uint64_t s = 0, d = 0;
+    for (unsigned quarter = 0; quarter != 4; ++quarter) {
+        __m128i v = _mm_loadu_si128((__m128i const *)(p + 16 * quarter));
+        __m128i ctl = _mm_sub_epi8(v,_mm_set1_epi8('\t'));
+        __m128i is_ctl = _mm_cmpeq_epi8(_mm_min_epu8(ctl,_mm_set1_epi8(4)),ctl);
+        __m128i is_sp = _mm_or_si128(is_ctl,_mm_cmpeq_epi8(v,_mm_set1_epi8(' ')));
+        __m128i dig = _mm_sub_epi8(v,_mm_set1_epi8('0'));
+        __m128i is_dig = _mm_cmpeq_epi8(_mm_min_epu8(dig,_mm_set1_epi8(9)),dig);
+        s |= (uint64_t)(unsigned)_mm_movemask_epi8(is_sp) << (16 * quarter);
+        d |= (uint64_t)(unsigned)_mm_movemask_epi8(is_dig) << (16 * quarter);
+    }
+    *space = s;
+    *digit = d;
+}
+#else
+static void classify64(char const *p, uint64_t *space, uint64_t *digit) {
+    uint64_t s = 0, d = 0;
+    for (unsigned idx = 0; idx != 64; ++idx) {
+        s |= (uint64_t)is_space(p[idx]) << idx;
+        d |= (uint64_t)((unsigned)(p[idx] - '0') < 10u) << idx;
+    }
+    *space = s;
+    *digit = d;
+}
+#endif
+
+/**
+ * Перевод одного числа из текста. clean == true означает, что в числе
+ * заведомо только цифры (это уже проверено масками), и проверку каждого
+ * символа можно пропустить.
+ * */
+static bool parse_int_token(char const *p, size_t len, bool clean, int *value) {
+    size_t idx = 0;
+    bool negative = false;
+    if ('-' == p[0] || '+' == p[0]) {
+        negative = '-' == p[0];
+        idx = 1;
+    }
+    if (idx == len)
+        return false; //одинокий знак - не число
+    while (idx + 1 < len && '0' == p[idx]) ++idx; //ведущие нули
+    if (len - idx > 10)
+        return false; //в int не более 10 цифр
+
+    long long v = 0;
+    for (; idx != len; ++idx) {
+        unsigned d = (unsigned)(p[idx] - '0');
+        if (!clean && d > 9u)
+            return false;
+        v = v * 10 + d;
+    }
+    if (negative) v = -v;
+    if (v < INT_MIN || v > INT_MAX)
+        return false;
+    *value = (int)v;
+    return true;
+}
+
+/**
+ * Чтение не более capacity чисел в массив out, *count - сколько прочитано.
+ * Возвращает PARSE_OK, если массив заполнен, иначе - причину остановки.
+ * Числа, прочитанные до ошибки формата, сохраняются в out, как и у fscanf.
+ * */
+parse_status_t int_reader_read(int_reader_t *r, int *out, size_t capacity, size_t *count) {
+    *count = 0;
+    while (*count != capacity) {
+        if (r->begin == r->limit) {
+            parse_status_t status = int_reader_refill(r);
+            if (PARSE_OK != status)
+                return status;
+        }
+
+        size_t base = r->begin, token_start = 0;
+        bool in_token = false, token_clean = true;
+        while (base < r->limit) {
+            char window[64];
+            char const *w = r->buf + base;
+            if (r->limit - base < 64) { //последние символы дополняем пробелами
+                memcpy(window,w,r->limit - base);
+                memset(window + (r->limit - base),' ',64 - (r->limit - base));
+                w = window;
+            }
+            uint64_t space, digit;
+            classify64(w,&space,&digit);
+            bool clean = 0 == ~(space | digit); //в окне только цифры и пробелы, знаков и прочих символов нет
+
+            uint64_t not_space = ~space;
+            uint64_t prev_not_space = not_space << 1 | (in_token ? 1u : 0u); //бит i: был ли символ i-1 частью числа
+            uint64_t starts = not_space & ~prev_not_space;
+            uint64_t ends = space & prev_not_space;
+            if (in_token) token_clean = token_clean && clean;
+
+            for (uint64_t events = starts | ends; 0 != events; events &= events - 1) {
+                unsigned bit = (unsigned)__builtin_ctzll(events); //номер младшего единичного бита
+                if (starts >> bit & 1u) {
+                    token_start = base + bit;
+                    in_token = true;
+                    token_clean = clean;
+                    continue;
+                }
+                in_token = false;
+                if (*count == capacity) { //массив заполнен: продолжим с этого числа в следующий раз
+                    r->begin = token_start;
+                    return PARSE_OK;
+                }
+                if (!parse_int_token(r->buf + token_start,base + bit - token_start,token_clean,out + *count)) {
+                    r->begin = token_start;
+                    r->error_offset = r->buf_offset + token_start;
+                    return PARSE_FORMAT_ERROR;
+                }
+                ++*count;
+            }
+            base += 64;
+        }
+        if (in_token) { //конец файла без завершающего пробела ровно на границе окна
+            if (*count == capacity) {
+                r->begin = token_start;
+                return PARSE_OK;
+            }
+            if (!parse_int_token(r->buf + token_start,r->limit - token_start,token_clean,out + *count)) {
+                r->begin = token_start;
+                r->error_offset = r->buf_offset + token_start;
+                return PARSE_FORMAT_ERROR;
+            }
+            ++*count;
+        }
+        r->begin = r->limit;
+    }
+    return PARSE_OK;
+}
+
+double seconds_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec + ts.tv_nsec * 1.e-9;
+}
+
+/**
+ * Аналог read_file_to_the_end из 42_files_ascii.c: читаем все числа из
+ * new_file.txt и сообщаем, чем закончилось чтение.
+ * Вместо печати каждого числа считаем их сумму.
+ * */
+void fast_read_file_to_the_end() {
+    FILE *descriptor = fopen("./new_file.txt","r");
+    if (NULL == descriptor) {
+        printf("Can't open file to read!\n");
+        return;
+    }
+    int_reader_t reader;
+    if (!int_reader_init(&reader,descriptor)) {
+        printf("Can't allocate memory!\n");
+        fclose(descriptor);
+        return;
+    }
+
+    int nums[4096];
+    size_t got;
+    unsigned long long counter = 0;
+    long long total = 0;
+    double start = seconds_now();
+    parse_status_t status;
+    do {
+        status = int_reader_read(&reader,nums,4096,&got);
+        for (size_t idx = 0; idx != got; ++idx)
+            total += nums[idx];
+        counter += got;
+    } while (PARSE_OK == status);
+    double seconds = seconds_now() - start;
+
+    printf("%llu numbers been read, sum %lld\n",counter,total);
+    if (PARSE_FORMAT_ERROR == status)
+        printf("Input format error at byte %llu!\n",reader.error_offset);
+    else if (PARSE_IO_ERROR == status)
+        printf("Error while reading the file!\nProcess terminated!\n");
+    double megabytes = (reader.buf_offset + reader.begin) / 1.e6;
+    printf("%.1f MB in %.3f s: %.1f MB/s, %.1f M numbers/s\n",megabytes,seconds,megabytes / seconds,counter / seconds / 1.e6);
+
+    int_reader_free(&reader);
+    fclose(descriptor);
+}
+
+/**
+ * Сравнение с fscanf: создаём файл как random_numbers_file_write_test
+ * (числа rand()%100 по одному в строке) и читаем его обоими способами.
+ * */
+void fast_parsing_vs_fscanf_test() {
+    unsigned const how_many = 20000000u;
+    FILE *descriptor = fopen("./new_file.txt","w");
+    if (NULL == descriptor) {
+        printf("Can't open file!\n");
+        return;
+    }
+    srand(23);
+    for (unsigned count = 0; count != how_many; ++count)
+        fprintf(descriptor,"%d\n",rand()%100);
+    if (ferror(descriptor)) {
+        printf("Error in printing data to file!\n");
+        fclose(descriptor);
+        return;
+    }
+    fclose(descriptor);
+
+    descriptor = fopen("./new_file.txt","r");
+    if (NULL == descriptor) {
+        printf("Can't open file to read!\n");
+        return;
+    }
+    int num;
+    unsigned long long counter = 0;
+    long long total = 0;
+    double start = seconds_now();
+    while (1 == fscanf(descriptor,"%d",&num)) {
+        ++counter;
+        total += num;
+    }
+    double seconds = seconds_now() - start;
+    printf("fscanf: %llu numbers been read, sum %lld, %.3f s, %.1f M numbers/s\n",counter,total,seconds,counter / seconds / 1.e6);
+    if (!feof(descriptor))
+        printf("File hasn't been read to the end!\n");
+    fclose(descriptor);
+
+    fast_read_file_to_the_end();
+}
+
+/**
+ * Ошибки формата: числа до ошибки прочитаны, ошибка указывает на место в файле.
+ * */
+void fast_parsing_errors_test() {
+    char const *contents[5] = {"1 2 3\n-4 +5\n", "10 20 x 30\n", "1 2 99999999999\n", "7 8 -\n", "-2147483648 2147483647 0000000000000042"};
+    for (unsigned idx = 0; idx != 5; ++idx) {
+        FILE *descriptor = fopen("./new_file.txt","w");
+        if (NULL == descriptor) {
+            printf("Can't open file!\n");
+            return;
+        }
+        fputs(contents[idx],descriptor);
+        fclose(descriptor);
+        fast_read_file_to_the_end();
+    }
+}
+
+int main() {
+    if (false) fast_read_file_to_the_end();
+    if (false) fast_parsing_vs_fscanf_test();
+    if (false) fast_parsing_errors_test();
+    return 0;
+}
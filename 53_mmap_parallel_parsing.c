@@ -0,0 +1,578 @@
+/**
+ * Продолжение 52_fast_integer_parsing.c.
+ * Буферизованное чтение разбирает файл одним потоком, и каждый байт
+ * копируется дважды: с диска (или из кэша страниц операционной системы)
+ * в буфер ядра, а затем функцией fread - в наш буфер.
+ *
+ * Системный вызов mmap отображает файл в адресное пространство программы:
+ * содержимое файла становится обычным массивом char в памяти, страницы
+ * которого подгружаются операционной системой при первом обращении.
+ * Копирования нет, а к любому месту файла можно обратиться сразу.
+ * Это позволяет разобрать файл несколькими потоками (см. 47_parallel_harmonic_series.c):
+ * 1) файл делится на куски фиксированного размера, граница каждого куска
+ *    сдвигается вперёд до ближайшего пробельного символа (конца строки),
+ *    чтобы ни одно число не оказалось разрезанным;
+ * 2) потоки разбирают куски одновременно тем же способом, что и в 52_fast_integer_parsing.c;
+ * 3) результат - либо общий непрерывный массив int, либо "свёртка" по кускам
+ *    (количество, сумма, минимум и максимум), для которой массив не нужен вовсе.
+ *
+ * Чтобы числа разных кусков легли в один массив подряд, нужно знать, с какого
+ * места массива начинается каждый кусок. Поэтому разбор идёт в два прохода:
+ * сначала потоки только считают числа в своих кусках (по маскам начал чисел
+ * это очень дёшево), затем префиксные суммы дают смещения кусков в массиве,
+ * и вторым проходом потоки записывают числа каждый в свою часть массива.
+ *
+ * Компиляция:
+ * gcc 53_mmap_parallel_parsing.c -o mmap_parse -std=c99 -O2 -mavx2 -pthread
+ * */
+
+#define _DEFAULT_SOURCE //mmap madvise sysconf clock_gettime
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>   //malloc free rand
+#include <stdint.h>   //uint64_t
+#include <string.h>   //memcpy memset
+#include <limits.h>   //INT_MIN INT_MAX
+#include <time.h>     //clock_gettime
+#include <fcntl.h>    //open
+#include <unistd.h>   //close sysconf
+#include <sys/mman.h> //mmap munmap madvise
+#include <sys/stat.h> //fstat
+#include <pthread.h>  //pthread_create pthread_join
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+typedef enum {
+    PARSE_OK,           //файл разобран до конца
+    PARSE_FORMAT_ERROR, //встретилось не число (или число, которое не помещается в int)
+    PARSE_IO_ERROR,     //файл не удалось открыть или отобразить в память
+    PARSE_NO_MEMORY     //не удалось выделить память
+} parse_status_t;
+
+/**
+ * Файл, отображённый в память только для чтения.
+ * */
+typedef struct {
+    char const *data;
+    size_t size;
+} mapped_file_t;
+
+bool map_file(char const *path, mapped_file_t *file) {
+    *file = (mapped_file_t){NULL, 0};
+    int fd = open(path,O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (0 != fstat(fd,&st)) {
+        close(fd);
+        return false;
+    }
+    if (0 == st.st_size) { //пустой файл отобразить нельзя, но и разбирать в нём нечего
+        close(fd);
+        return true;
+    }
+    void *data = mmap(NULL,(size_t)st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+    close(fd); //отображение остаётся действительным и после закрытия файла
+    if (MAP_FAILED == data)
+        return false;
+    madvise(data,(size_t)st.st_size,MADV_SEQUENTIAL); //подсказка: читать страницы с опережением
+    *file = (mapped_file_t){data, (size_t)st.st_size};
+    return true;
+}
+
+void unmap_file(mapped_file_t *file) {
+    if (NULL != file->data)
+        munmap((void *)file->data,file->size);
+    *file = (mapped_file_t){NULL, 0};
+}
+
+static bool is_space(char c) {
+    return ' ' == c || ('\t' <= c && c <= '\r');
+}
+
+/**
+ * Классификация 64 символов, как в 52_fast_integer_parsing.c.
+ * */
+#if defined(__AVX2__)
+static void classify64(char const *p, uint64_t *space, uint64_t *digit) {
+    uint64_t s = 0, d = 0;
+    for (unsigned half = 0; half != 2; ++half) {
+        __m256i v = _mm256_loadu_si256((__m256i const *)(p + 32 * half));
+        __m256i ctl = _mm256_sub_epi8(v,_mm256_set1_epi8('\t'));
+        __m256i is_ctl = _mm256_cmpeq_epi8(_mm256_min_epu8(ctl,_mm256_set1_epi8(4)),ctl);
+        __m256i is_sp = _mm256_or_si256(is_ctl,_mm256_cmpeq_epi8(v,_mm256_set1_epi8(' ')));
+        __m256i dig = _mm256_sub_epi8(v,_mm256_set1_epi8('0'));
+        __m256i is_dig = _mm256_cmpeq_epi8(_mm256_min_epu8(dig,_mm256_set1_epi8(9)),dig);
+        s |= (uint64_t)(uint32_t)_mm256_movemask_epi8(is_sp) << (32 * half);
+        d |= (uint64_t)(uint32_t)_mm256_movemask_epi8(is_dig) << (32 * half);
+    }
+    *space = s;
+    *digit = d;
+}
+#elif defined(__SSE2__)
+static void classify64(char const *p, uint64_t *space, uint64_t *digit) {
+    uint64_t s = 0, d = 0;
+    for (unsigned quarter = 0; quarter != 4; ++quarter) {
+        __m128i v = _mm_loadu_si128((__m128i const *)(p + 16 * quarter));
+        __m128i ctl = _mm_sub_epi8(v,_mm_set1_epi8('\t'));
+        __m128i is_ctl = _mm_cmpeq_epi8(_mm_min_epu8(ctl,_mm_set1_epi8(4)),ctl);
+        __m128i is_sp = _mm_or_si128(is_ctl,_mm_cmpeq_epi8(v,_mm_set1_epi8(' ')));
+        __m128i dig = _mm_sub_epi8(v,_mm_set1_epi8('0'));
+        __m128i is_dig = _mm_cmpeq_epi8(_mm_min_epu8(dig,_mm_set1_epi8(9)),dig);
+        s |= (uint64_t)(unsigned)_mm_movemask_epi8(is_sp) << (16 * quarter);
+        d |= (uint64_t)(unsigned)_mm_movemask_epi8(is_dig) << (16 * quarter);
+    }
+    *space = s;
+    *digit = d;
+}
+#else
+static void classify64(char const *p, uint64_t *space, uint64_t *digit) {
+    uint64_t s = 0, d = 0;
+    for (unsigned idx = 0; idx != 64; ++idx) {
+        s |= (uint64_t)is_space(p[idx]) << idx;
+        d |= (uint64_t)((unsigned)(p[idx] - '0') < 10u) << idx;
+    }
+    *space = s;
+    *digit = d;
+}
+#endif
+
+/**
+ * Окно из 64 символов, начиная с p[base]. Файл в памяти ничем не дополнен,
+ * поэтому последние символы куска копируются в локальный буфер и дополняются пробелами.
+ * */
+static char const *chunk_window(char const *p, size_t len, size_t base, char *window) {
+    if (len - base >= 64)
+        return p + base;
+    memcpy(window,p + base,len - base);
+    memset(window + (len - base),' ',64 - (len - base));
+    return window;
+}
+
+static bool parse_int_token(char const *p, size_t len, bool clean, int *value) {
+    size_t idx = 0;
+    bool negative = false;
+    if ('-' == p[0] || '+' == p[0]) {
+        negative = '-' == p[0];
+        idx = 1;
+    }
+    if (idx == len)
+        return false;
+    while (idx + 1 < len && '0' == p[idx]) ++idx;
+    if (len - idx > 10)
+        return false;
+
+    long long v = 0;
+    for (; idx != len; ++idx) {
+        unsigned d = (unsigned)(p[idx] - '0');
+        if (!clean && d > 9u)
+            return false;
+        v = v * 10 + d;
+    }
+    if (negative) v = -v;
+    if (v < INT_MIN || v > INT_MAX)
+        return false;
+    *value = (int)v;
+    return true;
+}
+
+/**
+ * Первый проход: количество "слов" (последовательностей непробельных символов) в куске.
+ * Кусок начинается сразу после пробельного символа, поэтому слово,
+ * начатое в предыдущем куске, продолжаться в этом не может.
+ * */
+static size_t count_chunk_tokens(char const *p, size_t len) {
+    size_t count = 0;
+    bool in_token = false;
+    for (size_t base = 0; base < len; base += 64) {
+        char window[64];
+        uint64_t space, digit;
+        classify64(chunk_window(p,len,base,window),&space,&digit);
+        uint64_t not_space = ~space;
+        uint64_t starts = not_space & ~(not_space << 1 | (in_token ? 1u : 0u));
+        count += (size_t)__builtin_popcountll(starts);
+        in_token = not_space >> 63;
+    }
+    return count;
+}
+
+/**
+ * Свёртка куска: сколько чисел, их сумма, минимум и максимум.
+ * */
+typedef struct {
+    size_t count;
+    long long sum;
+    int min, max;
+} chunk_stats_t;
+
+static inline chunk_stats_t chunk_stats_add(chunk_stats_t stats, int value) {
+    ++stats.count;
+    stats.sum += value;
+    stats.min = value < stats.min ? value : stats.min;
+    stats.max = value > stats.max ? value : stats.max;
+    return stats;
+}
+
+/**
+ * Второй проход: разбор чисел куска. Если out != NULL, числа записываются
+ * в out по порядку. При ошибке формата *error_pos - смещение ошибочного слова
+ * от начала куска, а stats содержит числа, прочитанные до него.
+ * */
+static bool parse_chunk(char const *p, size_t len, int *out, chunk_stats_t *stats, size_t *error_pos) {
+    //свёртка ведётся в локальной переменной: запись в out не может её изменить,
+    //и компилятор держит её в регистрах
+    chunk_stats_t s = {0, 0, INT_MAX, INT_MIN};
+    size_t token_start = 0;
+    bool in_token = false, token_clean = true;
+    int value;
+    for (size_t base = 0; base < len; base += 64) {
+        char window[64];
+        uint64_t space, digit;
+        classify64(chunk_window(p,len,base,window),&space,&digit);
+        bool clean = 0 == ~(space | digit);
+
+        uint64_t not_space = ~space;
+        uint64_t prev_not_space = not_space << 1 | (in_token ? 1u : 0u);
+        uint64_t starts = not_space & ~prev_not_space;
+        uint64_t ends = space & prev_not_space;
+        if (in_token) token_clean = token_clean && clean;
+
+        for (uint64_t events = starts | ends; 0 != events; events &= events - 1) {
+            unsigned bit = (unsigned)__builtin_ctzll(events);
+            if (starts >> bit & 1u) {
+                token_start = base + bit;
+                in_token = true;
+                token_clean = clean;
+                continue;
+            }
+            in_token = false;
+            if (!parse_int_token(p + token_start,base + bit - token_start,token_clean,&value)) {
+                *error_pos = token_start;
+                *stats = s;
+                return false;
+            }
+            if (NULL != out) out[s.count] = value;
+            s = chunk_stats_add(s,value);
+        }
+    }
+    if (in_token) { //кусок кончается числом ровно на границе окна
+        if (!parse_int_token(p + token_start,len - token_start,token_clean,&value)) {
+            *error_pos = token_start;
+            *stats = s;
+            return false;
+        }
+        if (NULL != out) out[s.count] = value;
+        s = chunk_stats_add(s,value);
+    }
+    *stats = s;
+    return true;
+}
+
+/**
+ * Размер куска. Как и в 47_parallel_harmonic_series.c, он не зависит от
+ * количества потоков: 4 МБ - достаточно много, чтобы расходы на запуск
+ * разбора куска были незаметны, и достаточно мало, чтобы работа
+ * распределялась между потоками равномерно.
+ * */
+#define MMAP_CHUNK (4u << 20)
+
+/**
+ * Границы кусков: bounds[idx] - начало куска idx, bounds[chunk_count] == size.
+ * Граница сдвигается вперёд, пока предыдущий символ не окажется пробельным.
+ * */
+static size_t *chunk_bounds(char const *data, size_t size, size_t *chunk_count) {
+    size_t count = (size + MMAP_CHUNK - 1) / MMAP_CHUNK;
+    size_t *bounds = malloc((count + 1) * sizeof(size_t));
+    if (NULL == bounds)
+        return NULL;
+    bounds[0] = 0;
+    for (size_t idx = 1; idx != count; ++idx) {
+        size_t pos = idx * (size_t)MMAP_CHUNK;
+        if (pos < bounds[idx - 1]) pos = bounds[idx - 1]; //предыдущее слово оказалось длиннее куска
+        while (pos < size && !is_space(data[pos - 1])) ++pos;
+        bounds[idx] = pos;
+    }
+    bounds[count] = size;
+    *chunk_count = count;
+    return bounds;
+}
+
+//данные, которые получает каждый поток
+typedef struct {
+    char const *data;
+    size_t const *bounds;
+    size_t chunk_count;
+    size_t thread_idx, thread_count;
+    bool count_only;        //первый проход: только посчитать слова
+    size_t *counts;         //количество слов в каждом куске
+    size_t const *offsets;  //смещение каждого куска в массиве out
+    int *out;               //NULL - только свёртка
+    chunk_stats_t *stats;   //свёртка каждого куска
+    size_t *error_pos;      //место ошибки в каждом куске, SIZE_MAX - ошибки нет
+} parse_task_t;
+
+void *parse_worker(void *arg) {
+    parse_task_t *task = arg;
+    for (size_t chunk = task->thread_idx; chunk < task->chunk_count; chunk += task->thread_count) {
+        char const *p = task->data + task->bounds[chunk];
+        size_t len = task->bounds[chunk + 1] - task->bounds[chunk];
+        if (task->count_only) {
+            task->counts[chunk] = count_chunk_tokens(p,len);
+            continue;
+        }
+        task->error_pos[chunk] = SIZE_MAX;
+        parse_chunk(p,len,NULL == task->out ? NULL : task->out + task->offsets[chunk],task->stats + chunk,task->error_pos + chunk);
+    }
+    return NULL;
+}
+
+/**
+ * Запуск parse_worker в thread_count потоках, как в parallel_harmonic_sum:
+ * нулевую задачу выполняем сами, задачи потоков, которые не удалось
+ * запустить, - тоже сами.
+ * */
+static void run_parse_workers(parse_task_t *tasks, pthread_t *threads, size_t thread_count) {
+    size_t started = 1;
+    for (; started != thread_count; ++started)
+        if (0 != pthread_create(threads + started,NULL,parse_worker,tasks + started))
+            break;
+    parse_worker(tasks + 0);
+    for (size_t idx = 1; idx < started; ++idx)
+        pthread_join(threads[idx],NULL);
+    for (size_t idx = started; idx < thread_count; ++idx)
+        parse_worker(tasks + idx);
+}
+
+/**
+ * Разбор целых чисел из data[0, size) в thread_count потоков.
+ * Если numbers != NULL, в *numbers возвращается массив всех чисел
+ * (освобождается вызовом free), иначе вычисляется только свёртка *total.
+ * При ошибке формата, как и у fscanf, числа до ошибки прочитаны:
+ * их количество и свёртка - в *total, место ошибки - в *error_offset.
+ * */
+parse_status_t parallel_parse_ints(char const *data, size_t size, size_t thread_count,
+                                   int **numbers, chunk_stats_t *total, unsigned long long *error_offset) {
+    *total = (chunk_stats_t){0, 0, INT_MAX, INT_MIN};
+    if (NULL != numbers) *numbers = NULL;
+    if (0 == size)
+        return PARSE_OK;
+    if (0 == thread_count) thread_count = 1;
+
+    size_t chunk_count = 0;
+    size_t *bounds = chunk_bounds(data,size,&chunk_count);
+    if (thread_count > chunk_count) thread_count = chunk_count;
+    size_t *counts = malloc(chunk_count * sizeof(size_t));
+    size_t *offsets = malloc(chunk_count * sizeof(size_t));
+    size_t *error_pos = malloc(chunk_count * sizeof(size_t));
+    chunk_stats_t *stats = malloc(chunk_count * sizeof(chunk_stats_t));
+    parse_task_t *tasks = malloc(thread_count * sizeof(parse_task_t));
+    pthread_t *threads = malloc(thread_count * sizeof(pthread_t));
+    int *out = NULL;
+    parse_status_t status = PARSE_NO_MEMORY;
+    if (NULL == bounds || NULL == counts || NULL == offsets || NULL == error_pos ||
+        NULL == stats || NULL == tasks || NULL == threads)
+        goto CLEAR;
+
+    for (size_t idx = 0; idx != thread_count; ++idx)
+        tasks[idx] = (parse_task_t){data, bounds, chunk_count, idx, thread_count, true, counts, offsets, NULL, stats, error_pos};
+
+    if (NULL != numbers) {
+        run_parse_workers(tasks,threads,thread_count); //первый проход
+        size_t count = 0;
+        for (size_t chunk = 0; chunk != chunk_count; ++chunk) {
+            offsets[chunk] = count;
+            count += counts[chunk];
+        }
+        out = malloc((count > 0 ? count : 1) * sizeof(int));
+        if (NULL == out)
+            goto CLEAR;
+    }
+    for (size_t idx = 0; idx != thread_count; ++idx) {
+        tasks[idx].count_only = false;
+        tasks[idx].out = out;
+    }
+    run_parse_workers(tasks,threads,thread_count); //второй проход
+
+    //свёртка по кускам до первой ошибки: её результат не зависит от количества потоков
+    status = PARSE_OK;
+    for (size_t chunk = 0; chunk != chunk_count; ++chunk) {
+        total->count += stats[chunk].count;
+        total->sum += stats[chunk].sum;
+        if (stats[chunk].min < total->min) total->min = stats[chunk].min;
+        if (stats[chunk].max > total->max) total->max = stats[chunk].max;
+        if (SIZE_MAX != error_pos[chunk]) {
+            *error_offset = bounds[chunk] + error_pos[chunk];
+            status = PARSE_FORMAT_ERROR;
+            break;
+        }
+    }
+    if (NULL != numbers) {
+        *numbers = out;
+        out = NULL;
+    }
+
+CLEAR:
+    free(out);
+    free(threads);
+    free(tasks);
+    free(stats);
+    free(error_pos);
+    free(offsets);
+    free(counts);
+    free(bounds);
+    return status;
+}
+
+/**
+ * Разбор файла целиком: отображение в память, разбор, освобождение отображения.
+ * */
+parse_status_t parallel_parse_file(char const *path, size_t thread_count,
+                                   int **numbers, chunk_stats_t *total, unsigned long long *error_offset) {
+    mapped_file_t file;
+    if (!map_file(path,&file)) {
+        *total = (chunk_stats_t){0, 0, INT_MAX, INT_MIN};
+        if (NULL != numbers) *numbers = NULL;
+        return PARSE_IO_ERROR;
+    }
+    parse_status_t status = parallel_parse_ints(file.data,file.size,thread_count,numbers,total,error_offset);
+    unmap_file(&file);
+    return status;
+}
+
+double seconds_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec + ts.tv_nsec * 1.e-9;
+}
+
+static void print_parse_result(parse_status_t status, chunk_stats_t const *total, unsigned long long error_offset) {
+    printf("%zu numbers been read, sum %lld",total->count,total->sum);
+    if (0 != total->count)
+        printf(", min %d, max %d",total->min,total->max);
+    printf("\n");
+    if (PARSE_FORMAT_ERROR == status)
+        printf("Input format error at byte %llu!\n",error_offset);
+    else if (PARSE_IO_ERROR == status)
+        printf("Can't open file to read!\n");
+    else if (PARSE_NO_MEMORY == status)
+        printf("Can't allocate memory!\n");
+}
+
+/**
+ * Файл как в fast_parsing_vs_fscanf_test (числа rand()%100 по одному в строке)
+ * разбирается в массив и свёрткой при разном количестве потоков.
+ * Второй и последующие замеры идут по файлу, который уже в кэше страниц.
+ * */
+void mmap_parallel_parsing_test() {
+    unsigned const how_many = 20000000u;
+    FILE *descriptor = fopen("./new_file.txt","w");
+    if (NULL == descriptor) {
+        printf("Can't open file!\n");
+        return;
+    }
+    srand(23);
+    for (unsigned count = 0; count != how_many; ++count)
+        fprintf(descriptor,"%d\n",rand()%100);
+    if (ferror(descriptor)) {
+        printf("Error in printing data to file!\n");
+        fclose(descriptor);
+        return;
+    }
+    fclose(descriptor);
+
+    mapped_file_t file;
+    if (!map_file("./new_file.txt",&file)) {
+        printf("Can't open file to read!\n");
+        return;
+    }
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t thread_counts[4] = {1, 2, 4, cores > 0 ? (size_t)cores : 1};
+    unsigned long long first_checksum = 0;
+    printf("threads   array, MB/s   reduction, MB/s\n");
+    for (unsigned idx = 0; idx != 4; ++idx) {
+        int *numbers;
+        chunk_stats_t total, reduced;
+        unsigned long long error_offset = 0;
+        double start = seconds_now();
+        parse_status_t status = parallel_parse_ints(file.data,file.size,thread_counts[idx],&numbers,&total,&error_offset);
+        double array_seconds = seconds_now() - start;
+        if (PARSE_OK != status) {
+            print_parse_result(status,&total,error_offset);
+            free(numbers);
+            break;
+        }
+        start = seconds_now();
+        status = parallel_parse_ints(file.data,file.size,thread_counts[idx],NULL,&reduced,&error_offset);
+        double reduce_seconds = seconds_now() - start;
+        if (PARSE_OK != status) {
+            print_parse_result(status,&reduced,error_offset);
+            free(numbers);
+            break;
+        }
+
+        //контрольная сумма массива с учётом порядка чисел (unsigned: переполнение - по модулю 2^64)
+        unsigned long long checksum = 0;
+        for (size_t pos = 0; pos != total.count; ++pos)
+            checksum = checksum * 31 + (unsigned long long)numbers[pos];
+        if (0 == idx) first_checksum = checksum;
+        bool same = checksum == first_checksum && total.count == how_many &&
+                    reduced.count == total.count && reduced.sum == total.sum;
+        printf("%7zu %13.1f %17.1f %s\n",thread_counts[idx],file.size / array_seconds / 1.e6,
+               file.size / reduce_seconds / 1.e6,same ? "" : "RESULTS DIFFER!");
+        free(numbers);
+    }
+    unmap_file(&file);
+}
+
+/**
+ * Ошибки формата: те же файлы, что и в fast_parsing_errors_test.
+ * */
+void mmap_parsing_errors_test() {
+    char const *contents[6] = {"1 2 3\n-4 +5\n", "10 20 x 30\n", "1 2 99999999999\n", "7 8 -\n", "-2147483648 2147483647 0000000000000042", ""};
+    for (unsigned idx = 0; idx != 6; ++idx) {
+        FILE *descriptor = fopen("./new_file.txt","w");
+        if (NULL == descriptor) {
+            printf("Can't open file!\n");
+            return;
+        }
+        fputs(contents[idx],descriptor);
+        fclose(descriptor);
+
+        chunk_stats_t total;
+        unsigned long long error_offset = 0;
+        parse_status_t status = parallel_parse_file("./new_file.txt",4,NULL,&total,&error_offset);
+        print_parse_result(status,&total,error_offset);
+    }
+}
+
+/**
+ * Свёртка файла произвольного размера: массив не создаётся,
+ * поэтому объём файла ограничен только адресным пространством.
+ * */
+void mmap_parse_huge_file_test() {
+    char path[256];
+    size_t thread_count;
+    printf("Enter file name and number of threads:"); fflush(stdout);
+    if (2 != scanf("%255s%zu",path,&thread_count)) {
+        printf("Input format error!\n");
+        return;
+    }
+
+    chunk_stats_t total;
+    unsigned long long error_offset = 0;
+    double start = seconds_now();
+    parse_status_t status = parallel_parse_file(path,thread_count,NULL,&total,&error_offset);
+    double seconds = seconds_now() - start;
+    print_parse_result(status,&total,error_offset);
+    printf("%.3f s, %.1f M numbers/s\n",seconds,total.count / seconds / 1.e6);
+}
+
+int main() {
+    if (false) mmap_parallel_parsing_test();
+    if (false) mmap_parsing_errors_test();
+    if (false) mmap_parse_huge_file_test();
+    return 0;
+}
@@ -0,0 +1,462 @@
+/**
+ * В function_infile_tabulation_test (42_files_ascii.c) таблица значений
+ * функции записывается в текстовый файл sin_tab.txt в формате "%f %e"
+ * и читается обратно функцией fscanf. У текстового формата два недостатка:
+ * 1) он медленный - каждое число переводится из двоичного вида в текст
+ *    и обратно;
+ * 2) он теряет точность - "%f" оставляет 6 знаков после запятой,
+ *    а "%e" - 7 значащих цифр, тогда как float требует 9, а double - 17.
+ *
+ * Двоичный формат хранит числа так же, как они лежат в памяти.
+ * Файл таблицы состоит из:
+ * - заголовка фиксированного размера: сигнатура, версия, тип чисел,
+ *   количество точек, диапазон аргумента, смещения столбцов;
+ * - столбца аргументов - count чисел подряд;
+ * - столбца значений - count чисел подряд.
+ * Столбцы выровнены на 64 байта. Если отобразить файл в память (см.
+ * 53_mmap_parallel_parsing.c), то столбцы можно использовать на месте,
+ * как обычные массивы float или double, без всякого разбора.
+ *
+ * Числа записываются в порядке байтов того процессора, на котором работает
+ * программа (на x86 - от младшего к старшему). Поле byte_order позволяет
+ * распознать файл, записанный на процессоре с другим порядком байтов.
+ *
+ * Компиляция:
+ * gcc 54_binary_function_table.c -o table -std=c99 -O2 -lm
+ * */
+
+#define _DEFAULT_SOURCE //mmap clock_gettime
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>   //malloc realloc free
+#include <stdint.h>   //uint32_t uint64_t
+#include <string.h>   //memcmp memcpy
+#include <math.h>     //sin fabs
+#include <time.h>     //clock_gettime
+#include <fcntl.h>    //open
+#include <unistd.h>   //close
+#include <sys/mman.h> //mmap munmap
+#include <sys/stat.h> //fstat
+
+typedef enum {
+    TABLE_FLOAT32 = 1,
+    TABLE_FLOAT64 = 2
+} table_dtype_t;
+
+typedef enum {
+    TABLE_OK,
+    TABLE_IO_ERROR,     //файл не удалось открыть, прочитать или записать
+    TABLE_FORMAT_ERROR, //файл не является таблицей или повреждён
+    TABLE_NO_MEMORY
+} table_status_t;
+
+#define TABLE_MAGIC "FUNCTAB"     //8 байт вместе с завершающим нулём
+#define TABLE_VERSION 1u
+#define TABLE_BYTE_ORDER 0x01020304u
+#define TABLE_ALIGN 64u
+
+/**
+ * Заголовок файла - ровно 64 байта. Поля упорядочены так, чтобы между
+ * ними не было выравнивающих пропусков, иначе размер структуры зависел бы от компилятора.
+ * */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t dtype;
+    uint32_t reserved;
+    uint64_t count;
+    double arg_begin, arg_end;  //аргументы первой и последней точки
+    uint64_t args_offset;       //смещение столбцов от начала файла
+    uint64_t values_offset;
+} table_header_t;
+
+typedef char table_header_size_check[sizeof(table_header_t) == 64 ? 1 : -1]; //ошибка компиляции, если размер не 64
+
+static size_t table_dtype_size(uint32_t dtype) {
+    return TABLE_FLOAT32 == dtype ? sizeof(float) : TABLE_FLOAT64 == dtype ? sizeof(double) : 0;
+}
+
+static uint64_t table_align(uint64_t offset) {
+    return (offset + TABLE_ALIGN - 1) / TABLE_ALIGN * TABLE_ALIGN;
+}
+
+static double table_element(void const *column, table_dtype_t dtype, size_t idx) {
+    return TABLE_FLOAT32 == dtype ? ((float const *)column)[idx] : ((double const *)column)[idx];
+}
+
+/**
+ * Запись таблицы из count точек: args и values - массивы float или double в
+ * зависимости от dtype. Ошибка потока проверяется один раз в конце: ferror
+ * "запоминает" ошибку любой предыдущей операции.
+ * */
+table_status_t table_write(char const *path, table_dtype_t dtype, size_t count, void const *args, void const *values) {
+    size_t element_size = table_dtype_size(dtype);
+    if (0 == element_size)
+        return TABLE_FORMAT_ERROR;
+
+    table_header_t header = {TABLE_MAGIC, TABLE_VERSION, TABLE_BYTE_ORDER, dtype, 0, count, 0., 0., 0, 0};
+    if (0 != count) {
+        header.arg_begin = table_element(args,dtype,0);
+        header.arg_end = table_element(args,dtype,count - 1);
+    }
+    header.args_offset = table_align(sizeof(table_header_t));
+    header.values_offset = table_align(header.args_offset + count * element_size);
+
+    FILE *out_stream = fopen(path,"wb");
+    if (NULL == out_stream)
+        return TABLE_IO_ERROR;
+    static char const zeros[TABLE_ALIGN] = {0};
+    uint64_t padding = header.values_offset - (header.args_offset + count * element_size);
+    fwrite(&header,sizeof(header),1,out_stream);
+    fwrite(zeros,1,header.args_offset - sizeof(header),out_stream);
+    fwrite(args,element_size,count,out_stream);
+    fwrite(zeros,1,padding,out_stream);
+    fwrite(values,element_size,count,out_stream);
+    bool failed = ferror(out_stream);
+    failed = 0 != fclose(out_stream) || failed; //fclose записывает остаток буфера и тоже может завершиться ошибкой
+    return failed ? TABLE_IO_ERROR : TABLE_OK;
+}
+
+/**
+ * Таблица, отображённая в память. args и values указывают прямо внутрь
+ * отображения и действительны до вызова table_close.
+ * */
+typedef struct {
+    void *mapping;
+    size_t mapping_size;
+    table_dtype_t dtype;
+    size_t count;
+    double arg_begin, arg_end;
+    void const *args, *values;
+} table_t;
+
+/**
+ * Открытие таблицы. Заголовок проверяется полностью: файл мог быть
+ * обрезан или записан другой программой, а обращение за пределы
+ * отображения завершило бы программу сигналом SIGBUS или SIGSEGV.
+ * */
+table_status_t table_open(char const *path, table_t *table) {
+    *table = (table_t){NULL, 0, TABLE_FLOAT32, 0, 0., 0., NULL, NULL};
+    int fd = open(path,O_RDONLY);
+    if (fd < 0)
+        return TABLE_IO_ERROR;
+    struct stat st;
+    if (0 != fstat(fd,&st)) {
+        close(fd);
+        return TABLE_IO_ERROR;
+    }
+    if ((uint64_t)st.st_size < sizeof(table_header_t)) {
+        close(fd);
+        return TABLE_FORMAT_ERROR;
+    }
+    void *mapping = mmap(NULL,(size_t)st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+    close(fd);
+    if (MAP_FAILED == mapping)
+        return TABLE_IO_ERROR;
+
+    table_header_t header;
+    memcpy(&header,mapping,sizeof(header));
+    uint64_t size = (uint64_t)st.st_size;
+    size_t element_size = table_dtype_size(header.dtype);
+    bool valid = 0 == memcmp(header.magic,TABLE_MAGIC,sizeof(header.magic)) &&
+                 TABLE_VERSION == header.version && TABLE_BYTE_ORDER == header.byte_order &&
+                 0 != element_size &&
+                 0 == header.args_offset % TABLE_ALIGN && 0 == header.values_offset % TABLE_ALIGN &&
+                 header.args_offset >= sizeof(header) && header.args_offset <= size && header.values_offset <= size &&
+                 //сравнение делением, а не умножением: count * element_size может переполниться
+                 header.count <= (size - header.args_offset) / element_size &&
+                 header.count <= (size - header.values_offset) / element_size;
+    if (!valid) {
+        munmap(mapping,(size_t)st.st_size);
+        return TABLE_FORMAT_ERROR;
+    }
+
+    char const *bytes = mapping;
+    *table = (table_t){mapping, (size_t)st.st_size, (table_dtype_t)header.dtype, (size_t)header.count,
+                       header.arg_begin, header.arg_end, bytes + header.args_offset, bytes + header.values_offset};
+    return TABLE_OK;
+}
+
+void table_close(table_t *table) {
+    if (NULL != table->mapping)
+        munmap(table->mapping,table->mapping_size);
+    *table = (table_t){NULL, 0, TABLE_FLOAT32, 0, 0., 0., NULL, NULL};
+}
+
+/**
+ * Конвертер sin_tab.txt -> двоичная таблица. Текст читается так же,
+ * как в function_infile_tabulation_test, но в переменные double ("%lf %le"),
+ * чтобы при dtype == TABLE_FLOAT64 не терять точность текста.
+ * */
+table_status_t table_from_text(char const *text_path, char const *table_path, table_dtype_t dtype) {
+    size_t element_size = table_dtype_size(dtype);
+    if (0 == element_size)
+        return TABLE_FORMAT_ERROR;
+    FILE *in_stream = fopen(text_path,"r");
+    if (NULL == in_stream)
+        return TABLE_IO_ERROR;
+
+    size_t count = 0, capacity = 1024;
+    char *args = malloc(capacity * element_size), *values = malloc(capacity * element_size);
+    table_status_t status = TABLE_NO_MEMORY;
+    if (NULL == args || NULL == values)
+        goto CLEAR;
+
+    double arg, val;
+    while (2 == fscanf(in_stream,"%lf %le",&arg,&val)) {
+        if (count == capacity) { //массивы растут вдвое, как в 33_dynamic_memory.c
+            capacity *= 2;
+            char *new_args = realloc(args,capacity * element_size);
+            if (NULL == new_args) goto CLEAR;
+            args = new_args;
+            char *new_values = realloc(values,capacity * element_size);
+            if (NULL == new_values) goto CLEAR;
+            values = new_values;
+        }
+        if (TABLE_FLOAT32 == dtype) {
+            ((float *)args)[count] = (float)arg;
+            ((float *)values)[count] = (float)val;
+        } else {
+            ((double *)args)[count] = arg;
+            ((double *)values)[count] = val;
+        }
+        ++count;
+    }
+    if (ferror(in_stream))
+        status = TABLE_IO_ERROR;
+    else if (!feof(in_stream))
+        status = TABLE_FORMAT_ERROR; //файл прочитан не до конца: в нём встретилось не число
+    else
+        status = table_write(table_path,dtype,count,args,values);
+
+CLEAR:
+    free(values);
+    free(args);
+    fclose(in_stream);
+    return status;
+}
+
+/**
+ * Конвертер двоичная таблица -> текст. format - формат одной строки,
+ * например "%f %e\n" для совместимости с sin_tab.txt или "%.17g %.17g\n"
+ * для записи без потери точности.
+ * */
+table_status_t table_to_text(char const *table_path, char const *text_path, char const *format) {
+    table_t table;
+    table_status_t status = table_open(table_path,&table);
+    if (TABLE_OK != status)
+        return status;
+    FILE *out_stream = fopen(text_path,"w");
+    if (NULL == out_stream) {
+        table_close(&table);
+        return TABLE_IO_ERROR;
+    }
+    for (size_t idx = 0; idx != table.count; ++idx)
+        fprintf(out_stream,format,table_element(table.args,table.dtype,idx),table_element(table.values,table.dtype,idx));
+    bool failed = ferror(out_stream);
+    failed = 0 != fclose(out_stream) || failed;
+    table_close(&table);
+    return failed ? TABLE_IO_ERROR : TABLE_OK;
+}
+
+static void print_table_status(table_status_t status) {
+    if (TABLE_IO_ERROR == status)
+        printf("File stream error!\n");
+    else if (TABLE_FORMAT_ERROR == status)
+        printf("Input format error!\n");
+    else if (TABLE_NO_MEMORY == status)
+        printf("Can't allocate memory!\n");
+}
+
+/**
+ * Аналог function_infile_tabulation_test: та же таблица синуса,
+ * записанная в двоичном виде и прочитанная через отображение в память.
+ * */
+void function_binary_tabulation_test() {
+    float args[101], values[101];
+    float arg_begin = 0.f, step = 3.14159265f/100.f;
+    for (unsigned counter = 0; counter != 101; ++counter) {
+        args[counter] = arg_begin + step*counter;
+        values[counter] = sinf(args[counter]);
+    }
+    table_status_t status = table_write("./sin_tab.bin",TABLE_FLOAT32,101,args,values);
+    if (TABLE_OK != status) {
+        print_table_status(status);
+        return;
+    }
+
+    table_t table;
+    status = table_open("./sin_tab.bin",&table);
+    if (TABLE_OK != status) {
+        print_table_status(status);
+        return;
+    }
+    float const *arg = table.args, *val = table.values; //никакого разбора: столбцы - обычные массивы
+    for (size_t idx = 0; idx != table.count; ++idx)
+        printf("sin(%f) = %e\n",arg[idx],val[idx]);
+    printf("%zu points on [%f, %f]\n",table.count,table.arg_begin,table.arg_end);
+    table_close(&table);
+}
+
+/**
+ * Круговое преобразование sin_tab.txt -> sin_tab.bin -> sin_tab_copy.txt.
+ * Текст в формате "%f %e" совпадает с исходным байт в байт.
+ * */
+void table_text_conversion_test() {
+    table_status_t status = table_from_text("./sin_tab.txt","./sin_tab.bin",TABLE_FLOAT64);
+    if (TABLE_OK == status)
+        status = table_to_text("./sin_tab.bin","./sin_tab_copy.txt","%f %e\n");
+    if (TABLE_OK != status) {
+        print_table_status(status);
+        return;
+    }
+    FILE *a = fopen("./sin_tab.txt","r"), *b = fopen("./sin_tab_copy.txt","r");
+    if (NULL == a || NULL == b) {
+        printf("Can't open file to read!\n");
+        if (NULL != a) fclose(a);
+        if (NULL != b) fclose(b);
+        return;
+    }
+    int ca, cb;
+    do {
+        ca = fgetc(a);
+        cb = fgetc(b);
+    } while (ca == cb && EOF != ca);
+    printf("%s\n",ca == cb ? "text files are identical" : "TEXT FILES DIFFER!");
+    fclose(b);
+    fclose(a);
+}
+
+double seconds_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec + ts.tv_nsec * 1.e-9;
+}
+
+/**
+ * Сравнение скорости и точности: 10 миллионов точек sin(x) типа double
+ * записываются и читаются в текстовом формате "%f %e" и в двоичном.
+ * Для двоичной таблицы "чтение" - это отображение файла и один проход
+ * по столбцу значений (сумма нужна, чтобы данные действительно были прочитаны).
+ * */
+void table_speed_test() {
+    size_t const count = 10000000u;
+    double *args = malloc(count * sizeof(double)), *values = malloc(count * sizeof(double));
+    if (NULL == args || NULL == values) {
+        printf("Can't allocate memory!\n");
+        goto CLEAR;
+    }
+    double const step = 3.14159265358979323846 / count;
+    for (size_t idx = 0; idx != count; ++idx) {
+        args[idx] = step * idx;
+        values[idx] = sin(args[idx]);
+    }
+
+    //текст
+    double start = seconds_now();
+    FILE *out_stream = fopen("./sin_tab.txt","w");
+    if (NULL == out_stream) {
+        printf("Can't open file to write!\n");
+        goto CLEAR;
+    }
+    for (size_t idx = 0; idx != count; ++idx)
+        fprintf(out_stream,"%f %e\n",args[idx],values[idx]);
+    bool failed = ferror(out_stream);
+    failed = 0 != fclose(out_stream) || failed;
+    if (failed) {
+        printf("File stream error!\n");
+        goto CLEAR;
+    }
+    double text_write = seconds_now() - start;
+
+    start = seconds_now();
+    FILE *in_stream = fopen("./sin_tab.txt","r");
+    if (NULL == in_stream) {
+        printf("Can't open file to read!\n");
+        goto CLEAR;
+    }
+    double arg, val, text_error = 0.;
+    size_t text_count = 0;
+    while (2 == fscanf(in_stream,"%lf %le",&arg,&val)) {
+        double err = fabs(val - values[text_count]);
+        if (err > text_error) text_error = err;
+        ++text_count;
+    }
+    fclose(in_stream);
+    double text_read = seconds_now() - start;
+
+    //двоичная таблица
+    start = seconds_now();
+    table_status_t status = table_write("./sin_tab.bin",TABLE_FLOAT64,count,args,values);
+    if (TABLE_OK != status) {
+        print_table_status(status);
+        goto CLEAR;
+    }
+    double binary_write = seconds_now() - start;
+
+    start = seconds_now();
+    table_t table;
+    status = table_open("./sin_tab.bin",&table);
+    if (TABLE_OK != status) {
+        print_table_status(status);
+        goto CLEAR;
+    }
+    double const *val_column = table.values;
+    double binary_error = 0.;
+    for (size_t idx = 0; idx != table.count; ++idx) {
+        double err = fabs(val_column[idx] - values[idx]);
+        if (err > binary_error) binary_error = err;
+    }
+    size_t binary_count = table.count;
+    table_close(&table);
+    double binary_read = seconds_now() - start;
+
+    printf("format   points     write, s   read, s   max error\n");
+    printf("text   %9zu %10.3f %9.3f   %.3e\n",text_count,text_write,text_read,text_error);
+    printf("binary %9zu %10.3f %9.3f   %.3e\n",binary_count,binary_write,binary_read,binary_error);
+    printf("speedup: write x%.0f, read x%.0f\n",text_write / binary_write,text_read / binary_read);
+
+CLEAR:
+    free(values);
+    free(args);
+}
+
+/**
+ * Повреждённые файлы должны распознаваться, а не приводить к аварийному завершению.
+ * */
+void table_format_errors_test() {
+    FILE *out_stream = fopen("./sin_tab.bin","wb");
+    if (NULL == out_stream) {
+        printf("Can't open file to write!\n");
+        return;
+    }
+    fputs("0.000000 0.000000e+00\n",out_stream); //текст вместо двоичной таблицы
+    fclose(out_stream);
+    table_t table;
+    print_table_status(table_open("./sin_tab.bin",&table));
+
+    double args[1000], values[1000];
+    for (unsigned idx = 0; idx != 1000; ++idx) {
+        args[idx] = idx;
+        values[idx] = idx * 0.5;
+    }
+    if (TABLE_OK != table_write("./sin_tab.bin",TABLE_FLOAT64,1000,args,values)) {
+        printf("File stream error!\n");
+        return;
+    }
+    if (0 != truncate("./sin_tab.bin",4096)) { //обрезанный файл: столбец значений не помещается
+        printf("File stream error!\n");
+        return;
+    }
+    print_table_status(table_open("./sin_tab.bin",&table));
+}
+
+int main() {
+    if (false) function_binary_tabulation_test();
+    if (false) table_text_conversion_test();
+    if (false) table_speed_test();
+    if (false) table_format_errors_test();
+    return 0;
+}
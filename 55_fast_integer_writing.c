@@ -0,0 +1,326 @@
+/**
+ * Продолжение 52_fast_integer_parsing.c - теперь запись чисел.
+ * В random_numbers_file_write_test (42_files_ascii.c) каждое число
+ * записывается вызовом fprintf(descriptor,"%d\n",...) и проверяется ferror.
+ * fprintf при каждом вызове разбирает строку формата, блокирует поток
+ * (на случай, если в файл пишут несколько потоков выполнения) и переводит
+ * число в текст делением на 10 по одной цифре.
+ *
+ * Собственная запись целых чисел:
+ * 1) числа переводятся в текст прямо в большой буфер в памяти программы;
+ * 2) перевод идёт по две цифры сразу: остаток от деления на 100 служит
+ *    индексом в таблице из двухсимвольных строк "00", "01", ..., "99",
+ *    так что делений вдвое меньше;
+ * 3) заполненный буфер записывается в файл одним системным вызовом write,
+ *    и только тогда проверяется ошибка - одна проверка на мегабайт текста.
+ *
+ * Компиляция:
+ * gcc 55_fast_integer_writing.c -o write -std=c99 -O2
+ * */
+
+#define _POSIX_C_SOURCE 200809L //clock_gettime
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>  //malloc free rand
+#include <stdint.h>  //uint32_t
+#include <string.h>  //memcpy
+#include <limits.h>  //INT_MIN INT_MAX
+#include <errno.h>   //errno EINTR
+#include <time.h>    //clock_gettime
+#include <fcntl.h>   //open
+#include <unistd.h>  //write close
+
+#define INT_WRITER_BUFFER (1u << 20) //записываем файл блоками по мегабайту
+#define INT_MAX_CHARS 12u            //"-2147483648" и разделитель
+
+typedef struct {
+    int fd;
+    char *buf;
+    size_t used;
+    bool failed;                  //ошибка записи уже была, дальнейшие числа не записываются
+    unsigned long long flushed;   //сколько байт уже записано в файл
+} int_writer_t;
+
+/**
+ * Открытие файла на запись. Файл создаётся заново, как fopen(path,"w").
+ * */
+bool int_writer_open(int_writer_t *w, char const *path) {
+    *w = (int_writer_t){-1, malloc(INT_WRITER_BUFFER), 0, false, 0};
+    if (NULL == w->buf)
+        return false;
+    w->fd = open(path,O_WRONLY | O_CREAT | O_TRUNC,0644);
+    if (w->fd < 0) {
+        free(w->buf);
+        w->buf = NULL;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Запись содержимого буфера. write может записать меньше, чем просили
+ * (например, если диск почти заполнен или вызов прерван сигналом),
+ * поэтому вызываем его, пока не запишем всё или не получим ошибку.
+ * */
+bool int_writer_flush(int_writer_t *w) {
+    size_t done = 0;
+    while (!w->failed && done != w->used) {
+        ssize_t res = write(w->fd,w->buf + done,w->used - done);
+        if (res < 0 && EINTR == errno)
+            continue;
+        if (res <= 0)
+            w->failed = true;
+        else
+            done += (size_t)res;
+    }
+    w->flushed += done;
+    w->used = 0;
+    return !w->failed;
+}
+
+/**
+ * Запись остатка буфера и закрытие файла. Возвращает false,
+ * если при любой записи произошла ошибка.
+ * */
+bool int_writer_close(int_writer_t *w) {
+    bool success = int_writer_flush(w);
+    success = 0 == close(w->fd) && success;
+    free(w->buf);
+    *w = (int_writer_t){-1, NULL, 0, true, w->flushed};
+    return success;
+}
+
+static char const digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static unsigned decimal_length(uint32_t v) {
+    if (v < 10u) return 1;
+    if (v < 100u) return 2;
+    if (v < 1000u) return 3;
+    if (v < 10000u) return 4;
+    if (v < 100000u) return 5;
+    if (v < 1000000u) return 6;
+    if (v < 10000000u) return 7;
+    return 8;
+}
+
+/**
+ * Ровно 8 цифр числа v < 10^8 с ведущими нулями. Четыре пары цифр
+ * вычисляются независимо друг от друга, и процессор считает их одновременно.
+ * */
+static void format_8_digits(char *p, uint32_t v) {
+    uint32_t high = v / 10000u, low = v % 10000u;
+    memcpy(p,digit_pairs + 2 * (high / 100u),2);
+    memcpy(p + 2,digit_pairs + 2 * (high % 100u),2);
+    memcpy(p + 4,digit_pairs + 2 * (low / 100u),2);
+    memcpy(p + 6,digit_pairs + 2 * (low % 100u),2);
+}
+
+/**
+ * Перевод числа в текст, начиная с p. Длина известна заранее, поэтому
+ * цифры пишутся сразу на свои места справа налево, без разворота строки.
+ * У чисел из 9-10 цифр последние 8 цифр переводятся format_8_digits:
+ * в цикле каждое деление на 100 ждало бы результата предыдущего.
+ * Возвращает указатель на символ после числа.
+ * */
+static char *format_uint(char *p, uint32_t v) {
+    if (v >= 100000000u) {
+        uint32_t high = v / 100000000u; //от 1 до 42
+        if (high >= 10u) {
+            memcpy(p,digit_pairs + 2 * high,2);
+            p += 2;
+        } else {
+            *p++ = (char)('0' + high);
+        }
+        format_8_digits(p,v % 100000000u);
+        return p + 8;
+    }
+    unsigned len = decimal_length(v);
+    char *end = p + len;
+    while (v >= 100u) {
+        unsigned pair = v % 100u;
+        v /= 100u;
+        end -= 2;
+        memcpy(end,digit_pairs + 2 * pair,2);
+    }
+    if (v >= 10u)
+        memcpy(end - 2,digit_pairs + 2 * v,2);
+    else
+        end[-1] = (char)('0' + v);
+    return p + len;
+}
+
+/**
+ * Знак обрабатывается без ветвления: '-' записывается всегда, но указатель
+ * сдвигается, только если число отрицательное. Для случайных чисел ветвление
+ * по знаку процессор угадывал бы лишь в половине случаев.
+ * */
+static char *format_int(char *p, int value) {
+    uint32_t negative = value < 0;
+    *p = '-';
+    p += negative;
+    uint32_t v = (uint32_t)value;
+    v = (v ^ (0u - negative)) + negative; //-v без знака: для INT_MIN -value переполнило бы int
+    return format_uint(p,v);
+}
+
+/**
+ * Запись числа и разделителя (например, '\n' или ' ').
+ * Функция объявлена static inline в расчёте на встраивание в цикл записи.
+ * */
+static inline bool int_writer_put(int_writer_t *w, int value, char separator) {
+    if (INT_WRITER_BUFFER - w->used < INT_MAX_CHARS && !int_writer_flush(w))
+        return false;
+    char *end = format_int(w->buf + w->used,value);
+    *end++ = separator;
+    w->used = (size_t)(end - w->buf);
+    return true;
+}
+
+/**
+ * Запись массива чисел. Ошибка проверяется только при сбросе буфера.
+ * */
+bool int_writer_put_array(int_writer_t *w, int const *values, size_t count, char separator) {
+    for (size_t idx = 0; idx != count; ++idx)
+        if (!int_writer_put(w,values[idx],separator))
+            return false;
+    return true;
+}
+
+double seconds_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec + ts.tv_nsec * 1.e-9;
+}
+
+/**
+ * Аналог random_numbers_file_write_test: количество чисел задаёт пользователь.
+ * */
+void random_numbers_fast_write_test() {
+    srand(23);
+    int_writer_t writer;
+    if (!int_writer_open(&writer,"./new_file.txt")) {
+        printf("Can't open file!\n");
+        return;
+    }
+
+    long long how_many;
+    if (1 != scanf("%lld",&how_many)) {
+        printf("Input format error!\n");
+        int_writer_close(&writer);
+        return;
+    }
+
+    double start = seconds_now();
+    for (long long count = 0; count < how_many; ++count)
+        if (!int_writer_put(&writer,rand()%100,'\n'))
+            break;
+    if (!int_writer_close(&writer)) {
+        printf("Error in printing data to file!\nProcess terminated!\n");
+        return;
+    }
+    double seconds = seconds_now() - start;
+    printf("%llu bytes in %.3f s, %.1f M numbers/s\n",writer.flushed,seconds,how_many / seconds / 1.e6);
+}
+
+/**
+ * Сравнение с fprintf. Числа генерируются заранее, чтобы в замер
+ * не попадало время работы rand(), одинаковое в обоих вариантах.
+ * Проверяются два набора: числа rand()%100, как в 42_files_ascii.c,
+ * и числа во всём диапазоне int.
+ * */
+void fast_writing_vs_fprintf_test() {
+    size_t const count = 20000000u;
+    int *values = malloc(count * sizeof(int));
+    if (NULL == values) {
+        printf("Can't allocate memory!\n");
+        return;
+    }
+
+    srand(23);
+    for (unsigned set = 0; set != 2; ++set) {
+        for (size_t idx = 0; idx != count; ++idx)
+            values[idx] = 0 == set ? rand()%100 : (int)((unsigned)rand() << 16 ^ (unsigned)rand());
+
+        double start = seconds_now();
+        FILE *descriptor = fopen("./new_file.txt","w");
+        if (NULL == descriptor) {
+            printf("Can't open file!\n");
+            break;
+        }
+        for (size_t idx = 0; idx != count; ++idx) {
+            fprintf(descriptor,"%d\n",values[idx]);
+            if (ferror(descriptor)) {
+                printf("Error in printing data to file!\nProcess terminated!\n");
+                break;
+            }
+        }
+        fclose(descriptor);
+        double fprintf_seconds = seconds_now() - start;
+
+        start = seconds_now();
+        int_writer_t writer;
+        if (!int_writer_open(&writer,"./new_file.txt")) {
+            printf("Can't open file!\n");
+            break;
+        }
+        int_writer_put_array(&writer,values,count,'\n');
+        if (!int_writer_close(&writer)) {
+            printf("Error in printing data to file!\nProcess terminated!\n");
+            break;
+        }
+        double writer_seconds = seconds_now() - start;
+
+        printf("%s: fprintf %.1f M numbers/s, writer %.1f M numbers/s, x%.1f\n",
+               0 == set ? "rand()%100" : "full int  ",count / fprintf_seconds / 1.e6,
+               count / writer_seconds / 1.e6,fprintf_seconds / writer_seconds);
+    }
+    free(values);
+}
+
+/**
+ * Проверка перевода в текст: граничные значения, все степени десяти
+ * и миллион случайных чисел сравниваются с результатом snprintf.
+ * */
+void format_int_test() {
+    int special[8] = {0, 1, -1, 9, -10, 99, INT_MAX, INT_MIN};
+    unsigned errors = 0;
+    char expected[INT_MAX_CHARS + 1], got[INT_MAX_CHARS + 1];
+    srand(55);
+    for (unsigned idx = 0; idx != 8 + 4 * 10 + 1000000; ++idx) {
+        int value;
+        if (idx < 8) {
+            value = special[idx];
+        } else if (idx >= 8 + 4 * 10) {
+            value = (int)((unsigned)rand() << 16 ^ (unsigned)rand());
+        } else { //10^k - 1, 10^k и их отрицательные значения
+            int power = 1;
+            for (unsigned k = 0; k != (idx - 8) / 4; ++k) power *= 10;
+            value = (idx % 2 ? power : power - 1) * ((idx / 2) % 2 ? -1 : 1);
+        }
+        snprintf(expected,sizeof(expected),"%d",value);
+        *format_int(got,value) = '\0';
+        if (0 != strcmp(expected,got)) {
+            printf("%s != %s\n",expected,got);
+            ++errors;
+        }
+    }
+    printf("%u errors\n",errors);
+}
+
+int main() {
+    if (false) random_numbers_fast_write_test();
+    if (false) fast_writing_vs_fprintf_test();
+    if (false) format_int_test();
+    return 0;
+}
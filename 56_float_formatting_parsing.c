@@ -0,0 +1,852 @@
+/**
+ * В function_infile_tabulation_test (42_files_ascii.c) таблица записывается
+ * в формате "%f %e" и читается fscanf("%f %e"). Прочитанные числа
+ * не совпадают с записанными: "%f" оставляет 6 знаков после запятой,
+ * "%e" - 7 значащих цифр. Формат "%.9g" для float ("%.17g" для double)
+ * сохраняет число точно, но печатает лишние цифры: 0.1f превращается
+ * в 0.100000001. К тому же printf и scanf медленные.
+ *
+ * Рассмотрим два алгоритма, которые используются в современных библиотеках:
+ *
+ * 1) Запись кратчайшим представлением (алгоритм Schubfach Р. Джулиетти,
+ *    того же семейства, что Ryu и Grisu). Каждое число с плавающей точкой v
+ *    "отвечает" за интервал вещественных чисел, которые при чтении
+ *    округляются к v. Среди десятичных чисел этого интервала выбирается число
+ *    с наименьшим количеством цифр, а из них - ближайшее к v. Например,
+ *    0.1f записывается как 0.1, и при чтении получается тот же 0.1f.
+ *    Границы интервала умножаются на 10^-k одним 128-битным умножением на
+ *    заранее вычисленную степень десяти; ошибка округления учитывается
+ *    "липким" младшим битом.
+ *
+ * 2) Чтение (алгоритм Эйзеля-Лемира, используется в Go, Rust, C++ fast_float).
+ *    Десятичные цифры числа (не более 19) собираются в целое число w
+ *    типа uint64_t, а затем w * 10^q вычисляется умножением на 128-битное
+ *    приближение 10^q. В редчайших случаях, когда приближения не хватает,
+ *    чтобы округлить результат однозначно, алгоритм сообщает об этом, и
+ *    число читается медленно, но точно функцией strtod.
+ *
+ * Обоим алгоритмам нужна таблица 128-битных приближений степеней десяти
+ * от 10^-348 до 10^347. Вместо того, чтобы вставлять в программу почти
+ * 1400 шестнадцатеричных констант, таблица вычисляется при первом обращении
+ * "длинной арифметикой" (см. 46_summation_algorithms.c, суперсумматор).
+ *
+ * Для 128-битного умножения используется тип unsigned __int128 - расширение
+ * gcc и clang для 64-битных процессоров.
+ *
+ * Компиляция:
+ * gcc 56_float_formatting_parsing.c -o floats -std=c99 -O2 -lm
+ * */
+
+#define _POSIX_C_SOURCE 200809L //clock_gettime
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>  //malloc free rand strtod strtof
+#include <stdint.h>  //uint32_t uint64_t
+#include <string.h>  //memcpy memset memcmp
+#include <math.h>    //sinf
+#include <time.h>    //clock_gettime
+
+typedef unsigned __int128 uint128_t;
+
+/**
+ * Таблица: pow10_hi[q - POW10_MIN] * 2^64 + pow10_lo[q - POW10_MIN] - старшие 128 бит
+ * числа 10^q, отброшенные разряды не округляются (отбрасываются). Старший бит pow10_hi всегда 1.
+ * */
+#define POW10_MIN (-348)
+#define POW10_MAX 347
+#define POW10_COUNT (POW10_MAX - POW10_MIN + 1)
+
+static uint64_t pow10_hi[POW10_COUNT], pow10_lo[POW10_COUNT];
+static bool pow10_ready = false;
+
+/**
+ * Длинное число - массив 32-битных "цифр" от младшей к старшей.
+ * 40 цифр - 1280 бит: хватает и для 10^347 (1153 бита), и для 2^1088 / 5^348 (280 бит).
+ * */
+#define BIGNUM_LIMBS 40
+
+static void bignum_mul_small(uint32_t *limbs, uint32_t factor) {
+    uint64_t carry = 0;
+    for (unsigned idx = 0; idx != BIGNUM_LIMBS; ++idx) {
+        uint64_t x = (uint64_t)limbs[idx] * factor + carry;
+        limbs[idx] = (uint32_t)x;
+        carry = x >> 32;
+    }
+}
+
+static void bignum_div_small(uint32_t *limbs, uint32_t divisor) {
+    uint64_t rest = 0;
+    for (unsigned idx = BIGNUM_LIMBS; idx-- != 0;) {
+        uint64_t x = rest << 32 | limbs[idx];
+        limbs[idx] = (uint32_t)(x / divisor);
+        rest = x % divisor;
+    }
+}
+
+//64 бита числа, начиная с бита номер pos (pos может быть отрицательным - там нули)
+static uint64_t bignum_bits64(uint32_t const *limbs, long pos) {
+    uint64_t res = 0;
+    for (unsigned bit = 0; bit != 64; ++bit) {
+        long p = pos + (long)bit;
+        if (p >= 0 && p < 32 * BIGNUM_LIMBS && (limbs[p / 32] >> (p % 32) & 1u))
+            res |= 1ull << bit;
+    }
+    return res;
+}
+
+//старшие 128 бит числа
+static void bignum_top128(uint32_t const *limbs, uint64_t *hi, uint64_t *lo) {
+    long length = 32 * BIGNUM_LIMBS;
+    while (length > 0 && !(limbs[(length - 1) / 32] >> ((length - 1) % 32) & 1u)) --length;
+    *hi = bignum_bits64(limbs,length - 64);
+    *lo = bignum_bits64(limbs,length - 128);
+}
+
+/**
+ * Положительные степени: 1, 10, 100, ... - умножением на 10.
+ * Отрицательные: 10^-n = 2^-n * 5^-n, а множитель 2^-n лишь сдвигает двоичную
+ * запятую и на старшие биты не влияет. Поэтому старшие биты 10^-n - это старшие
+ * биты целой части 2^1088 / 5^n, которая получается делением на 5 n раз:
+ * [[x / 5] / 5] == [x / 25], так что отбрасывание остатка не накапливает ошибку.
+ * */
+static void pow10_table_build() {
+    uint32_t limbs[BIGNUM_LIMBS] = {1};
+    for (int q = 0; q <= POW10_MAX; ++q) {
+        bignum_top128(limbs,pow10_hi + (q - POW10_MIN),pow10_lo + (q - POW10_MIN));
+        bignum_mul_small(limbs,10);
+    }
+    memset(limbs,0,sizeof(limbs));
+    limbs[34] = 1; //2^1088
+    for (int q = -1; q >= POW10_MIN; --q) {
+        bignum_div_small(limbs,5);
+        bignum_top128(limbs,pow10_hi + (q - POW10_MIN),pow10_lo + (q - POW10_MIN));
+    }
+    pow10_ready = true;
+}
+
+/**
+ * Внимание! Как и harmonic_table_build в 48_harmonic_numbers.c, таблица строится
+ * при первом вызове. Если форматирование или чтение чисел начинается сразу
+ * в нескольких потоках, вызовите float_tables_init заранее.
+ * */
+void float_tables_init() {
+    if (!pow10_ready)
+        pow10_table_build();
+}
+
+/*---------------------------- запись ----------------------------*/
+
+/**
+ * Целочисленные приближения логарифмов, точные во всём нужном диапазоне:
+ * floor(q * log10(2)), floor(q * log10(2) + log10(3/4)), floor(e * log2(10)).
+ * Сдвиг отрицательного числа вправо в gcc округляет вниз, как и требуется.
+ * */
+static int flog10_pow2(int q) {
+    return (int)((int64_t)q * 661971961083ll >> 41);
+}
+
+static int flog10_three_quarters_pow2(int q) {
+    return (int)(((int64_t)q * 661971961083ll - 274743187321ll) >> 41);
+}
+
+static int flog2_pow10(int e) {
+    return (int)((int64_t)e * 913124641741ll >> 38);
+}
+
+/**
+ * g - целая часть 126-битного приближения 10^-k плюс 1, т.е. приближение с избытком.
+ * */
+static uint128_t schubfach_g(int k) {
+    uint128_t m = (uint128_t)pow10_hi[-k - POW10_MIN] << 64 | pow10_lo[-k - POW10_MIN];
+    return (m >> 2) + 1;
+}
+
+#define MASK63 ((1ull << 63) - 1)
+#define MASK32 ((1ull << 32) - 1)
+
+/**
+ * Округлённое вниз произведение g * cp / 2^127, младший бит которого
+ * установлен, если отброшенная часть не равна нулю ("липкий" бит).
+ * */
+static uint64_t round_odd64(uint128_t g, uint64_t cp) {
+    uint64_t g1 = (uint64_t)(g >> 63), g0 = (uint64_t)g & MASK63;
+    uint64_t x1 = (uint64_t)((uint128_t)g0 * cp >> 64);
+    uint128_t y = (uint128_t)g1 * cp;
+    uint64_t z = ((uint64_t)y >> 1) + x1;
+    uint64_t vbp = (uint64_t)(y >> 64) + (z >> 63);
+    return vbp | (((z & MASK63) + MASK63) >> 63);
+}
+
+static uint32_t round_odd32(uint64_t g, uint64_t cp) {
+    uint64_t x1 = (uint64_t)((uint128_t)g * cp >> 64);
+    uint64_t vbp = x1 >> 31;
+    return (uint32_t)(vbp | (((x1 & MASK32) + MASK32) >> 32));
+}
+
+static char const digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static uint64_t const exact_pow10_u64[20] = {1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull,
+    10000000ull, 100000000ull, 1000000000ull, 10000000000ull, 100000000000ull, 1000000000000ull,
+    10000000000000ull, 100000000000000ull, 1000000000000000ull, 10000000000000000ull,
+    100000000000000000ull, 1000000000000000000ull, 10000000000000000000ull};
+
+/**
+ * Печать f * 10^e, f - не более 17 цифр. Как и "%g", выбирается запись
+ * с фиксированной запятой, если десятичный порядок X лежит в [-5, precision),
+ * и экспоненциальная иначе: 0.001, 123.25, 1e+20, 1.5e-07.
+ * */
+static char *format_decimal(char *p, uint64_t f, int e, int precision) {
+    if (0 == f) {
+        *p++ = '0';
+        return p;
+    }
+    while (0 == f % 100u) { //завершающие нули отбрасываем по два
+        f /= 100u;
+        e += 2;
+    }
+    if (0 == f % 10u) {
+        f /= 10u;
+        ++e;
+    }
+    int n = 1;
+    while (n != 20 && f >= exact_pow10_u64[n]) ++n;
+    char digits[20];
+    for (int idx = n; idx > 1; idx -= 2, f /= 100u) //по две цифры за деление, как в 55_fast_integer_writing.c
+        memcpy(digits + idx - 2,digit_pairs + 2 * (f % 100u),2);
+    if (n % 2)
+        digits[0] = (char)('0' + f);
+
+    int x = n + e - 1; //десятичный порядок первой цифры
+    if (x >= -5 && x < precision) {
+        if (x < 0) { //0.000ddd
+            *p++ = '0';
+            *p++ = '.';
+            for (int idx = -1; idx != x; --idx) *p++ = '0';
+            memcpy(p,digits,n);
+            return p + n;
+        }
+        if (n <= x + 1) { //ddd000
+            memcpy(p,digits,n);
+            p += n;
+            for (int idx = n; idx != x + 1; ++idx) *p++ = '0';
+            return p;
+        }
+        memcpy(p,digits,x + 1); //ddd.ddd
+        p += x + 1;
+        *p++ = '.';
+        memcpy(p,digits + x + 1,n - x - 1);
+        return p + n - x - 1;
+    }
+    *p++ = digits[0]; //d.ddde+XX
+    if (n > 1) {
+        *p++ = '.';
+        memcpy(p,digits + 1,n - 1);
+        p += n - 1;
+    }
+    *p++ = 'e';
+    *p++ = x < 0 ? '-' : '+';
+    unsigned ax = x < 0 ? (unsigned)-x : (unsigned)x;
+    if (ax >= 100u) *p++ = (char)('0' + ax / 100u);
+    *p++ = (char)('0' + ax / 10u % 10u);
+    *p++ = (char)('0' + ax % 10u);
+    return p;
+}
+
+/**
+ * Кратчайшее десятичное число в интервале округления числа c * 2^q.
+ * cb, cbl, cbr - середина и границы интервала, умноженные на 4;
+ * out == 1, если c нечётно: тогда границы не входят в интервал
+ * (при чтении половина пути округляется к чётному).
+ * */
+static char *schubfach64(char *p, int q, uint64_t c) {
+    uint64_t out = c & 1u, cb = c << 2, cbr = cb + 2, cbl;
+    int k;
+    if (c != 1ull << 52 || -1074 == q) {
+        cbl = cb - 2;
+        k = flog10_pow2(q);
+    } else { //c - степень двойки: нижний сосед вдвое ближе верхнего
+        cbl = cb - 1;
+        k = flog10_three_quarters_pow2(q);
+    }
+    int h = q + flog2_pow10(-k) + 2;
+    uint128_t g = schubfach_g(k);
+    uint64_t vb = round_odd64(g,cb << h), vbl = round_odd64(g,cbl << h), vbr = round_odd64(g,cbr << h);
+
+    uint64_t s = vb >> 2;
+    if (s >= 10u) { //сначала пробуем число на одну цифру короче (из одной цифры короче не сделать)
+        uint64_t sp10 = s / 10u * 10u, tp10 = sp10 + 10u;
+        bool upin = vbl + out <= sp10 << 2, wpin = (tp10 << 2) + out <= vbr;
+        if (upin != wpin)
+            return format_decimal(p,upin ? sp10 : tp10,k,17);
+    }
+    uint64_t t = s + 1;
+    bool uin = vbl + out <= s << 2, win = (t << 2) + out <= vbr;
+    if (uin != win)
+        return format_decimal(p,uin ? s : t,k,17);
+    int64_t cmp = (int64_t)vb - (int64_t)((s + t) << 1); //оба подходят - берём ближайшее
+    return format_decimal(p,cmp < 0 || (0 == cmp && 0 == (s & 1u)) ? s : t,k,17);
+}
+
+static char *schubfach32(char *p, int q, uint32_t c) {
+    uint32_t out = c & 1u;
+    uint64_t cb = (uint64_t)c << 2, cbr = cb + 2, cbl;
+    int k;
+    if (c != 1u << 23 || -149 == q) {
+        cbl = cb - 2;
+        k = flog10_pow2(q);
+    } else {
+        cbl = cb - 1;
+        k = flog10_three_quarters_pow2(q);
+    }
+    int h = q + flog2_pow10(-k) + 33;
+    uint64_t g = (uint64_t)(schubfach_g(k) >> 63) + 1; //64-битного приближения для float достаточно
+    uint32_t vb = round_odd32(g,cb << h), vbl = round_odd32(g,cbl << h), vbr = round_odd32(g,cbr << h);
+
+    uint32_t s = vb >> 2;
+    if (s >= 10u) {
+        uint32_t sp10 = s / 10u * 10u, tp10 = sp10 + 10u;
+        bool upin = vbl + out <= sp10 << 2, wpin = (tp10 << 2) + out <= vbr;
+        if (upin != wpin)
+            return format_decimal(p,upin ? sp10 : tp10,k,9);
+    }
+    uint32_t t = s + 1;
+    bool uin = vbl + out <= s << 2, win = (t << 2) + out <= vbr;
+    if (uin != win)
+        return format_decimal(p,uin ? s : t,k,9);
+    int64_t cmp = (int64_t)vb - (int64_t)((uint64_t)(s + t) << 1);
+    return format_decimal(p,cmp < 0 || (0 == cmp && 0 == (s & 1u)) ? s : t,k,9);
+}
+
+#define FORMAT_DOUBLE_MAX 32 //максимальная длина записи числа, "-2.2250738585072014e-308" и запас
+
+/**
+ * Кратчайшая запись double, которая читается обратно в то же самое число.
+ * Возвращает указатель на символ после записи, завершающий '\0' не пишется.
+ * */
+char *format_double(char *p, double v) {
+    float_tables_init();
+    uint64_t bits;
+    memcpy(&bits,&v,sizeof(bits));
+    if (bits >> 63)
+        *p++ = '-';
+    uint64_t t = bits & ((1ull << 52) - 1);
+    int bq = (int)(bits >> 52 & 0x7FFu);
+    if (0x7FF == bq) {
+        memcpy(p,0 == t ? "inf" : "nan",3);
+        return p + 3;
+    }
+    if (0 != bq) {
+        int mq = 1075 - bq; //v = c * 2^-mq
+        uint64_t c = 1ull << 52 | t;
+        if (0 < mq && mq < 53 && 0 == (c & ((1ull << mq) - 1))) //целое число - печатаем как есть
+            return format_decimal(p,c >> mq,0,17);
+        return schubfach64(p,-mq,c);
+    }
+    if (0 == t) {
+        *p++ = '0';
+        return p;
+    }
+    return schubfach64(p,-1074,t); //денормализованное число
+}
+
+char *format_float(char *p, float v) {
+    float_tables_init();
+    uint32_t bits;
+    memcpy(&bits,&v,sizeof(bits));
+    if (bits >> 31)
+        *p++ = '-';
+    uint32_t t = bits & ((1u << 23) - 1);
+    int bq = (int)(bits >> 23 & 0xFFu);
+    if (0xFF == bq) {
+        memcpy(p,0 == t ? "inf" : "nan",3);
+        return p + 3;
+    }
+    if (0 != bq) {
+        int mq = 150 - bq;
+        uint32_t c = 1u << 23 | t;
+        if (0 < mq && mq < 24 && 0 == (c & ((1u << mq) - 1)))
+            return format_decimal(p,c >> mq,0,9);
+        return schubfach32(p,-mq,c);
+    }
+    if (0 == t) {
+        *p++ = '0';
+        return p;
+    }
+    return schubfach32(p,-149,t);
+}
+
+/*---------------------------- чтение ----------------------------*/
+
+/**
+ * Разбор записи [+-]ddd[.ddd][(e|E)[+-]ddd] в w * 10^exp10.
+ * Возвращает указатель на символ после числа или NULL, если запись не подходит
+ * для быстрого чтения: в ней больше 19 значащих цифр, это inf, nan,
+ * шестнадцатеричное число или вовсе не число.
+ * */
+static char const *scan_decimal(char const *p, uint64_t *w, int *exp10, bool *negative) {
+    *negative = '-' == *p;
+    if ('-' == *p || '+' == *p) ++p;
+    uint64_t man = 0;
+    int digits = 0, exponent = 0;
+    bool any = false;
+    for (; (unsigned)(*p - '0') < 10u; ++p, any = true) {
+        if (0 == man && '0' == *p) continue; //ведущие нули
+        if (19 == digits) return NULL;
+        man = man * 10u + (unsigned)(*p - '0');
+        ++digits;
+    }
+    if ('x' == *p || 'X' == *p)
+        return NULL;
+    if ('.' == *p) {
+        for (++p; (unsigned)(*p - '0') < 10u; ++p, any = true) {
+            --exponent;
+            if (0 == man && '0' == *p) continue;
+            if (19 == digits) return NULL;
+            man = man * 10u + (unsigned)(*p - '0');
+            ++digits;
+        }
+    }
+    if (!any)
+        return NULL;
+    if ('e' == *p || 'E' == *p) {
+        char const *e = p + 1;
+        bool e_negative = '-' == *e;
+        if ('-' == *e || '+' == *e) ++e;
+        if ((unsigned)(*e - '0') < 10u) {
+            int value = 0;
+            for (; (unsigned)(*e - '0') < 10u; ++e)
+                if (value < 100000) value = value * 10 + (*e - '0'); //огромный порядок всё равно даст 0 или inf
+            exponent += e_negative ? -value : value;
+            p = e;
+        }
+    }
+    *w = man;
+    *exp10 = exponent;
+    return p;
+}
+
+/**
+ * Алгоритм Эйзеля-Лемира: w * 10^exp10 с правильным округлением, w != 0.
+ * Возвращает false, если результат нельзя получить однозначно
+ * (тогда число читается strtod) или он не является нормализованным числом.
+ * */
+static bool eisel_lemire64(uint64_t w, int exp10, bool negative, double *res) {
+    if (exp10 < POW10_MIN || exp10 > POW10_MAX)
+        return false;
+    int clz = __builtin_clzll(w);
+    w <<= clz;
+    uint64_t ret_exp2 = (uint64_t)((217706 * exp10 >> 16) + 64 + 1023) - (uint64_t)clz;
+
+    uint128_t x = (uint128_t)w * pow10_hi[exp10 - POW10_MIN];
+    uint64_t x_hi = (uint64_t)(x >> 64), x_lo = (uint64_t)x;
+    if (0x1FF == (x_hi & 0x1FF) && x_lo + w < w) { //младших битов может не хватить - уточняем второй половиной 10^q
+        uint128_t y = (uint128_t)w * pow10_lo[exp10 - POW10_MIN];
+        uint64_t merged_hi = x_hi, merged_lo = x_lo + (uint64_t)(y >> 64);
+        if (merged_lo < x_lo) ++merged_hi;
+        if (0x1FF == (merged_hi & 0x1FF) && 0 == merged_lo + 1 && (uint64_t)y + w < w)
+            return false;
+        x_hi = merged_hi;
+        x_lo = merged_lo;
+    }
+    uint64_t msb = x_hi >> 63;
+    uint64_t mantissa = x_hi >> (msb + 9);
+    ret_exp2 -= 1 ^ msb;
+    if (0 == x_lo && 0 == (x_hi & 0x1FF) && 1 == (mantissa & 3)) //ровно половина: нужна точная арифметика
+        return false;
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+    if (mantissa >> 53) {
+        mantissa >>= 1;
+        ++ret_exp2;
+    }
+    if (ret_exp2 - 1 >= 0x7FF - 1) //денормализованное число, ноль или бесконечность
+        return false;
+    uint64_t bits = ret_exp2 << 52 | (mantissa & ((1ull << 52) - 1)) | (uint64_t)negative << 63;
+    memcpy(res,&bits,sizeof(bits));
+    return true;
+}
+
+static bool eisel_lemire32(uint64_t w, int exp10, bool negative, float *res) {
+    if (exp10 < POW10_MIN || exp10 > POW10_MAX)
+        return false;
+    int clz = __builtin_clzll(w);
+    w <<= clz;
+    uint64_t ret_exp2 = (uint64_t)((217706 * exp10 >> 16) + 64 + 127) - (uint64_t)clz;
+
+    uint128_t x = (uint128_t)w * pow10_hi[exp10 - POW10_MIN];
+    uint64_t x_hi = (uint64_t)(x >> 64), x_lo = (uint64_t)x;
+    uint64_t const low_mask = 0x3FFFFFFFFFull; //38 отбрасываемых бит
+    if (low_mask == (x_hi & low_mask) && x_lo + w < w) {
+        uint128_t y = (uint128_t)w * pow10_lo[exp10 - POW10_MIN];
+        uint64_t merged_hi = x_hi, merged_lo = x_lo + (uint64_t)(y >> 64);
+        if (merged_lo < x_lo) ++merged_hi;
+        if (low_mask == (merged_hi & low_mask) && 0 == merged_lo + 1 && (uint64_t)y + w < w)
+            return false;
+        x_hi = merged_hi;
+        x_lo = merged_lo;
+    }
+    uint64_t msb = x_hi >> 63;
+    uint64_t mantissa = x_hi >> (msb + 38);
+    ret_exp2 -= 1 ^ msb;
+    if (0 == x_lo && 0 == (x_hi & low_mask) && 1 == (mantissa & 3))
+        return false;
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+    if (mantissa >> 24) {
+        mantissa >>= 1;
+        ++ret_exp2;
+    }
+    if (ret_exp2 - 1 >= 0xFF - 1)
+        return false;
+    uint32_t bits = (uint32_t)(ret_exp2 << 23 | (mantissa & ((1u << 23) - 1))) | (uint32_t)negative << 31;
+    memcpy(res,&bits,sizeof(bits));
+    return true;
+}
+
+//степени десяти, которые точно представимы в double
+static double const exact_pow10[23] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                       1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+/**
+ * Чтение double, аналог strtod: возвращает указатель на символ после
+ * числа или NULL, если в начале строки нет числа. Пробелы перед числом не пропускаются.
+ * */
+char const *parse_double(char const *p, double *value) {
+    float_tables_init();
+    uint64_t w;
+    int exp10;
+    bool negative;
+    char const *end = scan_decimal(p,&w,&exp10,&negative);
+    if (NULL != end) {
+        if (0 == w) {
+            *value = negative ? -0. : 0.;
+            return end;
+        }
+        //w и 10^|exp10| точно представимы в double - одна операция округляется правильно
+        if (w <= 1ull << 53 && exp10 >= -22 && exp10 <= 22) {
+            double d = (double)w;
+            d = exp10 < 0 ? d / exact_pow10[-exp10] : d * exact_pow10[exp10];
+            *value = negative ? -d : d;
+            return end;
+        }
+        if (eisel_lemire64(w,exp10,negative,value))
+            return end;
+    }
+    char *slow_end; //медленный, но точный путь
+    *value = strtod(p,&slow_end);
+    return slow_end == p ? NULL : slow_end;
+}
+
+char const *parse_float(char const *p, float *value) {
+    float_tables_init();
+    uint64_t w;
+    int exp10;
+    bool negative;
+    char const *end = scan_decimal(p,&w,&exp10,&negative);
+    if (NULL != end) {
+        if (0 == w) {
+            *value = negative ? -0.f : 0.f;
+            return end;
+        }
+        if (w <= 1u << 24 && exp10 >= -10 && exp10 <= 10) { //10^10 = 2^10 * 5^10, 5^10 < 2^24
+            float f = (float)w;
+            f = exp10 < 0 ? f / (float)exact_pow10[-exp10] : f * (float)exact_pow10[exp10];
+            *value = negative ? -f : f;
+            return end;
+        }
+        if (eisel_lemire32(w,exp10,negative,value))
+            return end;
+    }
+    char *slow_end;
+    *value = strtof(p,&slow_end);
+    return slow_end == p ? NULL : slow_end;
+}
+
+/*------------------------ текстовые таблицы ------------------------*/
+
+/**
+ * Запись таблицы функции в формате "аргумент значение\n", как sin_tab.txt,
+ * но кратчайшими точными записями чисел. Текст формируется в буфере
+ * и записывается крупными блоками (см. 55_fast_integer_writing.c).
+ * */
+bool float_table_write(char const *path, float const *args, float const *values, size_t count) {
+    size_t const buffer_size = 1u << 20;
+    char *buf = malloc(buffer_size);
+    FILE *out_stream = fopen(path,"w");
+    bool success = false;
+    if (NULL == buf || NULL == out_stream)
+        goto CLEAR;
+    size_t used = 0;
+    for (size_t idx = 0; idx != count; ++idx) {
+        if (buffer_size - used < 2 * FORMAT_DOUBLE_MAX) {
+            fwrite(buf,1,used,out_stream);
+            used = 0;
+        }
+        char *p = format_float(buf + used,args[idx]);
+        *p++ = ' ';
+        p = format_float(p,values[idx]);
+        *p++ = '\n';
+        used = (size_t)(p - buf);
+    }
+    fwrite(buf,1,used,out_stream);
+    success = !ferror(out_stream);
+
+CLEAR:
+    if (NULL != out_stream)
+        success = 0 == fclose(out_stream) && success;
+    free(buf);
+    return success;
+}
+
+/**
+ * Чтение таблицы: файл читается в память целиком и разбирается parse_float.
+ * Возвращает количество прочитанных строк, *status == false при ошибке
+ * (файл не открылся, строк больше capacity или встретилось не число).
+ * */
+size_t float_table_read(char const *path, float *args, float *values, size_t capacity, bool *status) {
+    *status = false;
+    FILE *in_stream = fopen(path,"rb");
+    if (NULL == in_stream)
+        return 0;
+    char *text = NULL;
+    size_t count = 0;
+    if (0 != fseek(in_stream,0,SEEK_END))
+        goto CLEAR;
+    long size = ftell(in_stream);
+    if (size < 0 || 0 != fseek(in_stream,0,SEEK_SET))
+        goto CLEAR;
+    text = malloc((size_t)size + 1);
+    if (NULL == text || (size_t)size != fread(text,1,(size_t)size,in_stream))
+        goto CLEAR;
+    text[size] = '\0'; //parse_float, как и strtod, останавливается на нулевом символе
+
+    char const *p = text, *end = text + size;
+    while (true) {
+        while (p != end && (' ' == *p || '\n' == *p || '\t' == *p || '\r' == *p)) ++p;
+        if (p == end) {
+            *status = true;
+            break;
+        }
+        if (count == capacity)
+            break;
+        p = parse_float(p,args + count);
+        if (NULL == p)
+            break;
+        while (' ' == *p || '\t' == *p) ++p;
+        p = parse_float(p,values + count);
+        if (NULL == p)
+            break;
+        ++count;
+    }
+
+CLEAR:
+    free(text);
+    fclose(in_stream);
+    return count;
+}
+
+double seconds_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec + ts.tv_nsec * 1.e-9;
+}
+
+//количество значащих цифр в записи числа: без ведущих и завершающих нулей
+static int significant_digits(char const *s) {
+    int digits = 0, zeros = 0;
+    for (; '\0' != *s && 'e' != *s; ++s) {
+        if ((unsigned)(*s - '0') >= 10u || (0 == digits && '0' == *s)) continue;
+        zeros = '0' == *s ? zeros + 1 : 0;
+        ++digits;
+    }
+    return digits - zeros;
+}
+
+static uint64_t random64() {
+    return (uint64_t)rand() << 62 ^ (uint64_t)rand() << 31 ^ (uint64_t)rand();
+}
+
+typedef struct {
+    unsigned not_round_trip, parse_differs, not_shortest;
+} round_trip_errors_t;
+
+/**
+ * Проверки одного числа:
+ * 1) запись читается strtod/strtof в то же самое число;
+ * 2) parse_double/parse_float совпадают с strtod/strtof, в том числе на записях "%.17g";
+ * 3) запись кратчайшая: "%.*e" с меньшим количеством цифр уже не читается обратно.
+ * */
+static void check_double(double v, round_trip_errors_t *e) {
+    char buf[64], ref[64];
+    *format_double(buf,v) = '\0';
+    double back = strtod(buf,NULL), parsed;
+    if (0 != memcmp(&back,&v,sizeof(v))) ++e->not_round_trip;
+    if (NULL == parse_double(buf,&parsed) || 0 != memcmp(&parsed,&v,sizeof(v))) ++e->parse_differs;
+    snprintf(ref,sizeof(ref),"%.17g",v);
+    if (NULL == parse_double(ref,&parsed) || 0 != memcmp(&parsed,&v,sizeof(v))) ++e->parse_differs;
+    int digits = significant_digits(buf);
+    if (digits > 1) {
+        snprintf(ref,sizeof(ref),"%.*e",digits - 2,v);
+        if (strtod(ref,NULL) == v) ++e->not_shortest;
+    }
+}
+
+static void check_float(float f, round_trip_errors_t *e) {
+    char buf[64], ref[64];
+    *format_float(buf,f) = '\0';
+    float back = strtof(buf,NULL), parsed;
+    if (0 != memcmp(&back,&f,sizeof(f))) ++e->not_round_trip;
+    if (NULL == parse_float(buf,&parsed) || 0 != memcmp(&parsed,&f,sizeof(f))) ++e->parse_differs;
+    snprintf(ref,sizeof(ref),"%.9g",f);
+    if (NULL == parse_float(ref,&parsed) || 0 != memcmp(&parsed,&f,sizeof(f))) ++e->parse_differs;
+    int digits = significant_digits(buf);
+    if (digits > 1) {
+        snprintf(ref,sizeof(ref),"%.*e",digits - 2,f);
+        if (strtof(ref,NULL) == f) ++e->not_shortest;
+    }
+}
+
+/**
+ * Проверка на случайных числах (случайные биты, т.е. числа всех порядков,
+ * включая денормализованные) и отдельно на самых маленьких денормализованных
+ * числах: у них мантисса из нескольких бит, и интервал округления особенно широк.
+ * */
+void float_round_trip_test() {
+    unsigned const count = 2000000u;
+    round_trip_errors_t e = {0, 0, 0};
+    char buf[64];
+    srand(56);
+    for (unsigned idx = 0; idx != count; ++idx) {
+        uint64_t bits = random64();
+        double v;
+        memcpy(&v,&bits,sizeof(v));
+        if (v == v && v - v == 0.) //не nan и не бесконечность
+            check_double(v,&e);
+        float f;
+        uint32_t fbits = (uint32_t)bits;
+        memcpy(&f,&fbits,sizeof(f));
+        if (f == f && f - f == 0.f)
+            check_float(f,&e);
+    }
+    for (uint64_t bits = 1; bits != 100000u; ++bits) {
+        double v;
+        memcpy(&v,&bits,sizeof(v));
+        check_double(v,&e);
+        check_double(-v,&e);
+        float f;
+        uint32_t fbits = (uint32_t)bits;
+        memcpy(&f,&fbits,sizeof(f));
+        check_float(f,&e);
+        check_float(-f,&e);
+    }
+    printf("not round trip: %u, parse differs from strtod: %u, not shortest: %u\n",e.not_round_trip,e.parse_differs,e.not_shortest);
+
+    double samples[7] = {0.1, 1. / 3., 1e23, 5e-324, 1e-323, 123456789012345680., -0.};
+    for (unsigned idx = 0; idx != 7; ++idx) {
+        *format_double(buf,samples[idx]) = '\0';
+        printf("%-24s %.17g\n",buf,samples[idx]);
+    }
+    float fsamples[5] = {0.1f, 3.14159265f, 1e-45f, 3e-44f, 16777216.f};
+    for (unsigned idx = 0; idx != 5; ++idx) {
+        *format_float(buf,fsamples[idx]) = '\0';
+        printf("%-24s %.9g\n",buf,fsamples[idx]);
+    }
+}
+
+/**
+ * Таблица sin(x) из 10 миллионов точек: запись и чтение тремя способами.
+ * "%f %e" - как в function_infile_tabulation_test, "%.9g" - точная запись
+ * средствами printf, shortest - float_table_write и float_table_read.
+ * */
+void float_table_speed_test() {
+    size_t const count = 10000000u;
+    float *args = malloc(count * sizeof(float)), *values = malloc(count * sizeof(float));
+    float *args_back = malloc(count * sizeof(float)), *values_back = malloc(count * sizeof(float));
+    if (NULL == args || NULL == values || NULL == args_back || NULL == values_back) {
+        printf("Can't allocate memory!\n");
+        goto CLEAR;
+    }
+    float const step = 3.14159265f / count;
+    for (size_t idx = 0; idx != count; ++idx) {
+        args[idx] = step * idx;
+        values[idx] = sinf(args[idx]);
+    }
+
+    char const *names[3] = {"%f %e", "%.9g %.9g", "shortest"};
+    printf("format        write, MB/s   read, MB/s   size, MB   mismatches\n");
+    for (unsigned method = 0; method != 3; ++method) {
+        double start = seconds_now();
+        if (2 == method) {
+            if (!float_table_write("./sin_tab.txt",args,values,count)) {
+                printf("File stream error!\n");
+                goto CLEAR;
+            }
+        } else {
+            FILE *out_stream = fopen("./sin_tab.txt","w");
+            if (NULL == out_stream) {
+                printf("Can't open file to write!\n");
+                goto CLEAR;
+            }
+            for (size_t idx = 0; idx != count; ++idx)
+                fprintf(out_stream,0 == method ? "%f %e\n" : "%.9g %.9g\n",args[idx],values[idx]);
+            bool failed = ferror(out_stream);
+            if (0 != fclose(out_stream) || failed) {
+                printf("File stream error!\n");
+                goto CLEAR;
+            }
+        }
+        double write_seconds = seconds_now() - start;
+
+        start = seconds_now();
+        size_t got = 0;
+        if (2 == method) {
+            bool status;
+            got = float_table_read("./sin_tab.txt",args_back,values_back,count,&status);
+            if (!status) printf("Input format error!\n");
+        } else {
+            FILE *in_stream = fopen("./sin_tab.txt","r");
+            if (NULL == in_stream) {
+                printf("Can't open file to read!\n");
+                goto CLEAR;
+            }
+            while (got != count && 2 == fscanf(in_stream,"%f %e",args_back + got,values_back + got)) ++got;
+            fclose(in_stream);
+        }
+        double read_seconds = seconds_now() - start;
+
+        FILE *in_stream = fopen("./sin_tab.txt","r");
+        double megabytes = 0.;
+        if (NULL != in_stream) {
+            fseek(in_stream,0,SEEK_END);
+            megabytes = ftell(in_stream) / 1.e6;
+            fclose(in_stream);
+        }
+        size_t mismatches = count - got;
+        for (size_t idx = 0; idx != got; ++idx)
+            mismatches += args[idx] != args_back[idx] || values[idx] != values_back[idx];
+        printf("%-12s %12.1f %12.1f %10.1f %12zu\n",names[method],megabytes / write_seconds,megabytes / read_seconds,megabytes,mismatches);
+    }
+
+CLEAR:
+    free(values_back);
+    free(args_back);
+    free(values);
+    free(args);
+}
+
+int main() {
+    if (false) float_round_trip_test();
+    if (false) float_table_speed_test();
+    return 0;
+}
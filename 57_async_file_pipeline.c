@@ -0,0 +1,689 @@
+/**
+ * В 42_files_ascii.c работа с файлом синхронная: сгенерировать число,
+ * записать его fprintf, снова сгенерировать... Пока операционная система
+ * записывает данные на диск, программа ждёт, а пока программа считает,
+ * простаивает диск. Для файлов, которые не помещаются в оперативную память
+ * (и, значит, в кэш страниц), время работы - это сумма времени вычислений
+ * и времени работы диска.
+ *
+ * Асинхронный ввод-вывод позволяет совместить одно с другим:
+ * программа отдаёт операционной системе заполненный буфер на запись
+ * и, не дожидаясь окончания записи, заполняет следующий буфер.
+ * При чтении - наоборот: пока разбирается один буфер, следующие уже читаются.
+ * Тогда время работы - это максимум, а не сумма.
+ *
+ * Рассмотрим три способа ("бэкенда"):
+ * 1) синхронный - write и read вызываются прямо в цикле, для сравнения;
+ * 2) отдельный поток ввода-вывода (POSIX threads): программа передаёт буферы
+ *    потоку через очередь, защищённую мьютексом, поток вызывает pwrite/pread;
+ * 3) io_uring - интерфейс асинхронного ввода-вывода ядра Linux. Сам интерфейс
+ *    появился в ядре 5.1, но операции IORING_OP_READ и IORING_OP_WRITE,
+ *    которые здесь используются, - только в 5.6.
+ *    Программа и ядро совместно используют две кольцевые очереди в памяти:
+ *    в очередь заявок (submission queue, SQ) программа кладёт описания операций,
+ *    из очереди завершений (completion queue, CQ) забирает их результаты.
+ *    Системный вызов io_uring_enter нужен только, чтобы сообщить ядру о новых
+ *    заявках или подождать завершения. Библиотека liburing не используется:
+ *    обращение к ядру напрямую через syscall показывает, как всё устроено.
+ * Если io_uring недоступен (старое ядро или запрет в настройках системы)
+ * или ядро не поддерживает нужную операцию, используется поток ввода-вывода.
+ * Поддержка операций проверяется запросом IORING_REGISTER_PROBE (с ядра 5.6),
+ * а если операция всё же завершилась с -EINVAL, она повторяется через pread/pwrite
+ * и файл переключается на поток ввода-вывода.
+ *
+ * Компиляция:
+ * gcc 57_async_file_pipeline.c -o pipeline -std=c99 -O2 -pthread
+ * */
+
+#define _DEFAULT_SOURCE //syscall pread pwrite mmap sysconf clock_gettime
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>      //malloc calloc free rand
+#include <stdint.h>      //uint64_t
+#include <string.h>      //memset
+#include <errno.h>       //errno EINTR EINVAL
+#include <time.h>        //clock_gettime
+#include <fcntl.h>       //open
+#include <unistd.h>      //pread pwrite close syscall sysconf
+#include <sys/mman.h>    //mmap munmap
+#include <sys/syscall.h> //__NR_io_uring_setup __NR_io_uring_enter __NR_io_uring_register
+#include <pthread.h>
+#include <linux/io_uring.h>
+
+/*------------------------------ io_uring ------------------------------*/
+
+/**
+ * Указатели на поля колец, которые ядро отображает в память программы.
+ * head и tail - счётчики, которые только растут; номер элемента - счётчик & mask.
+ * В очередь заявок пишет программа (сдвигает tail), читает ядро (сдвигает head),
+ * в очередь завершений - наоборот.
+ * */
+typedef struct {
+    int fd;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    struct io_uring_sqe *sqes;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_cqe *cqes;
+    void *sq_ring, *cq_ring;
+    size_t sq_ring_size, cq_ring_size, sqes_size;
+} uring_t;
+
+bool uring_init(uring_t *ring, unsigned entries) {
+    memset(ring,0,sizeof(*ring));
+    struct io_uring_params params;
+    memset(&params,0,sizeof(params));
+    ring->fd = (int)syscall(__NR_io_uring_setup,entries,&params);
+    if (ring->fd < 0)
+        return false;
+
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) { //новые ядра отображают оба кольца одним вызовом
+        if (ring->cq_ring_size > ring->sq_ring_size) ring->sq_ring_size = ring->cq_ring_size;
+        ring->cq_ring_size = ring->sq_ring_size;
+    }
+    ring->sq_ring = mmap(NULL,ring->sq_ring_size,PROT_READ | PROT_WRITE,MAP_SHARED | MAP_POPULATE,ring->fd,IORING_OFF_SQ_RING);
+    if (MAP_FAILED == ring->sq_ring)
+        goto FAIL_SQ;
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_ring = ring->sq_ring;
+    } else {
+        ring->cq_ring = mmap(NULL,ring->cq_ring_size,PROT_READ | PROT_WRITE,MAP_SHARED | MAP_POPULATE,ring->fd,IORING_OFF_CQ_RING);
+        if (MAP_FAILED == ring->cq_ring)
+            goto FAIL_CQ;
+    }
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL,ring->sqes_size,PROT_READ | PROT_WRITE,MAP_SHARED | MAP_POPULATE,ring->fd,IORING_OFF_SQES);
+    if (MAP_FAILED == ring->sqes)
+        goto FAIL_SQES;
+
+    char *sq = ring->sq_ring, *cq = ring->cq_ring;
+    ring->sq_head = (unsigned *)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+    ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    return true;
+
+FAIL_SQES:
+    if (ring->cq_ring != ring->sq_ring)
+        munmap(ring->cq_ring,ring->cq_ring_size);
+FAIL_CQ:
+    munmap(ring->sq_ring,ring->sq_ring_size);
+FAIL_SQ:
+    close(ring->fd);
+    ring->fd = -1;
+    return false;
+}
+
+void uring_free(uring_t *ring) {
+    if (ring->fd < 0)
+        return;
+    munmap(ring->sqes,ring->sqes_size);
+    if (ring->cq_ring != ring->sq_ring)
+        munmap(ring->cq_ring,ring->cq_ring_size);
+    munmap(ring->sq_ring,ring->sq_ring_size);
+    close(ring->fd);
+    ring->fd = -1;
+}
+
+/**
+ * Поддерживает ли ядро операцию opcode. io_uring_setup успешно работает
+ * и на ядрах 5.1-5.5, где IORING_OP_READ и IORING_OP_WRITE ещё нет,
+ * поэтому одного успешного uring_init недостаточно. Ядро заполняет
+ * массив ops для всех известных ему операций; на ядрах до 5.6 нет и самого
+ * запроса IORING_REGISTER_PROBE - тогда операция считается неподдерживаемой.
+ * */
+bool uring_supports(uring_t *ring, unsigned char opcode) {
+    unsigned const ops_count = 256; //opcode - однобайтовый
+    struct io_uring_probe *probe = calloc(1,sizeof(struct io_uring_probe) + ops_count * sizeof(struct io_uring_probe_op));
+    if (NULL == probe)
+        return false;
+    bool supported = syscall(__NR_io_uring_register,ring->fd,IORING_REGISTER_PROBE,probe,ops_count) >= 0
+                  && opcode < probe->ops_len && (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED);
+    free(probe);
+    return supported;
+}
+
+/**
+ * Заявка на чтение или запись len байт по смещению offset.
+ * Заявка заполняется до того, как сдвигается tail: запись с семантикой
+ * release гарантирует, что ядро, увидев новый tail, увидит и заполненную заявку.
+ * */
+static bool uring_submit(uring_t *ring, unsigned char opcode, int fd, void *buf, unsigned len, uint64_t offset, uint64_t user_data) {
+    unsigned tail = *ring->sq_tail;
+    if (tail - __atomic_load_n(ring->sq_head,__ATOMIC_ACQUIRE) > *ring->sq_mask)
+        return false; //очередь заполнена (при глубине конвейера меньше размера кольца такого не бывает)
+    unsigned idx = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = ring->sqes + idx;
+    memset(sqe,0,sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->off = offset;
+    sqe->addr = (uint64_t)(uintptr_t)buf;
+    sqe->len = len;
+    sqe->user_data = user_data;
+    ring->sq_array[idx] = idx;
+    __atomic_store_n(ring->sq_tail,tail + 1,__ATOMIC_RELEASE);
+
+    while (syscall(__NR_io_uring_enter,ring->fd,1,0,0,NULL,0) < 0)
+        if (EINTR != errno)
+            return false;
+    return true;
+}
+
+/**
+ * Ожидание одного завершения: *user_data - метка заявки, *res - результат,
+ * как у read/write (количество байт или -errno).
+ * */
+static bool uring_wait(uring_t *ring, uint64_t *user_data, int *res) {
+    unsigned head = *ring->cq_head;
+    while (head == __atomic_load_n(ring->cq_tail,__ATOMIC_ACQUIRE))
+        if (syscall(__NR_io_uring_enter,ring->fd,0,1,IORING_ENTER_GETEVENTS,NULL,0) < 0 && EINTR != errno)
+            return false;
+    struct io_uring_cqe *cqe = ring->cqes + (head & *ring->cq_mask);
+    *user_data = cqe->user_data;
+    *res = cqe->res;
+    __atomic_store_n(ring->cq_head,head + 1,__ATOMIC_RELEASE);
+    return true;
+}
+
+/*------------------------------ конвейер ------------------------------*/
+
+typedef enum {
+    BACKEND_SYNC,
+    BACKEND_THREAD,
+    BACKEND_URING
+} backend_t;
+
+#define PIPELINE_BLOCK (4u << 20) //размер буфера
+#define PIPELINE_DEPTH 4u         //количество буферов: один заполняет программа, остальные - в работе
+
+typedef enum {
+    SLOT_FREE,    //буфер у программы
+    SLOT_PENDING, //отдан на чтение или запись
+    SLOT_DONE     //операция завершена, результат в res
+} slot_state_t;
+
+typedef struct {
+    char *buf;
+    size_t len;                 //сколько байт записать или прочитать
+    unsigned long long offset;  //смещение в файле
+    slot_state_t state;
+    long long res;
+} slot_t;
+
+/**
+ * Асинхронный файл: PIPELINE_DEPTH буферов, которые по кругу
+ * отдаются на чтение или запись.
+ * */
+typedef struct {
+    backend_t backend;
+    int fd;
+    bool writing;
+    bool failed;
+    slot_t slots[PIPELINE_DEPTH];
+    unsigned current;                //буфер, с которым сейчас работает программа
+    unsigned long long next_offset;  //смещение следующей операции
+    uring_t ring;
+    bool uring_unsupported;          //операция завершилась с -EINVAL: нужно перейти на поток
+    //поток ввода-вывода
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    bool stop;
+    unsigned queue_head;             //номер следующей заявки для потока (заявки выполняются по порядку буферов)
+} async_file_t;
+
+/**
+ * Выполнение операции обычными pread/pwrite. Они, как и read/write,
+ * могут обработать меньше байт, чем просили, поэтому вызываются в цикле.
+ * Чтение останавливается в конце файла. Возвращает количество байт или -1.
+ * */
+static long long slot_io(int fd, bool writing, char *buf, size_t len, unsigned long long offset) {
+    size_t done = 0;
+    while (done != len) {
+        ssize_t res = writing ? pwrite(fd,buf + done,len - done,(off_t)(offset + done))
+                              : pread(fd,buf + done,len - done,(off_t)(offset + done));
+        if (res < 0 && EINTR == errno)
+            continue;
+        if (res < 0)
+            return -1;
+        if (0 == res) {
+            if (writing) return -1;
+            break; //конец файла
+        }
+        done += (size_t)res;
+    }
+    return (long long)done;
+}
+
+void *io_thread(void *arg) {
+    async_file_t *file = arg;
+    pthread_mutex_lock(&file->lock);
+    while (true) {
+        slot_t *slot = file->slots + file->queue_head;
+        if (SLOT_PENDING != slot->state) {
+            if (file->stop)
+                break;
+            pthread_cond_wait(&file->changed,&file->lock);
+            continue;
+        }
+        pthread_mutex_unlock(&file->lock); //сама операция выполняется без блокировки
+        long long res = slot_io(file->fd,file->writing,slot->buf,slot->len,slot->offset);
+        pthread_mutex_lock(&file->lock);
+        slot->res = res;
+        slot->state = SLOT_DONE;
+        file->queue_head = (file->queue_head + 1) % PIPELINE_DEPTH;
+        pthread_cond_broadcast(&file->changed);
+    }
+    pthread_mutex_unlock(&file->lock);
+    return NULL;
+}
+
+static void slot_submit(async_file_t *file, unsigned idx) {
+    slot_t *slot = file->slots + idx;
+    if (BACKEND_SYNC == file->backend) {
+        slot->res = slot_io(file->fd,file->writing,slot->buf,slot->len,slot->offset);
+        slot->state = SLOT_DONE;
+    } else if (BACKEND_THREAD == file->backend) {
+        pthread_mutex_lock(&file->lock);
+        slot->state = SLOT_PENDING;
+        pthread_cond_broadcast(&file->changed);
+        pthread_mutex_unlock(&file->lock);
+    } else {
+        slot->state = SLOT_PENDING;
+        if (!uring_submit(&file->ring,file->writing ? IORING_OP_WRITE : IORING_OP_READ,file->fd,
+                          slot->buf,(unsigned)slot->len,slot->offset,idx)) {
+            slot->res = -1;
+            slot->state = SLOT_DONE;
+        }
+    }
+}
+
+/**
+ * Запуск потока ввода-вывода. Заявки поток выполняет по порядку буферов,
+ * начиная с queue_head. Если поток запустить не удалось, файл работает синхронно.
+ * */
+static void async_file_start_thread(async_file_t *file) {
+    file->backend = BACKEND_SYNC;
+    if (0 != pthread_mutex_init(&file->lock,NULL))
+        return;
+    if (0 != pthread_cond_init(&file->changed,NULL)) {
+        pthread_mutex_destroy(&file->lock);
+        return;
+    }
+    if (0 != pthread_create(&file->thread,NULL,io_thread,file)) {
+        pthread_cond_destroy(&file->changed);
+        pthread_mutex_destroy(&file->lock);
+        return;
+    }
+    file->backend = BACKEND_THREAD;
+}
+
+/**
+ * Обработка одного завершения io_uring. Завершения приходят в любом порядке,
+ * поэтому отмечается тот буфер, чья метка пришла. Недописанный или недочитанный
+ * остаток (ядро вправе обработать только часть буфера) дописывается синхронно.
+ * -EINVAL означает, что ядро не может выполнить такую операцию над этим файлом
+ * (uring_supports проверяет операцию вообще, а не для конкретного файла):
+ * операция повторяется через pread/pwrite, а файл отмечается для перехода на поток.
+ * */
+static bool uring_reap(async_file_t *file) {
+    uint64_t user_data;
+    int res;
+    if (!uring_wait(&file->ring,&user_data,&res))
+        return false;
+    slot_t *done = file->slots + user_data;
+    done->res = res;
+    if (-EINVAL == res) {
+        done->res = slot_io(file->fd,file->writing,done->buf,done->len,done->offset);
+        file->uring_unsupported = true;
+    } else if (res > 0 && (size_t)res < done->len) {
+        long long rest = slot_io(file->fd,file->writing,done->buf + res,done->len - (size_t)res,done->offset + (unsigned long long)res);
+        done->res = rest < 0 ? -1 : res + rest;
+    }
+    done->state = SLOT_DONE;
+    return true;
+}
+
+/**
+ * Переход с io_uring на поток ввода-вывода: дождаться всех отданных ядру
+ * операций, закрыть кольцо и запустить поток. Следующим программа отдаст
+ * буфер current, с него поток и начнёт.
+ * */
+static void async_file_fallback(async_file_t *file) {
+    for (unsigned idx = 0; idx != PIPELINE_DEPTH; ++idx) {
+        slot_t *slot = file->slots + idx;
+        while (SLOT_PENDING == slot->state)
+            if (!uring_reap(file)) {
+                slot->res = -1;
+                slot->state = SLOT_DONE;
+            }
+    }
+    uring_free(&file->ring);
+    file->queue_head = file->current % PIPELINE_DEPTH;
+    async_file_start_thread(file);
+}
+
+/**
+ * Ожидание завершения операции над буфером idx.
+ * Для буфера, операция над которым уже завершена, функция ничего не делает.
+ * */
+static void slot_wait(async_file_t *file, unsigned idx) {
+    slot_t *slot = file->slots + idx;
+    if (BACKEND_THREAD == file->backend) {
+        pthread_mutex_lock(&file->lock);
+        while (SLOT_PENDING == slot->state)
+            pthread_cond_wait(&file->changed,&file->lock);
+        pthread_mutex_unlock(&file->lock);
+    } else if (BACKEND_URING == file->backend) {
+        while (SLOT_PENDING == slot->state)
+            if (!uring_reap(file)) {
+                slot->res = -1;
+                slot->state = SLOT_DONE;
+            }
+        if (file->uring_unsupported)
+            async_file_fallback(file);
+    }
+    if (slot->res < 0 || (file->writing && (size_t)slot->res != slot->len))
+        file->failed = true;
+}
+
+static bool async_file_open(async_file_t *file, char const *path, backend_t backend, bool writing) {
+    memset(file,0,sizeof(*file));
+    file->backend = backend;
+    file->writing = writing;
+    file->ring.fd = -1;
+    file->fd = writing ? open(path,O_WRONLY | O_CREAT | O_TRUNC,0644) : open(path,O_RDONLY);
+    if (file->fd < 0)
+        return false;
+    for (unsigned idx = 0; idx != PIPELINE_DEPTH; ++idx) {
+        file->slots[idx].buf = malloc(PIPELINE_BLOCK);
+        if (NULL == file->slots[idx].buf)
+            goto FAIL;
+    }
+    if (BACKEND_URING == backend) {
+        if (!uring_init(&file->ring,2 * PIPELINE_DEPTH))
+            file->backend = BACKEND_THREAD; //io_uring недоступен - используем поток
+        else if (!uring_supports(&file->ring,writing ? IORING_OP_WRITE : IORING_OP_READ)) {
+            uring_free(&file->ring); //ядро старше 5.6 - используем поток
+            file->backend = BACKEND_THREAD;
+        }
+    }
+    if (BACKEND_THREAD == file->backend)
+        async_file_start_thread(file);
+    return true;
+
+FAIL:
+    for (unsigned idx = 0; idx != PIPELINE_DEPTH; ++idx)
+        free(file->slots[idx].buf);
+    close(file->fd);
+    return false;
+}
+
+/**
+ * Завершение работы: ожидание всех операций, остановка потока, закрытие файла.
+ * Возвращает false, если хотя бы одна операция завершилась ошибкой.
+ * */
+static bool async_file_close(async_file_t *file) {
+    for (unsigned idx = 0; idx != PIPELINE_DEPTH; ++idx)
+        slot_wait(file,idx);
+    if (BACKEND_THREAD == file->backend) {
+        pthread_mutex_lock(&file->lock);
+        file->stop = true;
+        pthread_cond_broadcast(&file->changed);
+        pthread_mutex_unlock(&file->lock);
+        pthread_join(file->thread,NULL);
+        pthread_cond_destroy(&file->changed);
+        pthread_mutex_destroy(&file->lock);
+    }
+    uring_free(&file->ring);
+    for (unsigned idx = 0; idx != PIPELINE_DEPTH; ++idx)
+        free(file->slots[idx].buf);
+    bool success = !file->failed;
+    success = 0 == close(file->fd) && success;
+    return success;
+}
+
+/**
+ * Запись: программа получает свободный буфер async_writer_buffer, заполняет его
+ * и отдаёт на запись async_writer_submit, после чего сразу получает следующий.
+ * */
+bool async_writer_open(async_file_t *file, char const *path, backend_t backend) {
+    return async_file_open(file,path,backend,true);
+}
+
+char *async_writer_buffer(async_file_t *file) {
+    slot_t *slot = file->slots + file->current;
+    slot_wait(file,file->current); //буфер может ещё записываться - ждём
+    if (BACKEND_THREAD == file->backend) { //состояние буферов поток читает под мьютексом
+        pthread_mutex_lock(&file->lock);
+        slot->state = SLOT_FREE;
+        pthread_mutex_unlock(&file->lock);
+    } else {
+        slot->state = SLOT_FREE;
+    }
+    return slot->buf;
+}
+
+bool async_writer_submit(async_file_t *file, size_t len) {
+    slot_t *slot = file->slots + file->current;
+    slot->len = len;
+    slot->offset = file->next_offset;
+    file->next_offset += len;
+    slot_submit(file,file->current);
+    file->current = (file->current + 1) % PIPELINE_DEPTH;
+    return !file->failed;
+}
+
+bool async_writer_close(async_file_t *file) {
+    return async_file_close(file);
+}
+
+/**
+ * Чтение: при открытии все буферы сразу отдаются на чтение первых блоков файла.
+ * async_reader_next возвращает следующий блок по порядку, а предыдущий блок,
+ * с которым программа уже закончила, отдаёт на чтение следующей части файла.
+ * Возвращает false в конце файла или при ошибке (тогда file->failed == true).
+ * */
+bool async_reader_open(async_file_t *file, char const *path, backend_t backend) {
+    if (!async_file_open(file,path,backend,false))
+        return false;
+    for (unsigned idx = 0; idx != PIPELINE_DEPTH; ++idx) {
+        file->slots[idx].len = PIPELINE_BLOCK;
+        file->slots[idx].offset = file->next_offset;
+        file->next_offset += PIPELINE_BLOCK;
+        slot_submit(file,idx);
+    }
+    file->current = PIPELINE_DEPTH; //признак: программа ещё не получила ни одного блока
+    return true;
+}
+
+bool async_reader_next(async_file_t *file, char const **data, size_t *len) {
+    if (PIPELINE_DEPTH != file->current) { //предыдущий блок больше не нужен
+        slot_t *prev = file->slots + file->current;
+        prev->offset = file->next_offset;
+        file->next_offset += PIPELINE_BLOCK;
+        slot_submit(file,file->current);
+    }
+    file->current = PIPELINE_DEPTH == file->current ? 0 : (file->current + 1) % PIPELINE_DEPTH;
+    slot_t *slot = file->slots + file->current;
+    slot_wait(file,file->current);
+    if (file->failed || slot->res <= 0)
+        return false;
+    *data = slot->buf;
+    *len = (size_t)slot->res;
+    return true;
+}
+
+bool async_reader_close(async_file_t *file) {
+    return async_file_close(file);
+}
+
+/*------------------------------ пример ------------------------------*/
+
+/**
+ * Разбор потока целых чисел, разделённых пробельными символами. Разбор идёт
+ * посимвольно и хранит состояние между вызовами, поэтому число может быть
+ * разрезано границей блока в любом месте.
+ * */
+typedef struct {
+    unsigned long long count;
+    long long sum;
+    long long value;
+    bool in_number, negative, error;
+} number_stream_t;
+
+static void number_stream_feed(number_stream_t *s, char const *p, size_t len) {
+    for (size_t idx = 0; idx != len && !s->error; ++idx) {
+        char c = p[idx];
+        if ((unsigned)(c - '0') < 10u) {
+            s->value = s->value * 10 + (c - '0');
+            s->in_number = true;
+        } else if (' ' == c || ('\t' <= c && c <= '\r')) {
+            if (s->in_number) {
+                s->sum += s->negative ? -s->value : s->value;
+                ++s->count;
+            }
+            s->value = 0;
+            s->in_number = s->negative = false;
+        } else if ('-' == c && !s->in_number && !s->negative) {
+            s->negative = true;
+        } else {
+            s->error = true;
+        }
+    }
+}
+
+static void number_stream_finish(number_stream_t *s) {
+    number_stream_feed(s,"\n",1);
+}
+
+double seconds_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec + ts.tv_nsec * 1.e-9;
+}
+
+static char const *backend_names[3] = {"sync", "thread", "io_uring"};
+
+/**
+ * Запись файла из how_many чисел rand()%100 по одному в строке, как
+ * random_numbers_file_write_test, через асинхронный файл. *sum - сумма чисел для проверки,
+ * *bytes - количество записанных байт.
+ * */
+bool async_numbers_write(char const *path, backend_t backend, unsigned long long how_many, long long *sum, unsigned long long *bytes) {
+    async_file_t file;
+    if (!async_writer_open(&file,path,backend)) {
+        printf("Can't open file!\n");
+        return false;
+    }
+    *sum = 0;
+    *bytes = 0;
+    unsigned long long count = 0;
+    while (count != how_many) {
+        char *buf = async_writer_buffer(&file);
+        size_t used = 0;
+        for (; count != how_many && used + 4 <= PIPELINE_BLOCK; ++count) {
+            int num = rand()%100;
+            *sum += num;
+            if (num >= 10) buf[used++] = (char)('0' + num / 10);
+            buf[used++] = (char)('0' + num % 10);
+            buf[used++] = '\n';
+        }
+        *bytes += used;
+        if (!async_writer_submit(&file,used))
+            break;
+    }
+    if (!async_writer_close(&file)) {
+        printf("Error in printing data to file!\nProcess terminated!\n");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Чтение и разбор файла; *bytes - количество прочитанных байт.
+ * */
+bool async_numbers_read(char const *path, backend_t backend, number_stream_t *stream, unsigned long long *bytes) {
+    async_file_t file;
+    if (!async_reader_open(&file,path,backend)) {
+        printf("Can't open file to read!\n");
+        return false;
+    }
+    memset(stream,0,sizeof(*stream));
+    *bytes = 0;
+    char const *data;
+    size_t len;
+    while (async_reader_next(&file,&data,&len)) {
+        number_stream_feed(stream,data,len);
+        *bytes += len;
+    }
+    number_stream_finish(stream);
+    if (!async_reader_close(&file)) {
+        printf("Error while reading the file!\n");
+        return false;
+    }
+    if (stream->error)
+        printf("Input format error!\n");
+    return true;
+}
+
+/**
+ * Запись и чтение файла из how_many чисел всеми тремя способами.
+ * */
+void async_pipeline_benchmark(unsigned long long how_many) {
+    printf("backend     write, MB/s   read, MB/s\n");
+    for (unsigned backend = BACKEND_SYNC; backend <= BACKEND_URING; ++backend) {
+        srand(57);
+        long long expected;
+        unsigned long long bytes_written, bytes_read;
+        double start = seconds_now();
+        if (!async_numbers_write("./new_file.txt",backend,how_many,&expected,&bytes_written))
+            return;
+        double write_seconds = seconds_now() - start;
+
+        number_stream_t stream;
+        start = seconds_now();
+        if (!async_numbers_read("./new_file.txt",backend,&stream,&bytes_read))
+            return;
+        double read_seconds = seconds_now() - start;
+
+        printf("%-10s %12.1f %12.1f %s\n",backend_names[backend],bytes_written / 1.e6 / write_seconds,bytes_read / 1.e6 / read_seconds,
+               stream.count == how_many && stream.sum == expected && bytes_read == bytes_written ? "" : "RESULTS DIFFER!");
+    }
+}
+
+/**
+ * 100 миллионов чисел - около 290 МБ, файл помещается в кэш страниц,
+ * и сравнение показывает в основном накладные расходы бэкендов.
+ * */
+void async_pipeline_test() {
+    async_pipeline_benchmark(100000000ull);
+}
+
+/**
+ * Файл больше оперативной памяти: кэш страниц не помогает, и скорость
+ * определяется диском. Размер файла задаётся в гигабайтах.
+ * */
+void async_pipeline_huge_test() {
+    double ram = (double)sysconf(_SC_PHYS_PAGES) * (double)sysconf(_SC_PAGESIZE) / 1.e9;
+    double gigabytes;
+    printf("RAM size is %.1f GB. Enter file size in GB:",ram); fflush(stdout);
+    if (1 != scanf("%lf",&gigabytes) || gigabytes <= 0.) {
+        printf("Input format error!\n");
+        return;
+    }
+    async_pipeline_benchmark((unsigned long long)(gigabytes * 1.e9 / 2.9)); //в среднем 2.9 символа на число
+}
+
+int main() {
+    if (false) async_pipeline_test();
+    if (false) async_pipeline_huge_test();
+    return 0;
+}
@@ -0,0 +1,681 @@
+/**
+ * Файл new_file.txt из 42_files_ascii.c хранит числа rand()%100 текстом:
+ * в среднем 2.9 байта на число, хотя для числа от 0 до 99 достаточно 7 бит.
+ * Лишние байты - это лишнее время чтения с диска (см. 57_async_file_pipeline.c).
+ *
+ * Рассмотрим простые и быстрые способы сжатия массивов целых чисел:
+ * 1) упаковка битов со смещением (frame of reference + bit packing):
+ *    из чисел блока вычитается минимум, и разности хранятся ровно в том
+ *    количестве бит, которое нужно для наибольшей из них;
+ * 2) разности соседних чисел (delta) в "зигзаг"-кодировке и переменной длине
+ *    (LEB128 varint): для возрастающих или медленно меняющихся данных,
+ *    например, отметок времени, разности малы, хотя сами числа велики.
+ *    Зигзаг переставляет числа со знаком так: 0, -1, 1, -2, 2 ... -> 0, 1, 2, 3, 4 ...,
+ *    а varint хранит по 7 бит в байте, старший бит байта означает "дальше есть ещё байт".
+ * Файл делится на блоки по PACK_BLOCK чисел, для каждого блока выбирается
+ * тот способ, который даёт меньший размер. В конце файла записывается индекс -
+ * смещения всех блоков. Поэтому блоки можно распаковывать независимо:
+ * параллельно в несколько потоков или только те, что нужны ("перемотка").
+ *
+ * Упакованные биты располагаются "вертикально" в 8 полосах: число номер i
+ * хранится в 32-битных словах полосы i % 8, а слова полос чередуются.
+ * Тогда распаковка восьми соседних чисел - это одни и те же сдвиги и маски
+ * над восемью словами, т.е. одна векторная инструкция AVX2 на каждую операцию.
+ *
+ * Компиляция:
+ * gcc 58_integer_compression.c -o pack -std=c99 -O2 -mavx2 -pthread
+ * */
+
+#define _DEFAULT_SOURCE //mmap sysconf clock_gettime
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>   //malloc realloc free rand
+#include <stdint.h>   //uint8_t uint32_t uint64_t
+#include <string.h>   //memcpy memcmp memset
+#include <time.h>     //clock_gettime
+#include <fcntl.h>    //open
+#include <unistd.h>   //close sysconf
+#include <sys/mman.h> //mmap munmap
+#include <sys/stat.h> //fstat
+#include <pthread.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#define PACK_MAGIC "INTPACK"  //8 байт вместе с завершающим нулём
+#define PACK_VERSION 1u
+#define PACK_BLOCK 65536u     //чисел в блоке, кратно PACK_GROUP
+#define PACK_LANES 8u
+#define PACK_GROUP 256u       //8 полос по 32 числа
+
+typedef enum {
+    BLOCK_BITPACK = 1,
+    BLOCK_DELTA_VARINT = 2
+} block_method_t;
+
+/**
+ * Заголовок блока. Данные блока следуют сразу за ним, их размер кратен 4 байтам,
+ * так что и заголовки, и 32-битные слова упакованных битов выровнены.
+ * */
+typedef struct {
+    uint32_t count;
+    uint8_t method;
+    uint8_t bits;         //для BLOCK_BITPACK - бит на число
+    uint16_t reserved;
+    uint32_t base;        //минимум блока (BLOCK_BITPACK) или первое число (BLOCK_DELTA_VARINT)
+    uint32_t payload_bytes;
+} block_header_t;
+
+/**
+ * Начало и конец файла. Конец ("подвал") записывается последним, поэтому
+ * файл можно писать потоком, не возвращаясь к его началу.
+ * */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t block_size;
+} pack_header_t;
+
+typedef struct {
+    uint64_t count;         //всего чисел
+    uint64_t block_count;
+    uint64_t index_offset;  //смещение индекса: block_count чисел uint64_t - смещения блоков
+    char magic[8];
+} pack_footer_t;
+
+/*------------------------------ упаковка ------------------------------*/
+
+static unsigned bit_width(uint32_t v) {
+    return 0 == v ? 0 : 32u - (unsigned)__builtin_clz(v);
+}
+
+static uint32_t zigzag(uint32_t delta) {
+    return delta << 1 ^ (uint32_t)-(int32_t)(delta >> 31);
+}
+
+static uint32_t unzigzag(uint32_t z) {
+    return z >> 1 ^ (uint32_t)-(int32_t)(z & 1u);
+}
+
+/**
+ * Упаковка группы из 256 чисел (разностей с минимумом) по bits бит в 8 полос.
+ * Каждая полоса занимает ровно bits слов: 32 числа * bits бит = bits * 32 бит.
+ * */
+static void pack_group(uint32_t const *values, unsigned bits, uint32_t *words) {
+    for (unsigned lane = 0; lane != PACK_LANES; ++lane) {
+        uint64_t acc = 0;
+        unsigned have = 0, word = 0;
+        for (unsigned k = 0; k != PACK_GROUP / PACK_LANES; ++k) {
+            acc |= (uint64_t)values[k * PACK_LANES + lane] << have;
+            have += bits;
+            if (have >= 32) {
+                words[word++ * PACK_LANES + lane] = (uint32_t)acc;
+                acc >>= 32;
+                have -= 32;
+            }
+        }
+    }
+}
+
+/**
+ * Кодирование блока в buf (не менее packed_block_bound(count) байт).
+ * Возвращает размер блока вместе с заголовком.
+ * */
+static size_t packed_block_bound(size_t count) {
+    size_t groups = (count + PACK_GROUP - 1) / PACK_GROUP;
+    size_t bitpack = groups * PACK_LANES * 32 * sizeof(uint32_t), varint = 5 * count + 4;
+    return sizeof(block_header_t) + (bitpack > varint ? bitpack : varint);
+}
+
+static size_t encode_block(int const *values, size_t count, char *buf, uint32_t *scratch) {
+    uint32_t min = (uint32_t)values[0] ^ 0x80000000u, max = min; //сравнение int через unsigned со сдвинутым знаком
+    for (size_t idx = 1; idx != count; ++idx) {
+        uint32_t v = (uint32_t)values[idx] ^ 0x80000000u;
+        if (v < min) min = v;
+        if (v > max) max = v;
+    }
+    unsigned bits = bit_width(max - min);
+    size_t groups = (count + PACK_GROUP - 1) / PACK_GROUP;
+    size_t bitpack_bytes = groups * PACK_LANES * bits * sizeof(uint32_t);
+
+    //varint сразу пишется в buf; если он окажется больше упаковки битов, буфер перезапишется
+    block_header_t *header = (block_header_t *)buf;
+    uint8_t *p = (uint8_t *)(buf + sizeof(block_header_t));
+    size_t varint_bytes = 0;
+    for (size_t idx = 1; idx != count && varint_bytes < bitpack_bytes; ++idx) {
+        uint32_t z = zigzag((uint32_t)values[idx] - (uint32_t)values[idx - 1]);
+        while (z >= 0x80u) {
+            p[varint_bytes++] = (uint8_t)(z | 0x80u);
+            z >>= 7;
+        }
+        p[varint_bytes++] = (uint8_t)z;
+    }
+    if (varint_bytes < bitpack_bytes) {
+        while (0 != varint_bytes % 4) p[varint_bytes++] = 0;
+        *header = (block_header_t){(uint32_t)count, BLOCK_DELTA_VARINT, 0, 0, (uint32_t)values[0], (uint32_t)varint_bytes};
+        return sizeof(block_header_t) + varint_bytes;
+    }
+
+    uint32_t base = min ^ 0x80000000u; //минимум как число int в дополнительном коде
+    uint32_t *words = (uint32_t *)(buf + sizeof(block_header_t));
+    for (size_t group = 0; group != groups; ++group) {
+        size_t first = group * PACK_GROUP;
+        for (size_t k = 0; k != PACK_GROUP; ++k) //последняя группа дополняется нулями
+            scratch[k] = first + k < count ? (uint32_t)values[first + k] - base : 0u;
+        if (0 != bits)
+            pack_group(scratch,bits,words + group * PACK_LANES * bits);
+    }
+    *header = (block_header_t){(uint32_t)count, BLOCK_BITPACK, (uint8_t)bits, 0, base, (uint32_t)bitpack_bytes};
+    return sizeof(block_header_t) + bitpack_bytes;
+}
+
+/**
+ * Потоковая запись: числа накапливаются в блок, заполненный блок
+ * кодируется и записывается, его смещение запоминается в индексе.
+ * */
+typedef struct {
+    FILE *stream;
+    int *block;
+    size_t used;
+    char *encoded;
+    uint32_t *scratch;
+    uint64_t *index;
+    size_t block_count, index_capacity;
+    uint64_t offset, count;
+} packed_writer_t;
+
+bool packed_writer_open(packed_writer_t *w, char const *path) {
+    *w = (packed_writer_t){NULL, malloc(PACK_BLOCK * sizeof(int)), 0, malloc(packed_block_bound(PACK_BLOCK)),
+                           malloc(PACK_GROUP * sizeof(uint32_t)), malloc(64 * sizeof(uint64_t)), 0, 64, 0, 0};
+    if (NULL == w->block || NULL == w->encoded || NULL == w->scratch || NULL == w->index)
+        goto FAIL;
+    w->stream = fopen(path,"wb");
+    if (NULL == w->stream)
+        goto FAIL;
+    pack_header_t header = {PACK_MAGIC, PACK_VERSION, PACK_BLOCK};
+    fwrite(&header,sizeof(header),1,w->stream);
+    w->offset = sizeof(header);
+    return true;
+
+FAIL:
+    free(w->index);
+    free(w->scratch);
+    free(w->encoded);
+    free(w->block);
+    return false;
+}
+
+static bool packed_writer_flush_block(packed_writer_t *w) {
+    if (0 == w->used)
+        return true;
+    if (w->block_count == w->index_capacity) {
+        uint64_t *index = realloc(w->index,2 * w->index_capacity * sizeof(uint64_t));
+        if (NULL == index)
+            return false;
+        w->index = index;
+        w->index_capacity *= 2;
+    }
+    size_t size = encode_block(w->block,w->used,w->encoded,w->scratch);
+    w->index[w->block_count++] = w->offset;
+    fwrite(w->encoded,1,size,w->stream);
+    w->offset += size;
+    w->count += w->used;
+    w->used = 0;
+    return !ferror(w->stream);
+}
+
+bool packed_writer_put(packed_writer_t *w, int value) {
+    //полный блок записывается перед следующим числом: если записать не удалось, число не принимается
+    if (PACK_BLOCK == w->used && !packed_writer_flush_block(w))
+        return false;
+    w->block[w->used++] = value;
+    return true;
+}
+
+/**
+ * Запись последнего блока, индекса и "подвала". Возвращает false при любой ошибке записи.
+ * */
+bool packed_writer_close(packed_writer_t *w) {
+    bool success = packed_writer_flush_block(w);
+    if (0 != w->offset % sizeof(uint64_t)) { //индекс выравнивается на 8 байт: блоки выровнены только на 4
+        fwrite("\0\0\0\0",1,4,w->stream);
+        w->offset += 4;
+    }
+    pack_footer_t footer = {w->count, w->block_count, w->offset, PACK_MAGIC};
+    fwrite(w->index,sizeof(uint64_t),w->block_count,w->stream);
+    fwrite(&footer,sizeof(footer),1,w->stream);
+    success = !ferror(w->stream) && success;
+    success = 0 == fclose(w->stream) && success;
+    free(w->index);
+    free(w->scratch);
+    free(w->encoded);
+    free(w->block);
+    return success;
+}
+
+/*------------------------------ распаковка ------------------------------*/
+
+/**
+ * Распаковка группы: out[k * 8 + lane] - k-е число полосы lane.
+ * В скалярном варианте цикл по полосам внутренний, и он устроен
+ * так же, как векторный: каждая полоса проходит одни и те же шаги.
+ * */
+static void unpack_group_scalar(uint32_t const *words, unsigned bits, uint32_t base, int *out) {
+    uint32_t mask = 32 == bits ? 0xFFFFFFFFu : (1u << bits) - 1u;
+    for (unsigned lane = 0; lane != PACK_LANES; ++lane) {
+        uint64_t acc = 0;
+        unsigned have = 0;
+        uint32_t const *w = words + lane;
+        for (unsigned k = 0; k != PACK_GROUP / PACK_LANES; ++k) {
+            if (have < bits) {
+                acc |= (uint64_t)*w << have;
+                w += PACK_LANES;
+                have += 32;
+            }
+            out[k * PACK_LANES + lane] = (int)(base + ((uint32_t)acc & mask));
+            acc >>= bits;
+            have -= bits;
+        }
+    }
+}
+
+#if defined(__AVX2__)
+/**
+ * Векторная распаковка: cur - текущие 8 слов (по одному на полосу), shift - сколько
+ * бит текущих слов уже использовано. Если число не помещается в остаток слова,
+ * его старшие биты берутся из следующих 8 слов.
+ * */
+static void unpack_group_avx2(uint32_t const *words, unsigned bits, uint32_t base, int *out) {
+    __m256i mask = _mm256_set1_epi32(32 == bits ? -1 : (int)((1u << bits) - 1u));
+    __m256i basev = _mm256_set1_epi32((int)base);
+    __m256i cur = _mm256_loadu_si256((__m256i const *)words);
+    unsigned shift = 0, next_word = 1;
+    for (unsigned k = 0; k != PACK_GROUP / PACK_LANES; ++k) {
+        __m256i v = _mm256_srl_epi32(cur,_mm_cvtsi32_si128((int)shift));
+        if (shift + bits >= 32) {
+            __m256i next = next_word < bits ? _mm256_loadu_si256((__m256i const *)(words + next_word * PACK_LANES)) : _mm256_setzero_si256();
+            ++next_word;
+            if (shift + bits > 32)
+                v = _mm256_or_si256(v,_mm256_sll_epi32(next,_mm_cvtsi32_si128((int)(32 - shift))));
+            cur = next;
+            shift = shift + bits - 32;
+        } else {
+            shift += bits;
+        }
+        v = _mm256_add_epi32(_mm256_and_si256(v,mask),basev);
+        _mm256_storeu_si256((__m256i *)(out + k * PACK_LANES),v);
+    }
+}
+#endif
+
+/**
+ * Использовать ли векторную распаковку (если программа собрана с -mavx2).
+ * Переключатель нужен, чтобы сравнить скорость двух вариантов.
+ * */
+bool packed_decode_simd = true;
+
+static void unpack_group(uint32_t const *words, unsigned bits, uint32_t base, int *out) {
+    if (0 == bits) {
+        for (unsigned k = 0; k != PACK_GROUP; ++k) out[k] = (int)base;
+        return;
+    }
+#if defined(__AVX2__)
+    if (packed_decode_simd) {
+        unpack_group_avx2(words,bits,base,out);
+        return;
+    }
+#endif
+    unpack_group_scalar(words,bits,base,out);
+}
+
+/**
+ * Упакованный файл, отображённый в память.
+ * */
+typedef struct {
+    void *mapping;
+    size_t size;
+    uint64_t count, block_count;
+    uint32_t block_size;
+    uint64_t const *index;
+} packed_file_t;
+
+/**
+ * Открытие с проверкой: смещения блоков и их размеры не должны выходить
+ * за пределы файла (см. table_open в 54_binary_function_table.c).
+ * Размер блока должен быть равен PACK_BLOCK: буферы для распаковки блока
+ * выделяются на PACK_BLOCK чисел. Сравнения записаны вычитанием из заведомо
+ * большего числа, чтобы смещение около 2^64 не переполнило сумму.
+ * */
+bool packed_open(char const *path, packed_file_t *file) {
+    memset(file,0,sizeof(*file));
+    int fd = open(path,O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (0 != fstat(fd,&st) || (uint64_t)st.st_size < sizeof(pack_header_t) + sizeof(pack_footer_t)) {
+        close(fd);
+        return false;
+    }
+    void *mapping = mmap(NULL,(size_t)st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+    close(fd);
+    if (MAP_FAILED == mapping)
+        return false;
+
+    char const *bytes = mapping;
+    uint64_t size = (uint64_t)st.st_size;
+    pack_header_t header;
+    pack_footer_t footer;
+    memcpy(&header,bytes,sizeof(header));
+    memcpy(&footer,bytes + size - sizeof(footer),sizeof(footer));
+    bool valid = 0 == memcmp(header.magic,PACK_MAGIC,8) && 0 == memcmp(footer.magic,PACK_MAGIC,8) &&
+                 PACK_VERSION == header.version && PACK_BLOCK == header.block_size &&
+                 footer.index_offset <= size - sizeof(footer) && 0 == footer.index_offset % sizeof(uint64_t) &&
+                 footer.block_count == (size - sizeof(footer) - footer.index_offset) / sizeof(uint64_t) &&
+                 footer.count <= footer.block_count * header.block_size;
+    uint64_t const *index = NULL;
+    if (valid) //смещение указывает внутрь файла
+        index = (uint64_t const *)(bytes + footer.index_offset);
+    for (uint64_t block = 0; valid && block != footer.block_count; ++block) {
+        block_header_t bh;
+        valid = footer.index_offset >= sizeof(bh) && index[block] >= sizeof(header) &&
+                index[block] <= footer.index_offset - sizeof(bh) && 0 == index[block] % 4;
+        if (!valid) break;
+        memcpy(&bh,bytes + index[block],sizeof(bh));
+        uint64_t expected = block + 1 == footer.block_count ? footer.count - block * header.block_size : header.block_size;
+        uint64_t groups = (bh.count + PACK_GROUP - 1) / PACK_GROUP;
+        valid = bh.count == expected && bh.payload_bytes <= footer.index_offset - index[block] - sizeof(bh) &&
+                ((BLOCK_BITPACK == bh.method && bh.bits <= 32 && bh.payload_bytes == groups * PACK_LANES * (uint64_t)bh.bits * 4u) ||
+                 (BLOCK_DELTA_VARINT == bh.method && (0 != bh.count || 0 == bh.payload_bytes)));
+    }
+    if (!valid) {
+        munmap(mapping,(size_t)st.st_size);
+        return false;
+    }
+    *file = (packed_file_t){mapping, (size_t)st.st_size, footer.count, footer.block_count, header.block_size, index};
+    return true;
+}
+
+void packed_close(packed_file_t *file) {
+    if (NULL != file->mapping)
+        munmap(file->mapping,file->size);
+    memset(file,0,sizeof(*file));
+}
+
+/**
+ * Распаковка блока в out (место для PACK_BLOCK чисел). Последняя неполная
+ * группа распаковывается во временный буфер, чтобы не писать за пределы out.
+ * Возвращает количество чисел или -1, если данные varint повреждены.
+ * */
+long decode_block(packed_file_t const *file, uint64_t block, int *out) {
+    char const *bytes = file->mapping;
+    block_header_t bh;
+    memcpy(&bh,bytes + file->index[block],sizeof(bh));
+    char const *payload = bytes + file->index[block] + sizeof(bh);
+
+    if (BLOCK_BITPACK == bh.method) {
+        uint32_t const *words = (uint32_t const *)payload;
+        size_t full = bh.count / PACK_GROUP;
+        for (size_t group = 0; group != full; ++group)
+            unpack_group(words + group * PACK_LANES * bh.bits,bh.bits,bh.base,out + group * PACK_GROUP);
+        if (0 != bh.count % PACK_GROUP) {
+            int tail[PACK_GROUP];
+            unpack_group(words + full * PACK_LANES * bh.bits,bh.bits,bh.base,tail);
+            memcpy(out + full * PACK_GROUP,tail,(bh.count % PACK_GROUP) * sizeof(int));
+        }
+        return (long)bh.count;
+    }
+
+    uint8_t const *p = (uint8_t const *)payload, *end = p + bh.payload_bytes;
+    uint32_t value = bh.base;
+    if (0 != bh.count) out[0] = (int)value;
+    for (uint32_t idx = 1; idx < bh.count; ++idx) {
+        uint32_t z = 0;
+        for (unsigned shift = 0;; shift += 7) {
+            if (p == end || shift > 28)
+                return -1;
+            uint8_t byte = *p++;
+            z |= (uint32_t)(byte & 0x7Fu) << shift;
+            if (byte < 0x80u) break;
+        }
+        value += unzigzag(z);
+        out[idx] = (int)value;
+    }
+    return (long)bh.count;
+}
+
+/**
+ * "Перемотка": чисел с номерами [first, first + count) распаковываются
+ * только блоки, в которые они попадают. Номер блока вычисляется делением,
+ * т.к. все блоки, кроме последнего, одного размера.
+ * */
+bool packed_read_range(packed_file_t const *file, uint64_t first, size_t count, int *out, int *block_buffer) {
+    if (first > file->count || count > file->count - first)
+        return false;
+    while (0 != count) {
+        uint64_t block = first / file->block_size, inside = first % file->block_size;
+        long got = decode_block(file,block,block_buffer);
+        if (got < 0)
+            return false;
+        size_t take = (size_t)got - (size_t)inside < count ? (size_t)got - (size_t)inside : count;
+        memcpy(out,block_buffer + inside,take * sizeof(int));
+        out += take;
+        first += take;
+        count -= take;
+    }
+    return true;
+}
+
+typedef struct {
+    packed_file_t const *file;
+    int *out;
+    size_t thread_idx, thread_count;
+    bool failed;
+} decode_task_t;
+
+void *decode_worker(void *arg) {
+    decode_task_t *task = arg;
+    for (uint64_t block = task->thread_idx; block < task->file->block_count; block += task->thread_count)
+        if (decode_block(task->file,block,task->out + block * task->file->block_size) < 0)
+            task->failed = true;
+    return NULL;
+}
+
+/**
+ * Распаковка всего файла в out (file->count чисел) в thread_count потоков,
+ * по образцу parallel_harmonic_sum из 47_parallel_harmonic_series.c.
+ * */
+bool packed_decode_parallel(packed_file_t const *file, size_t thread_count, int *out) {
+    if (0 == thread_count) thread_count = 1;
+    if (thread_count > file->block_count) thread_count = file->block_count > 0 ? (size_t)file->block_count : 1;
+    decode_task_t *tasks = malloc(thread_count * sizeof(decode_task_t));
+    pthread_t *threads = malloc(thread_count * sizeof(pthread_t));
+    bool success = false;
+    if (NULL == tasks || NULL == threads)
+        goto CLEAR;
+
+    for (size_t idx = 0; idx != thread_count; ++idx)
+        tasks[idx] = (decode_task_t){file, out, idx, thread_count, false};
+    size_t started = 1;
+    for (; started != thread_count; ++started)
+        if (0 != pthread_create(threads + started,NULL,decode_worker,tasks + started))
+            break;
+    decode_worker(tasks + 0);
+    for (size_t idx = 1; idx < started; ++idx)
+        pthread_join(threads[idx],NULL);
+    for (size_t idx = started; idx < thread_count; ++idx)
+        decode_worker(tasks + idx);
+    success = true;
+    for (size_t idx = 0; idx != thread_count; ++idx)
+        success = success && !tasks[idx].failed;
+
+CLEAR:
+    free(threads);
+    free(tasks);
+    return success;
+}
+
+double seconds_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec + ts.tv_nsec * 1.e-9;
+}
+
+/*------------------------------ проверки ------------------------------*/
+
+/**
+ * Разные виды данных: числа rand()%100 (как в new_file.txt), возрастающие
+ * отметки времени, произвольные int, константа, отрицательные числа.
+ * Файл распаковывается целиком и по случайным диапазонам, результат сравнивается с исходным.
+ * */
+void packed_round_trip_test() {
+    size_t const count = 1000003u; //не кратно размеру блока и группы
+    int *values = malloc(count * sizeof(int)), *back = malloc(count * sizeof(int)), *block = malloc(PACK_BLOCK * sizeof(int));
+    if (NULL == values || NULL == back || NULL == block) {
+        printf("Can't allocate memory!\n");
+        goto CLEAR;
+    }
+    char const *names[5] = {"rand()%100", "timestamps", "full int", "constant", "negative"};
+    srand(58);
+    for (unsigned kind = 0; kind != 5; ++kind) {
+        int t = 1600000000;
+        for (size_t idx = 0; idx != count; ++idx) {
+            if (0 == kind) values[idx] = rand()%100;
+            else if (1 == kind) values[idx] = t += rand()%1000;
+            else if (2 == kind) values[idx] = (int)((unsigned)rand() << 16 ^ (unsigned)rand());
+            else if (3 == kind) values[idx] = 42;
+            else values[idx] = -(rand()%5000) - 2147478000;
+        }
+
+        packed_writer_t writer;
+        if (!packed_writer_open(&writer,"./new_file.pack")) {
+            printf("Can't open file!\n");
+            goto CLEAR;
+        }
+        for (size_t idx = 0; idx != count; ++idx)
+            packed_writer_put(&writer,values[idx]);
+        if (!packed_writer_close(&writer)) {
+            printf("Error in printing data to file!\n");
+            goto CLEAR;
+        }
+
+        packed_file_t file;
+        if (!packed_open("./new_file.pack",&file)) {
+            printf("Input format error!\n");
+            goto CLEAR;
+        }
+        memset(back,0,count * sizeof(int));
+        bool same = packed_decode_parallel(&file,4,back) && 0 == memcmp(values,back,count * sizeof(int));
+        for (unsigned probe = 0; probe != 100 && same; ++probe) {
+            uint64_t first = (uint64_t)rand() * RAND_MAX % count;
+            size_t len = (size_t)rand() % 200000u;
+            if (len > count - first) len = count - (size_t)first;
+            same = packed_read_range(&file,first,len,back,block) && 0 == memcmp(values + first,back,len * sizeof(int));
+        }
+        printf("%-11s %5.2f bits/number %s\n",names[kind],8. * file.size / count,same ? "" : "RESULTS DIFFER!");
+        packed_close(&file);
+    }
+
+CLEAR:
+    free(block);
+    free(back);
+    free(values);
+}
+
+/**
+ * Скорость распаковки 100 миллионов чисел rand()%100: скалярная и векторная
+ * распаковка в один поток и векторная во все ядра. Для сравнения - размер
+ * того же файла в текстовом виде.
+ * */
+void packed_speed_test() {
+    size_t const count = 100000000u;
+    int *values = malloc(count * sizeof(int)), *back = malloc(count * sizeof(int));
+    if (NULL == values || NULL == back) {
+        printf("Can't allocate memory!\n");
+        goto CLEAR;
+    }
+    srand(23);
+    size_t text_bytes = 0;
+    for (size_t idx = 0; idx != count; ++idx) {
+        values[idx] = rand()%100;
+        text_bytes += values[idx] < 10 ? 2 : 3; //цифры и '\n'
+    }
+    double start = seconds_now();
+    packed_writer_t writer;
+    if (!packed_writer_open(&writer,"./new_file.pack")) {
+        printf("Can't open file!\n");
+        goto CLEAR;
+    }
+    for (size_t idx = 0; idx != count; ++idx)
+        packed_writer_put(&writer,values[idx]);
+    if (!packed_writer_close(&writer)) {
+        printf("Error in printing data to file!\n");
+        goto CLEAR;
+    }
+    double encode_seconds = seconds_now() - start;
+
+    packed_file_t file;
+    if (!packed_open("./new_file.pack",&file)) {
+        printf("Input format error!\n");
+        goto CLEAR;
+    }
+    printf("text %.1f MB, packed %.1f MB (x%.1f), encode %.1f M numbers/s\n",text_bytes / 1.e6,file.size / 1.e6,
+           (double)text_bytes / file.size,count / encode_seconds / 1.e6);
+
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t threads[3] = {1, 1, cores > 0 ? (size_t)cores : 1};
+    char const *names[3] = {"scalar", "simd", "simd, all cores"};
+    for (unsigned variant = 0; variant != 3; ++variant) {
+        packed_decode_simd = 0 != variant;
+        memset(back,0,count * sizeof(int));
+        start = seconds_now();
+        bool success = packed_decode_parallel(&file,threads[variant],back);
+        double seconds = seconds_now() - start;
+        success = success && 0 == memcmp(values,back,count * sizeof(int));
+        printf("%-16s %8.1f M numbers/s %s\n",names[variant],count / seconds / 1.e6,success ? "" : "RESULTS DIFFER!");
+    }
+    packed_decode_simd = true;
+    packed_close(&file);
+
+CLEAR:
+    free(back);
+    free(values);
+}
+
+/**
+ * Сжатие существующего new_file.txt (например, после random_numbers_file_write_test).
+ * */
+void new_file_compress_test() {
+    FILE *in_stream = fopen("./new_file.txt","r");
+    if (NULL == in_stream) {
+        printf("Can't open file to read!\n");
+        return;
+    }
+    packed_writer_t writer;
+    if (!packed_writer_open(&writer,"./new_file.pack")) {
+        printf("Can't open file!\n");
+        fclose(in_stream);
+        return;
+    }
+    int num;
+    while (1 == fscanf(in_stream,"%d",&num))
+        packed_writer_put(&writer,num);
+    if (!feof(in_stream))
+        printf("Input format error!\n");
+    long text_bytes = ftell(in_stream);
+    fclose(in_stream);
+    if (!packed_writer_close(&writer)) {
+        printf("Error in printing data to file!\n");
+        return;
+    }
+    printf("%llu numbers: %ld bytes of text -> %llu bytes packed\n",(unsigned long long)writer.count,text_bytes,
+           (unsigned long long)(writer.offset + writer.block_count * sizeof(uint64_t) + sizeof(pack_footer_t)));
+}
+
+int main() {
+    if (false) packed_round_trip_test();
+    if (false) packed_speed_test();
+    if (false) new_file_compress_test();
+    return 0;
+}
@@ -0,0 +1,560 @@
+/**
+ * Чтобы прочитать N-е число из new_file.txt (42_files_ascii.c), fscanf
+ * приходится разобрать все N - 1 чисел перед ним: строки разной длины,
+ * и где начинается N-я строка, заранее неизвестно.
+ *
+ * Индекс строк - отдельный маленький файл рядом с текстом ("sidecar"),
+ * в котором записаны смещения начала каждой K-й строки (K = stride).
+ * Тогда для N-й строки достаточно перейти к смещению строки N / K * K
+ * и пропустить не более K - 1 строк. При K = 1024 индекс занимает
+ * 8 байт на 1024 строки, т.е. около 0.3% от размера текста из чисел rand()%100.
+ *
+ * Построение индекса - подсчёт символов '\n', и его можно разделить между потоками
+ * так же, как разбор в 53_mmap_parallel_parsing.c: первый проход считает строки
+ * в каждом куске файла, префиксные суммы дают номер первой строки каждого куска,
+ * второй проход записывает смещения нужных строк.
+ *
+ * Если файл дописывается (например, программа добавляет новые измерения),
+ * индекс можно обновить, просмотрев только новую часть файла.
+ * Индексируются только завершённые строки: последняя строка без '\n'
+ * может быть ещё не дописана. Чтобы не обновлять индекс для файла,
+ * который был не дописан, а переписан заново, в индексе хранится хеш
+ * последних индексированных байт.
+ *
+ * Компиляция:
+ * gcc 59_line_offset_index.c -o line_index -std=c99 -O2 -pthread
+ * */
+
+#define _DEFAULT_SOURCE //mmap sysconf clock_gettime
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>   //malloc realloc free rand
+#include <stdint.h>   //uint32_t uint64_t
+#include <string.h>   //memchr memcmp memcpy
+#include <limits.h>   //INT_MIN INT_MAX
+#include <time.h>     //clock_gettime
+#include <fcntl.h>    //open
+#include <unistd.h>   //close sysconf
+#include <sys/mman.h> //mmap munmap
+#include <sys/stat.h> //fstat
+#include <pthread.h>  //pthread_create pthread_join
+
+#define LINE_INDEX_MAGIC "LINEIDX"   //8 байт вместе с завершающим нулём
+#define LINE_INDEX_VERSION 1u
+#define LINE_INDEX_STRIDE 1024u      //шаг по умолчанию
+#define LINE_INDEX_CHUNK (4u << 20)  //кусок файла для одного потока
+#define LINE_INDEX_HASHED 4096u      //сколько последних индексированных байт хешируется
+
+/**
+ * Индекс в памяти. offsets[k] - смещение начала строки k * stride.
+ * */
+typedef struct {
+    uint32_t stride;
+    uint64_t line_count;     //количество завершённых строк
+    uint64_t indexed_bytes;  //размер текста до последнего '\n' включительно
+    uint64_t tail_hash;      //хеш последних индексированных байт
+    uint64_t *offsets;
+    size_t entry_count, capacity;
+} line_index_t;
+
+/**
+ * Заголовок файла индекса, за ним - entry_count смещений uint64_t.
+ * */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t stride;
+    uint64_t line_count;
+    uint64_t indexed_bytes;
+    uint64_t tail_hash;
+    uint64_t entry_count;
+} line_index_header_t;
+
+/**
+ * Файл, отображённый в память только для чтения (как в 53_mmap_parallel_parsing.c).
+ * */
+typedef struct {
+    char const *data;
+    size_t size;
+} mapped_file_t;
+
+bool map_file(char const *path, mapped_file_t *file) {
+    *file = (mapped_file_t){NULL, 0};
+    int fd = open(path,O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (0 != fstat(fd,&st)) {
+        close(fd);
+        return false;
+    }
+    if (0 == st.st_size) {
+        close(fd);
+        return true;
+    }
+    void *data = mmap(NULL,(size_t)st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+    close(fd);
+    if (MAP_FAILED == data)
+        return false;
+    *file = (mapped_file_t){data, (size_t)st.st_size};
+    return true;
+}
+
+void unmap_file(mapped_file_t *file) {
+    if (NULL != file->data)
+        munmap((void *)file->data,file->size);
+    *file = (mapped_file_t){NULL, 0};
+}
+
+/**
+ * Хеш FNV-1a последних (не более LINE_INDEX_HASHED) байт перед end.
+ * */
+static uint64_t tail_hash(char const *text, uint64_t end) {
+    uint64_t hash = 14695981039346656037ull;
+    for (uint64_t pos = end > LINE_INDEX_HASHED ? end - LINE_INDEX_HASHED : 0; pos != end; ++pos)
+        hash = (hash ^ (unsigned char)text[pos]) * 1099511628211ull;
+    return hash;
+}
+
+void line_index_init(line_index_t *index, uint32_t stride) {
+    *index = (line_index_t){0 == stride ? LINE_INDEX_STRIDE : stride, 0, 0, tail_hash(NULL,0), NULL, 0, 0};
+}
+
+void line_index_free(line_index_t *index) {
+    free(index->offsets);
+    line_index_init(index,index->stride);
+}
+
+/**
+ * Количество '\n' в куске. memchr в стандартной библиотеке
+ * уже использует векторные инструкции, свой цикл не быстрее.
+ * */
+static uint64_t count_lines(char const *p, char const *end) {
+    uint64_t count = 0;
+    while (NULL != (p = memchr(p,'\n',(size_t)(end - p)))) {
+        ++count;
+        ++p;
+    }
+    return count;
+}
+
+//данные, которые получает каждый поток
+typedef struct {
+    char const *text;
+    uint64_t begin, end;        //индексируемая часть текста
+    size_t chunk_count;
+    size_t thread_idx, thread_count;
+    bool count_only;            //первый проход: только посчитать строки
+    uint64_t *counts;           //количество строк в каждом куске
+    uint64_t const *first_line; //номер строки, которая начинается в начале куска
+    uint64_t line_count;        //всего строк вместе с новыми
+    uint32_t stride;
+    uint64_t *offsets;
+} index_task_t;
+
+void *index_worker(void *arg) {
+    index_task_t *task = arg;
+    for (size_t chunk = task->thread_idx; chunk < task->chunk_count; chunk += task->thread_count) {
+        uint64_t from = task->begin + chunk * LINE_INDEX_CHUNK;
+        uint64_t to = task->end - from > LINE_INDEX_CHUNK ? from + LINE_INDEX_CHUNK : task->end;
+        char const *p = task->text + from, *end = task->text + to;
+        if (task->count_only) {
+            task->counts[chunk] = count_lines(p,end);
+            continue;
+        }
+        uint64_t line = task->first_line[chunk];
+        while (NULL != (p = memchr(p,'\n',(size_t)(end - p)))) {
+            ++p;
+            ++line; //номер строки, которая начинается с p
+            if (0 == line % task->stride && line < task->line_count)
+                task->offsets[line / task->stride] = (uint64_t)(p - task->text);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Запуск index_worker в thread_count потоках, как в parallel_harmonic_sum.
+ * */
+static void run_index_workers(index_task_t *tasks, pthread_t *threads, size_t thread_count) {
+    size_t started = 1;
+    for (; started != thread_count; ++started)
+        if (0 != pthread_create(threads + started,NULL,index_worker,tasks + started))
+            break;
+    index_worker(tasks + 0);
+    for (size_t idx = 1; idx < started; ++idx)
+        pthread_join(threads[idx],NULL);
+    for (size_t idx = started; idx < thread_count; ++idx)
+        index_worker(tasks + idx);
+}
+
+/**
+ * Добавление в индекс строк из text[indexed_bytes, size).
+ * Возвращает false, если не хватило памяти; индекс при этом не меняется.
+ * */
+static bool index_new_lines(line_index_t *index, char const *text, size_t size, size_t thread_count) {
+    uint64_t begin = index->indexed_bytes, end = size;
+    while (end > begin && '\n' != text[end - 1]) //незавершённая последняя строка не индексируется
+        --end;
+    if (end == begin)
+        return true;
+    if (0 == thread_count) thread_count = 1;
+
+    size_t chunk_count = (size_t)((end - begin + LINE_INDEX_CHUNK - 1) / LINE_INDEX_CHUNK);
+    if (thread_count > chunk_count) thread_count = chunk_count;
+    uint64_t *counts = malloc(chunk_count * sizeof(uint64_t));
+    uint64_t *first_line = malloc(chunk_count * sizeof(uint64_t));
+    index_task_t *tasks = malloc(thread_count * sizeof(index_task_t));
+    pthread_t *threads = malloc(thread_count * sizeof(pthread_t));
+    bool success = false;
+    if (NULL == counts || NULL == first_line || NULL == tasks || NULL == threads)
+        goto CLEAR;
+
+    for (size_t idx = 0; idx != thread_count; ++idx)
+        tasks[idx] = (index_task_t){text, begin, end, chunk_count, idx, thread_count, true, counts, first_line, 0, index->stride, NULL};
+    run_index_workers(tasks,threads,thread_count); //первый проход
+
+    uint64_t line_count = index->line_count;
+    for (size_t chunk = 0; chunk != chunk_count; ++chunk) {
+        first_line[chunk] = line_count;
+        line_count += counts[chunk];
+    }
+    size_t entry_count = (size_t)((line_count + index->stride - 1) / index->stride);
+    if (entry_count > index->capacity) {
+        size_t capacity = 2 * index->capacity > entry_count ? 2 * index->capacity : entry_count;
+        uint64_t *offsets = realloc(index->offsets,capacity * sizeof(uint64_t));
+        if (NULL == offsets)
+            goto CLEAR;
+        index->offsets = offsets;
+        index->capacity = capacity;
+    }
+    if (0 == index->line_count % index->stride) //перед первой новой строкой '\n' в просматриваемой части нет
+        index->offsets[index->line_count / index->stride] = begin;
+
+    for (size_t idx = 0; idx != thread_count; ++idx) {
+        tasks[idx].count_only = false;
+        tasks[idx].line_count = line_count;
+        tasks[idx].offsets = index->offsets;
+    }
+    run_index_workers(tasks,threads,thread_count); //второй проход
+
+    index->line_count = line_count;
+    index->indexed_bytes = end;
+    index->tail_hash = tail_hash(text,end);
+    index->entry_count = entry_count;
+    success = true;
+
+CLEAR:
+    free(threads);
+    free(tasks);
+    free(first_line);
+    free(counts);
+    return success;
+}
+
+/**
+ * Построение индекса текста text[0, size) с шагом stride (0 - шаг по умолчанию).
+ * */
+bool line_index_build(line_index_t *index, char const *text, size_t size, uint32_t stride, size_t thread_count) {
+    line_index_init(index,stride);
+    return index_new_lines(index,text,size,thread_count);
+}
+
+/**
+ * Обновление индекса после дописывания файла: просматривается только новая часть.
+ * Возвращает false, если текст не является продолжением проиндексированного
+ * (файл переписан или укорочен) - тогда индекс нужно построить заново.
+ * */
+bool line_index_update(line_index_t *index, char const *text, size_t size, size_t thread_count) {
+    if (size < index->indexed_bytes || tail_hash(text,index->indexed_bytes) != index->tail_hash)
+        return false;
+    return index_new_lines(index,text,size,thread_count);
+}
+
+bool line_index_save(line_index_t const *index, char const *path) {
+    FILE *stream = fopen(path,"wb");
+    if (NULL == stream)
+        return false;
+    line_index_header_t header = {LINE_INDEX_MAGIC, LINE_INDEX_VERSION, index->stride, index->line_count,
+                                  index->indexed_bytes, index->tail_hash, index->entry_count};
+    fwrite(&header,sizeof(header),1,stream);
+    fwrite(index->offsets,sizeof(uint64_t),index->entry_count,stream);
+    bool success = !ferror(stream);
+    return 0 == fclose(stream) && success;
+}
+
+/**
+ * Чтение индекса с проверкой заголовка: количество смещений должно
+ * соответствовать количеству строк, смещения - возрастать и не выходить за indexed_bytes.
+ * Индекс сверяется с текстом text[0, size), как в line_index_update: если файл
+ * с тех пор переписан или укорочен, возвращается false и индекс нужно построить заново.
+ * */
+bool line_index_load(line_index_t *index, char const *path, char const *text, size_t size) {
+    line_index_init(index,0);
+    FILE *stream = fopen(path,"rb");
+    if (NULL == stream)
+        return false;
+    line_index_header_t header;
+    bool valid = 1 == fread(&header,sizeof(header),1,stream) && 0 == memcmp(header.magic,LINE_INDEX_MAGIC,8) &&
+                 LINE_INDEX_VERSION == header.version && 0 != header.stride &&
+                 header.entry_count == (header.line_count + header.stride - 1) / header.stride &&
+                 header.line_count <= header.indexed_bytes && header.entry_count <= SIZE_MAX / sizeof(uint64_t);
+    uint64_t *offsets = valid ? malloc((header.entry_count > 0 ? header.entry_count : 1) * sizeof(uint64_t)) : NULL;
+    valid = NULL != offsets && header.entry_count == fread(offsets,sizeof(uint64_t),header.entry_count,stream);
+    for (uint64_t entry = 0; valid && entry != header.entry_count; ++entry)
+        valid = (0 == entry ? 0 == offsets[0] : offsets[entry] > offsets[entry - 1]) && offsets[entry] < header.indexed_bytes;
+    fclose(stream);
+    valid = valid && size >= header.indexed_bytes && tail_hash(text,header.indexed_bytes) == header.tail_hash;
+    if (!valid) {
+        free(offsets);
+        return false;
+    }
+    *index = (line_index_t){header.stride, header.line_count, header.indexed_bytes, header.tail_hash,
+                            offsets, header.entry_count, header.entry_count};
+    return true;
+}
+
+/**
+ * Начало строки с номером line или NULL, если такой строки в индексе нет.
+ * text[0, size) - тот же текст, что и при построении индекса; если текст
+ * короче проиндексированного или строки в нём не на своих местах, возвращается NULL.
+ * */
+char const *line_index_find(line_index_t const *index, char const *text, size_t size, uint64_t line) {
+    if (line >= index->line_count || size < index->indexed_bytes)
+        return NULL;
+    char const *p = text + index->offsets[line / index->stride], *end = text + index->indexed_bytes;
+    for (uint64_t skip = line % index->stride; 0 != skip; --skip) {
+        p = memchr(p,'\n',(size_t)(end - p));
+        if (NULL == p)
+            return NULL;
+        ++p;
+    }
+    return p;
+}
+
+/**
+ * Разбор числа из строки, начинающейся с *p. Строка должна содержать
+ * одно число int (пробелы вокруг допускаются). *p сдвигается на следующую строку.
+ * */
+static bool parse_line_int(char const **p, char const *end, int *value) {
+    char const *s = *p;
+    while (s != end && (' ' == *s || '\t' == *s)) ++s;
+    bool negative = s != end && '-' == *s;
+    if (s != end && ('-' == *s || '+' == *s)) ++s;
+    long long v = 0;
+    char const *digits = s;
+    while (s != end && *s >= '0' && *s <= '9' && v <= (long long)INT_MAX + 1)
+        v = 10 * v + (*s++ - '0');
+    while (s != end && (' ' == *s || '\t' == *s || '\r' == *s)) ++s;
+    if (s == digits || s == end || '\n' != *s || v > (long long)INT_MAX + negative)
+        return false;
+    *value = (int)(negative ? -v : v);
+    *p = s + 1;
+    return true;
+}
+
+bool line_index_get(line_index_t const *index, char const *text, size_t size, uint64_t line, int *value) {
+    char const *p = line_index_find(index,text,size,line);
+    return NULL != p && parse_line_int(&p,text + index->indexed_bytes,value);
+}
+
+/**
+ * Чтение чисел из строк [first, first + count): переход к первой строке по индексу,
+ * затем последовательный разбор только нужных строк.
+ * */
+bool line_index_read_range(line_index_t const *index, char const *text, size_t size, uint64_t first, size_t count, int *out) {
+    if (first > index->line_count || count > index->line_count - first)
+        return false;
+    if (0 == count)
+        return true;
+    char const *p = line_index_find(index,text,size,first), *end = text + index->indexed_bytes;
+    if (NULL == p)
+        return false;
+    for (size_t idx = 0; idx != count; ++idx)
+        if (!parse_line_int(&p,end,out + idx))
+            return false;
+    return true;
+}
+
+double seconds_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec + ts.tv_nsec * 1.e-9;
+}
+
+static bool write_numbers(char const *path, char const *mode, int const *values, size_t count) {
+    FILE *descriptor = fopen(path,mode);
+    if (NULL == descriptor)
+        return false;
+    for (size_t idx = 0; idx != count; ++idx)
+        fprintf(descriptor,"%d\n",values[idx]);
+    bool success = !ferror(descriptor);
+    return 0 == fclose(descriptor) && success;
+}
+
+/**
+ * 20 миллионов чисел rand()%100: построение индекса в один поток и во все ядра,
+ * сохранение и чтение индекса, миллион случайных обращений и диапазонов
+ * в сравнении с поиском N-го числа через fscanf.
+ * */
+void line_index_random_access_test() {
+    size_t const count = 20000000u;
+    int *values = malloc(count * sizeof(int)), range[1000];
+    line_index_t index, loaded;
+    line_index_init(&index,0);
+    line_index_init(&loaded,0);
+    mapped_file_t file = {NULL, 0};
+    if (NULL == values) {
+        printf("Can't allocate memory!\n");
+        return;
+    }
+    srand(23);
+    for (size_t idx = 0; idx != count; ++idx)
+        values[idx] = rand()%100;
+    if (!write_numbers("./new_file.txt","w",values,count) || !map_file("./new_file.txt",&file)) {
+        printf("Can't open file!\n");
+        goto CLEAR;
+    }
+
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t threads[2] = {1, cores > 0 ? (size_t)cores : 1};
+    for (unsigned variant = 0; variant != 2; ++variant) {
+        line_index_free(&index);
+        double start = seconds_now();
+        if (!line_index_build(&index,file.data,file.size,0,threads[variant])) {
+            printf("Can't allocate memory!\n");
+            goto CLEAR;
+        }
+        double seconds = seconds_now() - start;
+        printf("build, %zu threads: %.3f s, %.1f MB/s\n",threads[variant],seconds,file.size / seconds / 1.e6);
+    }
+    if (!line_index_save(&index,"./new_file.txt.idx") || !line_index_load(&loaded,"./new_file.txt.idx",file.data,file.size)) {
+        printf("Error in printing data to file!\n");
+        goto CLEAR;
+    }
+    printf("%llu lines, index %zu bytes\n",(unsigned long long)loaded.line_count,
+           sizeof(line_index_header_t) + loaded.entry_count * sizeof(uint64_t));
+
+    unsigned errors = 0;
+    double start = seconds_now();
+    for (unsigned probe = 0; probe != 1000000; ++probe) {
+        uint64_t line = (uint64_t)rand() * RAND_MAX % count;
+        int value;
+        if (!line_index_get(&loaded,file.data,file.size,line,&value) || value != values[line])
+            ++errors;
+    }
+    double index_seconds = (seconds_now() - start) / 1000000;
+    for (unsigned probe = 0; probe != 10000; ++probe) {
+        uint64_t first = (uint64_t)rand() * RAND_MAX % (count - 1000);
+        if (!line_index_read_range(&loaded,file.data,file.size,first,1000,range) || 0 != memcmp(range,values + first,sizeof(range)))
+            ++errors;
+    }
+    int value;
+    if (line_index_get(&loaded,file.data,file.size,count,&value))
+        ++errors; //строки за концом файла нет
+
+    //fscanf: чтобы дойти до строки, разбираются все числа перед ней
+    start = seconds_now();
+    unsigned scans = 10;
+    for (unsigned probe = 0; probe != scans; ++probe) {
+        FILE *in_stream = fopen("./new_file.txt","r");
+        if (NULL == in_stream) {
+            printf("Can't open file to read!\n");
+            goto CLEAR;
+        }
+        uint64_t line = (uint64_t)rand() * RAND_MAX % count;
+        for (uint64_t idx = 0; idx <= line; ++idx)
+            if (1 != fscanf(in_stream,"%d",&value))
+                break;
+        if (value != values[line])
+            ++errors;
+        fclose(in_stream);
+    }
+    double scan_seconds = (seconds_now() - start) / scans;
+    printf("random access: index %.2f us, fscanf %.0f us, x%.0f, %u errors\n",index_seconds * 1.e6,scan_seconds * 1.e6,
+           scan_seconds / index_seconds,errors);
+
+CLEAR:
+    line_index_free(&loaded);
+    line_index_free(&index);
+    unmap_file(&file);
+    free(values);
+}
+
+/**
+ * Дописывание файла: первая запись заканчивается незавершённой строкой,
+ * вторая её завершает. Обновлённый индекс должен совпасть с построенным заново.
+ * Переписанный файл индекс обновлять отказывается.
+ * */
+void line_index_incremental_test() {
+    size_t const count = 3000000u;
+    int *values = malloc(count * sizeof(int));
+    line_index_t index, rebuilt, loaded;
+    line_index_init(&index,100);
+    line_index_init(&rebuilt,100);
+    line_index_init(&loaded,100);
+    mapped_file_t file = {NULL, 0};
+    if (NULL == values) {
+        printf("Can't allocate memory!\n");
+        return;
+    }
+    srand(59);
+    for (size_t idx = 0; idx != count; ++idx)
+        values[idx] = rand() - RAND_MAX / 2;
+
+    bool same = true;
+    size_t written = 0;
+    for (unsigned step = 0; step != 4; ++step) {
+        size_t next = (step + 1) * count / 4;
+        if (!write_numbers("./new_file.txt",0 == step ? "w" : "a",values + written,next - written)) {
+            printf("Error in printing data to file!\n");
+            goto CLEAR;
+        }
+        written = next;
+        FILE *descriptor = fopen("./new_file.txt","a");
+        if (NULL != descriptor) { //начало следующего числа без '\n', его завершит следующая запись
+            fprintf(descriptor,"  ");
+            fclose(descriptor);
+        }
+        if (!map_file("./new_file.txt",&file)) {
+            printf("Can't open file!\n");
+            goto CLEAR;
+        }
+        bool updated = line_index_update(&index,file.data,file.size,4);
+        line_index_free(&rebuilt);
+        line_index_build(&rebuilt,file.data,file.size,100,4);
+        same = same && updated && index.line_count == written && rebuilt.line_count == written &&
+               index.indexed_bytes == rebuilt.indexed_bytes && index.entry_count == rebuilt.entry_count &&
+               0 == memcmp(index.offsets,rebuilt.offsets,index.entry_count * sizeof(uint64_t));
+        for (unsigned probe = 0; probe != 1000 && same; ++probe) {
+            uint64_t line = (uint64_t)rand() % written;
+            int value;
+            same = line_index_get(&index,file.data,file.size,line,&value) && value == values[line];
+        }
+        unmap_file(&file);
+    }
+
+    if (!line_index_save(&index,"./new_file.txt.idx") ||
+        !write_numbers("./new_file.txt","w",values + 1,count - 1) || !map_file("./new_file.txt",&file)) {
+        printf("Can't open file!\n");
+        goto CLEAR;
+    }
+    bool rewritten_rejected = !line_index_update(&index,file.data,file.size,4) &&
+                              !line_index_load(&loaded,"./new_file.txt.idx",file.data,file.size); //индекс от старого файла
+    printf("incremental update %s, rewritten file %s\n",same ? "matches rebuild" : "DIFFERS!",
+           rewritten_rejected ? "rejected" : "NOT DETECTED!");
+
+CLEAR:
+    line_index_free(&loaded);
+    line_index_free(&rebuilt);
+    line_index_free(&index);
+    unmap_file(&file);
+    free(values);
+}
+
+int main() {
+    if (false) line_index_random_access_test();
+    if (false) line_index_incremental_test();
+    return 0;
+}
@@ -0,0 +1,672 @@
+/**
+ * Сортировки из 28_array_sort.c и qsort из 41_function_pointers.c работают
+ * с массивом в оперативной памяти. Файл с числами (new_file.txt из 42_files_ascii.c)
+ * может оказаться больше, чем вся память компьютера. Тогда применяется
+ * внешняя сортировка слиянием:
+ * 1) файл читается частями такого размера, какой разрешено занять в памяти;
+ *    каждая часть сортируется (несколькими потоками, каждый - свой кусок части)
+ *    и записывается во временный файл в двоичном виде - это "серия" (run);
+ * 2) отсортированные серии сливаются: на каждом шаге из k серий берётся
+ *    наименьшее из их текущих чисел. Чтобы не сравнивать все k чисел,
+ *    используется "дерево проигравших" (loser tree): в каждом узле хранится
+ *    серия, проигравшая в этом узле, а победитель поднимается выше. После выдачи
+ *    числа нужно переиграть только путь от листа серии до корня - log2(k) сравнений;
+ * 3) серии читаются и результат пишется большими блоками, поэтому доступ
+ *    к диску последовательный. Если серий так много, что блоки для всех
+ *    не помещаются в память, слияние идёт в несколько проходов.
+ *
+ * Ограничение памяти (memory budget) задаётся параметром: от него зависят
+ * длина серий, число серий в одном слиянии и размер блоков чтения.
+ *
+ * Компиляция:
+ * gcc 60_external_merge_sort.c -o ext_sort -std=c99 -O2 -pthread
+ * */
+
+#define _DEFAULT_SOURCE //mkstemp pread pwrite sysconf clock_gettime
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>   //malloc free qsort mkstemp rand
+#include <stdint.h>   //int64_t uint64_t
+#include <string.h>   //memcpy memmove
+#include <limits.h>   //INT_MIN INT_MAX
+#include <errno.h>    //errno EINTR
+#include <time.h>     //clock_gettime
+#include <fcntl.h>    //open
+#include <unistd.h>   //pread pwrite close unlink sysconf
+#include <pthread.h>  //pthread_create pthread_join
+
+#define EXT_MIN_BUFFER (64u << 10)  //самый маленький блок чтения серии при слиянии
+#define EXT_MIN_BUDGET (1u << 20)   //меньший бюджет памяти увеличивается до этого
+#define EXT_MAX_CHARS 12u           //"-2147483648" и '\n'
+
+typedef enum {
+    SORT_OK,
+    SORT_FORMAT_ERROR, //во входном файле не число (или число, которое не помещается в int)
+    SORT_IO_ERROR,     //ошибка открытия, чтения или записи файлов
+    SORT_NO_MEMORY     //не удалось выделить память
+} sort_status_t;
+
+typedef struct {
+    unsigned long long count;  //сколько чисел отсортировано
+    size_t runs;               //серий после первого этапа
+    size_t passes;             //проходов слияния
+    double run_seconds, merge_seconds;
+} external_sort_stats_t;
+
+/*------------------------------ ввод-вывод ------------------------------*/
+
+/**
+ * pread/pwrite могут прочитать или записать меньше, чем просили,
+ * поэтому вызываются в цикле (см. int_writer_flush в 55_fast_integer_writing.c).
+ * */
+static bool write_all(int fd, void const *buf, size_t len, uint64_t offset) {
+    char const *p = buf;
+    while (0 != len) {
+        ssize_t res = pwrite(fd,p,len,(off_t)offset);
+        if (res < 0 && EINTR == errno)
+            continue;
+        if (res <= 0)
+            return false;
+        p += res;
+        len -= (size_t)res;
+        offset += (uint64_t)res;
+    }
+    return true;
+}
+
+static bool read_all(int fd, void *buf, size_t len, uint64_t offset) {
+    char *p = buf;
+    while (0 != len) {
+        ssize_t res = pread(fd,p,len,(off_t)offset);
+        if (res < 0 && EINTR == errno)
+            continue;
+        if (res <= 0)
+            return false;
+        p += res;
+        len -= (size_t)res;
+        offset += (uint64_t)res;
+    }
+    return true;
+}
+
+/**
+ * Временный файл для серий: создаётся в каталоге dir и сразу удаляется
+ * из каталога, так что место на диске освободится при закрытии,
+ * даже если программа завершится аварийно.
+ * */
+static int open_spill_file(char const *dir) {
+    char path[4096];
+    if ((size_t)snprintf(path,sizeof(path),"%s/ext_sort_XXXXXX",dir) >= sizeof(path))
+        return -1;
+    int fd = mkstemp(path);
+    if (fd >= 0)
+        unlink(path);
+    return fd;
+}
+
+/**
+ * Буферизованное чтение чисел из текста. Число, разрезанное границей
+ * буфера, переносится в начало буфера перед следующим чтением.
+ * */
+typedef struct {
+    FILE *stream;
+    char *buf;
+    size_t pos, len, capacity;
+    bool eof;
+} text_reader_t;
+
+static bool is_space(char c) {
+    return ' ' == c || '\n' == c || '\t' == c || '\r' == c || '\v' == c || '\f' == c;
+}
+
+static bool reader_refill(text_reader_t *r) {
+    memmove(r->buf,r->buf + r->pos,r->len - r->pos);
+    r->len -= r->pos;
+    r->pos = 0;
+    size_t got = fread(r->buf + r->len,1,r->capacity - r->len,r->stream);
+    r->len += got;
+    if (0 == got) {
+        r->eof = true;
+        return !ferror(r->stream);
+    }
+    return true;
+}
+
+/**
+ * Следующее число. Возвращает SORT_OK и *got = false в конце файла.
+ * */
+static sort_status_t reader_next(text_reader_t *r, int *value, bool *got) {
+    *got = false;
+    for (;;) {
+        while (r->pos != r->len && is_space(r->buf[r->pos])) ++r->pos;
+        size_t end = r->pos;
+        while (end != r->len && !is_space(r->buf[end])) ++end;
+        if (end == r->len && !r->eof) {
+            if (0 == r->pos && r->len == r->capacity)
+                return SORT_FORMAT_ERROR; //"число" длиной в весь буфер
+            if (!reader_refill(r))
+                return SORT_IO_ERROR;
+            continue;
+        }
+        if (r->pos == end)
+            return SORT_OK;
+
+        char const *p = r->buf + r->pos, *stop = r->buf + end;
+        bool negative = '-' == *p;
+        if ('-' == *p || '+' == *p) ++p;
+        if (p == stop)
+            return SORT_FORMAT_ERROR;
+        long long v = 0;
+        for (; p != stop; ++p) {
+            if (*p < '0' || *p > '9')
+                return SORT_FORMAT_ERROR;
+            v = 10 * v + (*p - '0');
+            if (v > (long long)INT_MAX + 1)
+                return SORT_FORMAT_ERROR;
+        }
+        if (v > (long long)INT_MAX + negative)
+            return SORT_FORMAT_ERROR;
+        *value = (int)(negative ? -v : v);
+        *got = true;
+        r->pos = end;
+        return SORT_OK;
+    }
+}
+
+/**
+ * Приёмник слияния: двоичная серия во временном файле
+ * или итоговый текстовый файл, по числу в строке.
+ * */
+typedef struct {
+    int fd;
+    bool text;
+    char *buf;
+    size_t used, capacity;
+    uint64_t offset;  //куда в файле будет записан буфер
+    bool failed;
+} merge_sink_t;
+
+static void sink_flush(merge_sink_t *s) {
+    if (!s->failed && !write_all(s->fd,s->buf,s->used,s->offset))
+        s->failed = true;
+    s->offset += s->used;
+    s->used = 0;
+}
+
+static char *format_int(char *p, int value) {
+    unsigned v = value < 0 ? 0u - (unsigned)value : (unsigned)value;
+    char digits[10];
+    unsigned len = 0;
+    if (value < 0) *p++ = '-';
+    do {
+        digits[len++] = (char)('0' + v % 10u);
+        v /= 10u;
+    } while (0 != v);
+    while (0 != len) *p++ = digits[--len];
+    return p;
+}
+
+static inline void sink_put(merge_sink_t *s, int value) {
+    if (s->capacity - s->used < EXT_MAX_CHARS)
+        sink_flush(s);
+    if (s->text) {
+        char *end = format_int(s->buf + s->used,value);
+        *end++ = '\n';
+        s->used = (size_t)(end - s->buf);
+    } else {
+        memcpy(s->buf + s->used,&value,sizeof(int));
+        s->used += sizeof(int);
+    }
+}
+
+/*------------------------------ серии ------------------------------*/
+
+typedef struct {
+    uint64_t offset;  //в байтах от начала временного файла
+    uint64_t count;
+} run_t;
+
+int int_cmp(void const *lha, void const *rha) {
+    int const *int_l = lha, *int_r = rha;
+    if (*int_l < *int_r) return -1;
+    if (*int_l > *int_r) return 1;
+    return 0;
+}
+
+typedef struct {
+    int *data;
+    size_t count;
+} sort_task_t;
+
+void *sort_worker(void *arg) {
+    sort_task_t *task = arg;
+    qsort(task->data,task->count,sizeof(int),int_cmp);
+    return NULL;
+}
+
+/**
+ * Сортировка части в thread_count потоков (как в parallel_harmonic_sum
+ * из 47_parallel_harmonic_series.c): каждый поток сортирует свой кусок,
+ * и куски становятся отдельными сериями - сливать их в памяти не нужно,
+ * это сделает общее слияние.
+ * */
+static void sort_pieces(int *data, size_t count, size_t thread_count, sort_task_t *tasks, pthread_t *threads) {
+    for (size_t idx = 0; idx != thread_count; ++idx)
+        tasks[idx] = (sort_task_t){data + count * idx / thread_count, count * (idx + 1) / thread_count - count * idx / thread_count};
+    size_t started = 1;
+    for (; started < thread_count; ++started)
+        if (0 != pthread_create(threads + started,NULL,sort_worker,tasks + started))
+            break;
+    sort_worker(tasks + 0);
+    for (size_t idx = 1; idx < started; ++idx)
+        pthread_join(threads[idx],NULL);
+    for (size_t idx = started; idx < thread_count; ++idx)
+        sort_worker(tasks + idx);
+}
+
+/**
+ * Первый этап: чтение текста частями по capacity чисел, сортировка и запись серий.
+ * *runs - массив серий (освобождается вызовом free).
+ * */
+static sort_status_t make_runs(FILE *in_stream, int spill_fd, size_t budget, size_t thread_count,
+                               run_t **runs, size_t *run_count, unsigned long long *total) {
+    size_t read_capacity = budget / 8;
+    size_t capacity = (budget - read_capacity) / sizeof(int);
+    text_reader_t reader = {in_stream, malloc(read_capacity), 0, 0, read_capacity, false};
+    int *data = malloc(capacity * sizeof(int));
+    sort_task_t *tasks = malloc(thread_count * sizeof(sort_task_t));
+    pthread_t *threads = malloc(thread_count * sizeof(pthread_t));
+    size_t runs_capacity = 64;
+    *runs = malloc(runs_capacity * sizeof(run_t));
+    *run_count = 0;
+    *total = 0;
+    uint64_t offset = 0;
+    sort_status_t status = SORT_NO_MEMORY;
+    if (NULL == reader.buf || NULL == data || NULL == tasks || NULL == threads || NULL == *runs)
+        goto CLEAR;
+
+    for (bool more = true; more;) {
+        size_t count = 0;
+        while (count != capacity) {
+            status = reader_next(&reader,data + count,&more);
+            if (SORT_OK != status)
+                goto CLEAR;
+            if (!more)
+                break;
+            ++count;
+        }
+        if (0 == count)
+            break;
+
+        size_t pieces = count / thread_count >= EXT_MIN_BUFFER / sizeof(int) ? thread_count : 1;
+        sort_pieces(data,count,pieces,tasks,threads);
+        if (*run_count + pieces > runs_capacity) {
+            runs_capacity = 2 * runs_capacity + pieces;
+            run_t *grown = realloc(*runs,runs_capacity * sizeof(run_t));
+            status = SORT_NO_MEMORY;
+            if (NULL == grown)
+                goto CLEAR;
+            *runs = grown;
+        }
+        for (size_t idx = 0; idx != pieces; ++idx)
+            (*runs)[(*run_count)++] = (run_t){offset + (uint64_t)(tasks[idx].data - data) * sizeof(int), tasks[idx].count};
+        status = SORT_IO_ERROR;
+        if (!write_all(spill_fd,data,count * sizeof(int),offset))
+            goto CLEAR;
+        offset += count * sizeof(int);
+        *total += count;
+    }
+    status = SORT_OK;
+
+CLEAR:
+    free(threads);
+    free(tasks);
+    free(data);
+    free(reader.buf);
+    return status;
+}
+
+/*------------------------------ слияние ------------------------------*/
+
+/**
+ * Курсор серии: блок чисел в памяти и то, что ещё осталось прочитать.
+ * */
+typedef struct {
+    uint64_t offset, remaining;
+    int *buf;
+    size_t pos, len, capacity;
+} run_cursor_t;
+
+/**
+ * Дерево проигравших на k листьях. keys[i] - текущее число серии i,
+ * INT64_MAX - серия закончилась. tree[1..k-1] - проигравшие в узлах,
+ * tree[0] - общий победитель. Узел t - родитель узлов 2t и 2t + 1,
+ * лист i "висит" под узлом (i + k) / 2.
+ * */
+typedef struct {
+    size_t k;
+    size_t *tree;
+    int64_t *keys;  //k + 1 ключ: keys[k] = INT64_MIN нужен только при построении
+} loser_tree_t;
+
+static void loser_tree_adjust(loser_tree_t *lt, size_t s) {
+    for (size_t t = (s + lt->k) / 2; 0 != t; t /= 2)
+        if (lt->keys[lt->tree[t]] < lt->keys[s]) { //в узле остаётся проигравший, выше идёт победитель
+            size_t winner = lt->tree[t];
+            lt->tree[t] = s;
+            s = winner;
+        }
+    lt->tree[0] = s;
+}
+
+/**
+ * Построение: сначала все узлы заняты фиктивным листом k с ключом INT64_MIN,
+ * который выигрывает у всех; каждый настоящий лист вытесняет его на своём пути.
+ * */
+static void loser_tree_build(loser_tree_t *lt) {
+    lt->keys[lt->k] = INT64_MIN;
+    for (size_t t = 0; t != lt->k; ++t)
+        lt->tree[t] = lt->k;
+    for (size_t s = lt->k; 0 != s; --s)
+        loser_tree_adjust(lt,s - 1);
+}
+
+static bool cursor_next(run_cursor_t *c, int spill_fd, int64_t *key) {
+    if (c->pos == c->len) {
+        if (0 == c->remaining) {
+            *key = INT64_MAX;
+            return true;
+        }
+        c->len = c->remaining < c->capacity ? (size_t)c->remaining : c->capacity;
+        c->pos = 0;
+        if (!read_all(spill_fd,c->buf,c->len * sizeof(int),c->offset))
+            return false;
+        c->offset += c->len * sizeof(int);
+        c->remaining -= c->len;
+    }
+    *key = c->buf[c->pos++];
+    return true;
+}
+
+/**
+ * Слияние k серий из временного файла в приёмник.
+ * cursors уже содержат буферы, keys и tree - место для k + 1 и k элементов.
+ * */
+static bool merge_runs(int spill_fd, run_t const *runs, size_t k, run_cursor_t *cursors,
+                       loser_tree_t *lt, merge_sink_t *sink) {
+    if (0 == k) //пустой входной файл
+        return true;
+    lt->k = k;
+    for (size_t idx = 0; idx != k; ++idx) {
+        cursors[idx].offset = runs[idx].offset;
+        cursors[idx].remaining = runs[idx].count;
+        cursors[idx].pos = cursors[idx].len = 0;
+        if (!cursor_next(cursors + idx,spill_fd,lt->keys + idx))
+            return false;
+    }
+    loser_tree_build(lt);
+    for (;;) {
+        size_t winner = lt->tree[0];
+        if (INT64_MAX == lt->keys[winner])
+            break;
+        sink_put(sink,(int)lt->keys[winner]);
+        if (!cursor_next(cursors + winner,spill_fd,lt->keys + winner))
+            return false;
+        loser_tree_adjust(lt,winner);
+    }
+    return !sink->failed;
+}
+
+double seconds_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec + ts.tv_nsec * 1.e-9;
+}
+
+/**
+ * Сортировка текстового файла in_path в out_path.
+ * tmp_dir - каталог для временных файлов (NULL - текущий): это должен быть диск,
+ * а не /tmp в памяти, если файл больше памяти. budget - память в байтах
+ * на данные сортировки (без учёта небольших служебных массивов).
+ * */
+sort_status_t external_sort_file(char const *in_path, char const *out_path, char const *tmp_dir,
+                                 size_t budget, size_t thread_count, external_sort_stats_t *stats) {
+    *stats = (external_sort_stats_t){0, 0, 0, 0., 0.};
+    if (budget < EXT_MIN_BUDGET) budget = EXT_MIN_BUDGET;
+    if (0 == thread_count) thread_count = 1;
+    if (NULL == tmp_dir) tmp_dir = ".";
+
+    sort_status_t status = SORT_IO_ERROR;
+    int spill[2] = {open_spill_file(tmp_dir), open_spill_file(tmp_dir)}, out_fd = -1;
+    FILE *in_stream = fopen(in_path,"r");
+    run_t *runs = NULL, *next_runs = NULL;
+    run_cursor_t *cursors = NULL;
+    loser_tree_t lt = {0, NULL, NULL};
+    char *arena = NULL;
+    if (spill[0] < 0 || spill[1] < 0 || NULL == in_stream)
+        goto CLEAR;
+
+    double start = seconds_now();
+    size_t run_count = 0;
+    status = make_runs(in_stream,spill[0],budget,thread_count,&runs,&run_count,&stats->count);
+    stats->runs = run_count;
+    stats->run_seconds = seconds_now() - start;
+    if (SORT_OK != status)
+        goto CLEAR;
+
+    //k серий и выходной блок делят бюджет поровну, каждый блок не меньше EXT_MIN_BUFFER
+    start = seconds_now();
+    size_t fan_in = budget / EXT_MIN_BUFFER - 1;
+    size_t k_max = run_count < fan_in ? run_count : fan_in;
+    if (k_max < 1) k_max = 1;
+    size_t block = budget / (k_max + 1) / sizeof(int) * sizeof(int);
+    status = SORT_NO_MEMORY;
+    arena = malloc(budget);
+    cursors = malloc(k_max * sizeof(run_cursor_t));
+    lt.tree = malloc(k_max * sizeof(size_t));
+    lt.keys = malloc((k_max + 1) * sizeof(int64_t));
+    next_runs = malloc(((run_count + fan_in - 1) / fan_in + 1) * sizeof(run_t));
+    if (NULL == arena || NULL == cursors || NULL == lt.tree || NULL == lt.keys || NULL == next_runs)
+        goto CLEAR;
+    for (size_t idx = 0; idx != k_max; ++idx)
+        cursors[idx] = (run_cursor_t){0, 0, (int *)(arena + (idx + 1) * block), 0, 0, block / sizeof(int)};
+
+    //промежуточные проходы: группы по fan_in серий сливаются в новые серии другого временного файла
+    status = SORT_IO_ERROR;
+    while (run_count > fan_in) {
+        merge_sink_t sink = {spill[1], false, arena, 0, block, 0, false};
+        size_t next_count = 0;
+        for (size_t first = 0; first < run_count; first += fan_in) {
+            size_t k = run_count - first < fan_in ? run_count - first : fan_in;
+            uint64_t offset = sink.offset + sink.used, count = 0;
+            for (size_t idx = 0; idx != k; ++idx)
+                count += runs[first + idx].count;
+            if (!merge_runs(spill[0],runs + first,k,cursors,&lt,&sink))
+                goto CLEAR;
+            next_runs[next_count++] = (run_t){offset, count};
+        }
+        sink_flush(&sink);
+        if (sink.failed)
+            goto CLEAR;
+        run_t *swap_runs = runs;
+        runs = next_runs;
+        next_runs = swap_runs;
+        run_count = next_count;
+        int swap_fd = spill[0];
+        spill[0] = spill[1];
+        spill[1] = swap_fd;
+        ++stats->passes;
+    }
+
+    out_fd = open(out_path,O_WRONLY | O_CREAT | O_TRUNC,0644);
+    if (out_fd < 0)
+        goto CLEAR;
+    merge_sink_t sink = {out_fd, true, arena, 0, block, 0, false};
+    if (!merge_runs(spill[0],runs,run_count,cursors,&lt,&sink))
+        goto CLEAR;
+    sink_flush(&sink);
+    ++stats->passes;
+    if (!sink.failed)
+        status = SORT_OK;
+    stats->merge_seconds = seconds_now() - start;
+
+CLEAR:
+    if (out_fd >= 0 && 0 != close(out_fd) && SORT_OK == status)
+        status = SORT_IO_ERROR;
+    if (NULL != in_stream) fclose(in_stream);
+    if (spill[0] >= 0) close(spill[0]);
+    if (spill[1] >= 0) close(spill[1]);
+    free(lt.keys);
+    free(lt.tree);
+    free(cursors);
+    free(arena);
+    free(next_runs);
+    free(runs);
+    return status;
+}
+
+static void print_sort_status(sort_status_t status) {
+    switch (status) {
+    case SORT_OK: break;
+    case SORT_FORMAT_ERROR: printf("Input format error!\n"); break;
+    case SORT_IO_ERROR: printf("Can't read or write file!\n"); break;
+    case SORT_NO_MEMORY: printf("Can't allocate memory!\n"); break;
+    }
+}
+
+static bool write_numbers(char const *path, int const *values, size_t count) {
+    FILE *descriptor = fopen(path,"w");
+    if (NULL == descriptor)
+        return false;
+    for (size_t idx = 0; idx != count; ++idx)
+        fprintf(descriptor,"%d\n",values[idx]);
+    bool success = !ferror(descriptor);
+    return 0 == fclose(descriptor) && success;
+}
+
+/**
+ * Сравнение отсортированного файла с массивом, отсортированным qsort.
+ * */
+static bool check_sorted_file(char const *path, int const *expected, size_t count) {
+    FILE *in_stream = fopen(path,"r");
+    if (NULL == in_stream)
+        return false;
+    size_t idx = 0;
+    int num;
+    bool same = true;
+    while (same && 1 == fscanf(in_stream,"%d",&num))
+        same = idx < count && num == expected[idx++];
+    same = same && feof(in_stream) && idx == count;
+    fclose(in_stream);
+    return same;
+}
+
+/**
+ * Сортировка с разными ограничениями памяти: при 1 МБ серий больше,
+ * чем помещается в одно слияние, и слияние идёт в два прохода.
+ * Результат сравнивается с qsort того же массива в памяти.
+ * Отдельно - пустой файл и файл с ошибкой формата.
+ * */
+void external_sort_budget_test() {
+    size_t const count = 5000000u;
+    int *values = malloc(count * sizeof(int));
+    if (NULL == values) {
+        printf("Can't allocate memory!\n");
+        return;
+    }
+    srand(60);
+    for (size_t idx = 0; idx != count; ++idx)
+        values[idx] = (int)((unsigned)rand() << 16 ^ (unsigned)rand());
+    if (!write_numbers("./new_file.txt",values,count)) {
+        printf("Error in printing data to file!\n");
+        free(values);
+        return;
+    }
+    qsort(values,count,sizeof(int),int_cmp);
+
+    size_t budgets[3] = {1u << 20, 4u << 20, 64u << 20};
+    for (unsigned variant = 0; variant != 3; ++variant) {
+        external_sort_stats_t stats;
+        sort_status_t status = external_sort_file("./new_file.txt","./new_file_sorted.txt",".",budgets[variant],4,&stats);
+        print_sort_status(status);
+        bool same = SORT_OK == status && check_sorted_file("./new_file_sorted.txt",values,count);
+        printf("budget %3zu MB: %zu runs, %zu passes, %s\n",budgets[variant] >> 20,stats.runs,stats.passes,
+               same ? "sorted" : "RESULTS DIFFER!");
+    }
+    free(values);
+
+    external_sort_stats_t stats;
+    write_numbers("./new_file.txt",NULL,0);
+    sort_status_t status = external_sort_file("./new_file.txt","./new_file_sorted.txt",".",0,4,&stats);
+    printf("empty file: %s\n",SORT_OK == status && check_sorted_file("./new_file_sorted.txt",NULL,0) ? "ok" : "FAILED!");
+    FILE *descriptor = fopen("./new_file.txt","w");
+    if (NULL != descriptor) {
+        fprintf(descriptor,"1\n2\nthree\n");
+        fclose(descriptor);
+    }
+    status = external_sort_file("./new_file.txt","./new_file_sorted.txt",".",0,4,&stats);
+    printf("bad file: %s\n",SORT_FORMAT_ERROR == status ? "format error" : "NOT DETECTED!");
+}
+
+/**
+ * Большой файл: how_many чисел rand() (задаёт пользователь) и ограничение
+ * памяти в мегабайтах. Проверяется порядок и сумма чисел результата.
+ * */
+void external_sort_big_file_test() {
+    unsigned long long how_many, budget_mb;
+    if (2 != scanf("%llu %llu",&how_many,&budget_mb)) {
+        printf("Input format error!\n");
+        return;
+    }
+    srand(23);
+    FILE *descriptor = fopen("./new_file.txt","w");
+    if (NULL == descriptor) {
+        printf("Can't open file!\n");
+        return;
+    }
+    long long sum = 0;
+    for (unsigned long long idx = 0; idx != how_many; ++idx) {
+        int value = rand() - RAND_MAX / 2;
+        sum += value;
+        fprintf(descriptor,"%d\n",value);
+    }
+    if (0 != fclose(descriptor)) {
+        printf("Error in printing data to file!\n");
+        return;
+    }
+
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    external_sort_stats_t stats;
+    sort_status_t status = external_sort_file("./new_file.txt","./new_file_sorted.txt",".",(size_t)budget_mb << 20,
+                                              cores > 0 ? (size_t)cores : 1,&stats);
+    print_sort_status(status);
+    if (SORT_OK != status)
+        return;
+    printf("%llu numbers: %zu runs in %.2f s, %zu merge passes in %.2f s\n",stats.count,stats.runs,stats.run_seconds,
+           stats.passes,stats.merge_seconds);
+
+    FILE *in_stream = fopen("./new_file_sorted.txt","r");
+    if (NULL == in_stream) {
+        printf("Can't open file to read!\n");
+        return;
+    }
+    unsigned long long count = 0;
+    long long check = 0;
+    int num, prev = INT_MIN;
+    bool ordered = true;
+    while (1 == fscanf(in_stream,"%d",&num)) {
+        ordered = ordered && prev <= num;
+        prev = num;
+        check += num;
+        ++count;
+    }
+    fclose(in_stream);
+    printf("%s\n",ordered && count == how_many && check == sum ? "sorted" : "RESULTS DIFFER!");
+}
+
+int main() {
+    if (false) external_sort_budget_test();
+    if (false) external_sort_big_file_test();
+    return 0;
+}
@@ -0,0 +1,494 @@
+/**
+ * В function_infile_tabulation_test (42_files_ascii.c) функция sin вписана
+ * прямо в цикл, а 101 точка вычисляется и записывается одним потоком.
+ * universal_dichotomy_solve (40_polymorphic_algorithms.c) показывает, как
+ * отделить алгоритм от функции: функция передаётся указателем float (*)(float).
+ *
+ * Соберём из этого "движок" табулирования:
+ * 1) функция передаётся указателем - либо по одной точке float (*)(float),
+ *    либо "пакетом": функция получает сразу массив аргументов и заполняет
+ *    массив значений. Пакетный вызов дешевле (один вызов на тысячи точек),
+ *    и компилятор может векторизовать цикл внутри такой функции;
+ * 2) точки делятся на блоки по TAB_BLOCK, блоки вычисляются несколькими потоками,
+ *    причём в тех же потоках значения сразу переводятся в текст - для
+ *    текстового формата это самая дорогая часть работы;
+ * 3) блоки завершаются в произвольном порядке, а в файл должны попасть по порядку.
+ *    Поэтому результаты лежат в кольце из нескольких "ячеек": блок b занимает
+ *    ячейку b % depth, вызывающий поток записывает блоки строго по порядку,
+ *    а поток, которому досталась ещё занятая ячейка, ждёт. Память ограничена
+ *    depth блоками, как бы ни был велик файл.
+ * Вывод - в текст (формат строки, как у table_to_text) или в двоичную таблицу
+ * 54_binary_function_table.c, которую можно открыть функцией table_open.
+ *
+ * Аргументы вычисляются как begin + step * i в double и лишь затем округляются
+ * до float: во float ошибка округления step заметно сдвигала бы дальние точки.
+ *
+ * Компиляция:
+ * gcc 61_parallel_tabulation.c -o tabulate -std=c99 -O2 -pthread -lm
+ * */
+
+#define _DEFAULT_SOURCE //pwrite sysconf clock_gettime
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>   //malloc free
+#include <stdint.h>   //uint32_t uint64_t
+#include <math.h>     //sinf INFINITY
+#include <errno.h>    //errno EINTR
+#include <time.h>     //clock_gettime
+#include <fcntl.h>    //open
+#include <unistd.h>   //pwrite close sysconf
+#include <pthread.h>
+
+#define TAB_BLOCK 65536u   //точек в блоке
+#define TAB_MAX_LINE 64u   //наибольшая длина строки текста
+
+typedef float (*scalar_function_t)(float);
+
+/**
+ * Пакетная функция: values[i] = f(args[i]) для i от 0 до count - 1.
+ * context - любые дополнительные данные функции (параметры, коэффициенты).
+ * */
+typedef void (*batch_function_t)(float const *args, float *values, size_t count, void *context);
+
+typedef enum {
+    TAB_TEXT,
+    TAB_BINARY
+} tab_output_t;
+
+typedef enum {
+    TAB_OK,
+    TAB_IO_ERROR,      //файл не удалось открыть или записать
+    TAB_FORMAT_ERROR,  //строка текста длиннее TAB_MAX_LINE или неверные параметры
+    TAB_NO_MEMORY
+} tab_status_t;
+
+/**
+ * Заголовок двоичной таблицы из 54_binary_function_table.c (точки float).
+ * */
+#define TABLE_MAGIC "FUNCTAB"
+#define TABLE_VERSION 1u
+#define TABLE_BYTE_ORDER 0x01020304u
+#define TABLE_ALIGN 64u
+#define TABLE_FLOAT32 1u
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t dtype;
+    uint32_t reserved;
+    uint64_t count;
+    double arg_begin, arg_end;
+    uint64_t args_offset;
+    uint64_t values_offset;
+} table_header_t;
+
+static uint64_t table_align(uint64_t offset) {
+    return (offset + TABLE_ALIGN - 1) / TABLE_ALIGN * TABLE_ALIGN;
+}
+
+/**
+ * Запись в цикле, как int_writer_flush в 55_fast_integer_writing.c.
+ * */
+static bool write_all(int fd, void const *buf, size_t len, uint64_t offset) {
+    char const *p = buf;
+    while (0 != len) {
+        ssize_t res = pwrite(fd,p,len,(off_t)offset);
+        if (res < 0 && EINTR == errno)
+            continue;
+        if (res <= 0)
+            return false;
+        p += res;
+        len -= (size_t)res;
+        offset += (uint64_t)res;
+    }
+    return true;
+}
+
+/**
+ * Ячейка кольца: аргументы и значения блока и, для текста, готовые строки.
+ * */
+typedef struct {
+    float *args, *values;
+    char *text;
+    size_t text_len;
+    bool done;         //блок вычислен и ждёт записи
+    bool failed;       //строка не поместилась в TAB_MAX_LINE
+} tab_slot_t;
+
+typedef struct {
+    //параметры задачи
+    batch_function_t batch;
+    void *context;
+    double begin, step;
+    size_t count, block_count;
+    tab_output_t output;
+    char const *format;
+    int fd;
+    uint64_t args_offset, values_offset, text_offset;
+    //кольцо ячеек и его состояние, защищённое lock
+    tab_slot_t *slots;
+    size_t depth;
+    size_t next_block;  //следующий блок, который ещё никто не взял
+    size_t written;     //блоки с меньшими номерами уже записаны
+    bool failed;        //ошибка записи или формата: новые блоки не берутся
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+} tab_engine_t;
+
+static float tab_arg(tab_engine_t const *e, size_t idx) {
+    return (float)(e->begin + e->step * (double)idx);
+}
+
+/**
+ * Вычисление блока b в его ячейке. Выполняется без блокировки:
+ * ячейку b % depth, пока блок не записан, никто другой не трогает.
+ * */
+static void compute_block(tab_engine_t *e, size_t b) {
+    tab_slot_t *slot = e->slots + b % e->depth;
+    size_t first = b * TAB_BLOCK, n = e->count - first < TAB_BLOCK ? e->count - first : TAB_BLOCK;
+    for (size_t idx = 0; idx != n; ++idx)
+        slot->args[idx] = tab_arg(e,first + idx);
+    e->batch(slot->args,slot->values,n,e->context);
+    slot->failed = false;
+    slot->text_len = 0;
+    if (TAB_TEXT == e->output)
+        for (size_t idx = 0; idx != n && !slot->failed; ++idx) {
+            int len = snprintf(slot->text + slot->text_len,TAB_MAX_LINE,e->format,(double)slot->args[idx],(double)slot->values[idx]);
+            if (len < 0 || len >= (int)TAB_MAX_LINE)
+                slot->failed = true;
+            else
+                slot->text_len += (size_t)len;
+        }
+}
+
+/**
+ * Запись блока b. Выполняет только вызывающий поток и строго по порядку блоков.
+ * */
+static bool write_block(tab_engine_t *e, size_t b) {
+    tab_slot_t *slot = e->slots + b % e->depth;
+    if (TAB_TEXT == e->output) {
+        bool success = write_all(e->fd,slot->text,slot->text_len,e->text_offset);
+        e->text_offset += slot->text_len;
+        return success;
+    }
+    size_t first = b * TAB_BLOCK, n = e->count - first < TAB_BLOCK ? e->count - first : TAB_BLOCK;
+    return write_all(e->fd,slot->args,n * sizeof(float),e->args_offset + first * sizeof(float)) &&
+           write_all(e->fd,slot->values,n * sizeof(float),e->values_offset + first * sizeof(float));
+}
+
+/**
+ * Вычисляющий поток: берёт следующий блок, ждёт, пока освободится его ячейка,
+ * вычисляет блок и отмечает ячейку готовой.
+ * */
+void *tab_worker(void *arg) {
+    tab_engine_t *e = arg;
+    pthread_mutex_lock(&e->lock);
+    for (;;) {
+        while (!e->failed && e->next_block < e->block_count && e->next_block >= e->written + e->depth)
+            pthread_cond_wait(&e->changed,&e->lock);
+        if (e->failed || e->next_block == e->block_count)
+            break;
+        size_t b = e->next_block++;
+        pthread_mutex_unlock(&e->lock);
+        compute_block(e,b);
+        pthread_mutex_lock(&e->lock);
+        e->slots[b % e->depth].done = true;
+        pthread_cond_broadcast(&e->changed);
+    }
+    pthread_mutex_unlock(&e->lock);
+    return NULL;
+}
+
+/**
+ * Вызывающий поток записывает блоки по порядку. Если очередной блок ещё
+ * не готов, а свободная ячейка есть, он вычисляет блок сам - так работа
+ * идёт, даже если ни одного потока запустить не удалось (как в parallel_harmonic_sum).
+ * */
+static bool tab_writer(tab_engine_t *e) {
+    pthread_mutex_lock(&e->lock);
+    while (!e->failed && e->written != e->block_count) {
+        tab_slot_t *slot = e->slots + e->written % e->depth;
+        if (slot->done) {
+            pthread_mutex_unlock(&e->lock);
+            bool success = !slot->failed && write_block(e,e->written);
+            pthread_mutex_lock(&e->lock);
+            slot->done = false;
+            ++e->written;
+            e->failed = !success;
+        } else if (e->next_block < e->block_count && e->next_block < e->written + e->depth) {
+            size_t b = e->next_block++;
+            pthread_mutex_unlock(&e->lock);
+            compute_block(e,b);
+            pthread_mutex_lock(&e->lock);
+            e->slots[b % e->depth].done = true;
+            continue;
+        } else {
+            pthread_cond_wait(&e->changed,&e->lock);
+            continue;
+        }
+        pthread_cond_broadcast(&e->changed);
+    }
+    bool success = !e->failed;
+    e->failed = true; //остановить потоки, если запись прервана ошибкой
+    pthread_cond_broadcast(&e->changed);
+    pthread_mutex_unlock(&e->lock);
+    return success;
+}
+
+/**
+ * Табулирование batch на count равноотстоящих точках отрезка [begin, end]
+ * в thread_count потоков. Для TAB_TEXT format - формат строки из двух
+ * чисел double, например "%f %e\n" (как в sin_tab.txt); для TAB_BINARY format не нужен.
+ * */
+tab_status_t tabulate_batch(char const *path, tab_output_t output, char const *format, batch_function_t batch, void *context,
+                            float begin, float end, size_t count, size_t thread_count) {
+    if (TAB_TEXT == output && NULL == format)
+        return TAB_FORMAT_ERROR;
+    if (0 == thread_count) thread_count = 1;
+    size_t block_count = (count + TAB_BLOCK - 1) / TAB_BLOCK;
+    if (thread_count > block_count) thread_count = block_count > 0 ? block_count : 1;
+
+    double step = count > 1 ? ((double)end - begin) / (double)(count - 1) : 0.;
+    tab_engine_t e = {batch, context, begin, step, count, block_count, output, format, -1, 0, 0, 0,
+                      NULL, 2 * thread_count, 0, 0, false, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER};
+    e.args_offset = table_align(sizeof(table_header_t));
+    e.values_offset = table_align(e.args_offset + count * sizeof(float));
+    pthread_t *threads = malloc(thread_count * sizeof(pthread_t));
+    e.slots = calloc(e.depth,sizeof(tab_slot_t));
+    tab_status_t status = TAB_NO_MEMORY;
+    if (NULL == threads || NULL == e.slots)
+        goto CLEAR;
+    for (size_t idx = 0; idx != e.depth; ++idx) {
+        e.slots[idx].args = malloc(TAB_BLOCK * sizeof(float));
+        e.slots[idx].values = malloc(TAB_BLOCK * sizeof(float));
+        e.slots[idx].text = TAB_TEXT == output ? malloc(TAB_BLOCK * TAB_MAX_LINE) : NULL;
+        if (NULL == e.slots[idx].args || NULL == e.slots[idx].values || (TAB_TEXT == output && NULL == e.slots[idx].text))
+            goto CLEAR;
+    }
+
+    status = TAB_IO_ERROR;
+    e.fd = open(path,O_WRONLY | O_CREAT | O_TRUNC,0644);
+    if (e.fd < 0)
+        goto CLEAR;
+    if (TAB_BINARY == output) {
+        table_header_t header = {TABLE_MAGIC, TABLE_VERSION, TABLE_BYTE_ORDER, TABLE_FLOAT32, 0, count, 0., 0.,
+                                 e.args_offset, e.values_offset};
+        if (0 != count) {
+            header.arg_begin = tab_arg(&e,0);
+            header.arg_end = tab_arg(&e,count - 1);
+        }
+        //пропуски между столбцами заполнятся нулями сами: файл дополняется до конечного размера
+        if (!write_all(e.fd,&header,sizeof(header),0) ||
+            0 != ftruncate(e.fd,(off_t)(e.values_offset + count * sizeof(float))))
+            goto CLEAR;
+    }
+
+    size_t started = 1;
+    for (; started < thread_count; ++started)
+        if (0 != pthread_create(threads + started,NULL,tab_worker,&e))
+            break;
+    bool success = tab_writer(&e);
+    for (size_t idx = 1; idx < started; ++idx)
+        pthread_join(threads[idx],NULL);
+    pthread_cond_destroy(&e.changed);
+    pthread_mutex_destroy(&e.lock);
+
+    status = TAB_OK;
+    if (!success) {
+        status = TAB_IO_ERROR;
+        for (size_t idx = 0; idx != e.depth; ++idx)
+            if (e.slots[idx].failed)
+                status = TAB_FORMAT_ERROR;
+    }
+
+CLEAR:
+    if (e.fd >= 0 && 0 != close(e.fd) && TAB_OK == status)
+        status = TAB_IO_ERROR;
+    for (size_t idx = 0; NULL != e.slots && idx != e.depth; ++idx) {
+        free(e.slots[idx].text);
+        free(e.slots[idx].values);
+        free(e.slots[idx].args);
+    }
+    free(e.slots);
+    free(threads);
+    return status;
+}
+
+/**
+ * Указатель на функцию нельзя передать как void *, поэтому он
+ * заворачивается в структуру, а адрес структуры служит контекстом.
+ * */
+typedef struct {
+    scalar_function_t f;
+} scalar_context_t;
+
+static void scalar_batch(float const *args, float *values, size_t count, void *context) {
+    scalar_function_t f = ((scalar_context_t *)context)->f;
+    for (size_t idx = 0; idx != count; ++idx)
+        values[idx] = f(args[idx]);
+}
+
+tab_status_t tabulate(char const *path, tab_output_t output, char const *format, scalar_function_t f,
+                      float begin, float end, size_t count, size_t thread_count) {
+    scalar_context_t context = {f};
+    return tabulate_batch(path,output,format,scalar_batch,&context,begin,end,count,thread_count);
+}
+
+double seconds_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec + ts.tv_nsec * 1.e-9;
+}
+
+static void print_tab_status(tab_status_t status) {
+    if (TAB_IO_ERROR == status)
+        printf("File stream error!\n");
+    else if (TAB_FORMAT_ERROR == status)
+        printf("Input format error!\n");
+    else if (TAB_NO_MEMORY == status)
+        printf("Can't allocate memory!\n");
+}
+
+float sin_f(float x) {
+    return sinf(x);
+}
+
+//ноль функции между 1 и 2 - корень квадратный из 2 (как g в 40_polymorphic_algorithms.c)
+float g(float x) {
+    return x * x - 2.f;
+}
+
+/**
+ * Многочлен с коэффициентами из контекста, схема Горнера.
+ * Цикл по точкам компилятор векторизует.
+ * */
+typedef struct {
+    float coeffs[4];
+} poly_context_t;
+
+static void poly_batch(float const *args, float *values, size_t count, void *context) {
+    float const *c = ((poly_context_t *)context)->coeffs;
+    for (size_t idx = 0; idx != count; ++idx)
+        values[idx] = ((c[3] * args[idx] + c[2]) * args[idx] + c[1]) * args[idx] + c[0];
+}
+
+/**
+ * Аналог function_infile_tabulation_test: та же таблица синуса из 101 точки,
+ * но через движок. Затем проверка порядка: 10 миллионов точек g в тексте
+ * читаются обратно fscanf, аргументы должны возрастать, значения - совпадать с g.
+ * */
+void function_parallel_tabulation_test() {
+    tab_status_t status = tabulate("./sin_tab.txt",TAB_TEXT,"%f %e\n",sin_f,0.f,3.14159265f,101,4);
+    if (TAB_OK != status) {
+        print_tab_status(status);
+        return;
+    }
+    FILE *in_stream = fopen("./sin_tab.txt","r");
+    if (NULL == in_stream) {
+        printf("Can't open file to read!\n");
+        return;
+    }
+    float arg, val;
+    while (2 == fscanf(in_stream,"%f %e",&arg,&val))
+        printf("sin(%f) = %e\n",arg,val);
+    if (!feof(in_stream))
+        printf("File wasn't read to the end!\n");
+    fclose(in_stream);
+
+    size_t const count = 10000000u;
+    status = tabulate("./g_tab.txt",TAB_TEXT,"%.9g %.9g\n",g,-3.f,3.f,count,4);
+    if (TAB_OK != status) {
+        print_tab_status(status);
+        return;
+    }
+    in_stream = fopen("./g_tab.txt","r");
+    if (NULL == in_stream) {
+        printf("Can't open file to read!\n");
+        return;
+    }
+    size_t lines = 0, errors = 0;
+    float prev = -INFINITY;
+    while (2 == fscanf(in_stream,"%f %f",&arg,&val)) {
+        if (!(arg > prev) || val != g(arg))
+            ++errors;
+        prev = arg;
+        ++lines;
+    }
+    fclose(in_stream);
+    printf("%zu lines, %zu errors\n",lines,errors);
+}
+
+/**
+ * Скорость: последовательный fprintf, как в 42_files_ascii.c, и движок
+ * в один поток и во все ядра - текст и двоичная таблица, по точке и пакетом.
+ * Двоичные файлы скалярного и пакетного вариантов должны совпасть.
+ * */
+void tabulation_speed_test() {
+    size_t const count = 20000000u;
+    float const begin = -3.f, end = 3.f;
+    poly_context_t poly = {{-2.f, 0.f, 1.f, 0.f}}; //тот же многочлен x^2 - 2, что и g
+
+    double start = seconds_now();
+    FILE *out_stream = fopen("./g_tab.txt","w");
+    if (NULL == out_stream) {
+        printf("Can't open file to write!\n");
+        return;
+    }
+    for (size_t idx = 0; idx != count; ++idx) {
+        float arg = (float)(begin + ((double)end - begin) / (count - 1) * idx);
+        fprintf(out_stream,"%f %e\n",arg,g(arg));
+    }
+    bool failed = ferror(out_stream);
+    failed = 0 != fclose(out_stream) || failed;
+    if (failed) {
+        printf("File stream error!\n");
+        return;
+    }
+    printf("%-24s %6.1f M points/s\n","serial fprintf",count / (seconds_now() - start) / 1.e6);
+
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t threads[2] = {1, cores > 0 ? (size_t)cores : 1};
+    for (unsigned variant = 0; variant != 2; ++variant) {
+        start = seconds_now();
+        tab_status_t status = tabulate("./g_tab.txt",TAB_TEXT,"%f %e\n",g,begin,end,count,threads[variant]);
+        double text_seconds = seconds_now() - start;
+        start = seconds_now();
+        if (TAB_OK == status)
+            status = tabulate("./g_tab.bin",TAB_BINARY,NULL,g,begin,end,count,threads[variant]);
+        double scalar_seconds = seconds_now() - start;
+        start = seconds_now();
+        if (TAB_OK == status)
+            status = tabulate_batch("./g_tab_batch.bin",TAB_BINARY,NULL,poly_batch,&poly,begin,end,count,threads[variant]);
+        double batch_seconds = seconds_now() - start;
+        if (TAB_OK != status) {
+            print_tab_status(status);
+            return;
+        }
+        printf("%zu threads: text %6.1f, binary %6.1f, binary batch %6.1f M points/s\n",threads[variant],
+               count / text_seconds / 1.e6,count / scalar_seconds / 1.e6,count / batch_seconds / 1.e6);
+    }
+
+    FILE *a = fopen("./g_tab.bin","rb"), *b = fopen("./g_tab_batch.bin","rb");
+    if (NULL == a || NULL == b) {
+        printf("Can't open file to read!\n");
+        if (NULL != a) fclose(a);
+        if (NULL != b) fclose(b);
+        return;
+    }
+    int ca, cb;
+    do {
+        ca = fgetc(a);
+        cb = fgetc(b);
+    } while (ca == cb && EOF != ca);
+    printf("%s\n",ca == cb ? "binary tables are identical" : "BINARY TABLES DIFFER!");
+    fclose(b);
+    fclose(a);
+}
+
+int main() {
+    if (false) function_parallel_tabulation_test();
+    if (false) tabulation_speed_test();
+    return 0;
+}
@@ -0,0 +1,340 @@
+/**
+ * function_infile_tabulation_test (42_files_ascii.c) записывает таблицу синуса
+ * в sin_tab.txt, но никто её потом не использует. Между тем таблица - это
+ * классический способ ускорить дорогую функцию: вместо вызова sin
+ * значение берётся из таблицы и уточняется интерполяцией между соседними точками.
+ *
+ * Для равноотстоящих точек номер отрезка вычисляется без поиска:
+ * t = (x - begin) / step, i = (int)t, доля отрезка frac = t - i.
+ * 1) линейная интерполяция: v[i] + frac * (v[i+1] - v[i]),
+ *    ошибка порядка step^2 * max|f''| / 8;
+ * 2) кубическая (сплайн Катмулла-Рома) по четырём точкам v[i-1]..v[i+2],
+ *    ошибка порядка step^3 - при той же таблице на порядки точнее.
+ * Аргументы вне отрезка таблицы прижимаются к его краям функциями fminf/fmaxf,
+ * а номер отрезка - к последнему; компилятор делает из этого команды
+ * minss/maxss и cmov, так что ветвлений, которые процессор мог бы
+ * предсказать неверно, в вычислении нет.
+ * Пакетное вычисление использует AVX2: 8 аргументов за раз, значения из
+ * таблицы выбираются командой "gather" (_mm256_i32gather_ps) по вектору номеров.
+ *
+ * Насколько таблица заменяет функцию, зависит от допустимой ошибки,
+ * поэтому lut_max_error сравнивает таблицу с исходной функцией в большом числе точек.
+ *
+ * Компиляция:
+ * gcc 62_interpolated_lut.c -o lut -std=c99 -O2 -mavx2 -mfma -lm
+ * */
+
+#define _POSIX_C_SOURCE 200809L //clock_gettime
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>   //malloc realloc free rand
+#include <limits.h>   //INT_MAX
+#include <math.h>     //sin sinf fabs fminf fmaxf
+#include <time.h>     //clock_gettime
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+typedef enum {
+    LUT_LINEAR,
+    LUT_CUBIC
+} lut_method_t;
+
+/**
+ * Таблица: count значений на отрезке [begin, begin + (count - 1) * step].
+ * Перед values[0] и после values[count - 1] хранится по дополнительному
+ * значению (линейное продолжение), чтобы кубической интерполяции на крайних
+ * отрезках хватало соседей без проверок.
+ * */
+typedef struct {
+    lut_method_t method;
+    float begin, step, inv_step;
+    size_t count;
+    float *values;  //values[-1] .. values[count]
+} lut_t;
+
+/**
+ * Построение таблицы по массиву равноотстоящих значений (count >= 2).
+ * */
+bool lut_init(lut_t *lut, lut_method_t method, float begin, float end, float const *values, size_t count) {
+    *lut = (lut_t){method, begin, 0.f, 0.f, 0, NULL};
+    if (count < 2 || count > INT_MAX / 2 || !(end > begin))
+        return false;
+    float *data = malloc((count + 2) * sizeof(float));
+    if (NULL == data)
+        return false;
+    for (size_t idx = 0; idx != count; ++idx)
+        data[idx + 1] = values[idx];
+    data[0] = 2.f * values[0] - values[1];
+    data[count + 1] = 2.f * values[count - 1] - values[count - 2];
+    lut->step = (float)(((double)end - begin) / (double)(count - 1));
+    lut->inv_step = (float)((double)(count - 1) / ((double)end - begin));
+    lut->count = count;
+    lut->values = data + 1;
+    return true;
+}
+
+void lut_free(lut_t *lut) {
+    if (NULL != lut->values)
+        free(lut->values - 1);
+    *lut = (lut_t){lut->method, 0.f, 0.f, 0.f, 0, NULL};
+}
+
+/**
+ * Таблица функции f на count точках отрезка [begin, end].
+ * */
+bool lut_build(lut_t *lut, lut_method_t method, double (*f)(double), float begin, float end, size_t count) {
+    float *values = malloc((count > 0 ? count : 1) * sizeof(float));
+    if (NULL == values)
+        return false;
+    for (size_t idx = 0; idx != count; ++idx)
+        values[idx] = (float)f(begin + ((double)end - begin) * (double)idx / (double)(count - 1));
+    bool success = lut_init(lut,method,begin,end,values,count);
+    free(values);
+    return success;
+}
+
+/**
+ * Загрузка таблицы из текста в формате sin_tab.txt ("%f %e" в строке).
+ * Аргументы должны быть равноотстоящими: отклонение каждого аргумента
+ * от begin + idx * step допускается не больше 1% шага (текст "%f" округляет аргументы).
+ * */
+bool lut_load_text(lut_t *lut, lut_method_t method, char const *path) {
+    *lut = (lut_t){method, 0.f, 0.f, 0.f, 0, NULL};
+    FILE *in_stream = fopen(path,"r");
+    if (NULL == in_stream) {
+        printf("Can't open file to read!\n");
+        return false;
+    }
+    size_t count = 0, capacity = 1024;
+    double *args = malloc(capacity * sizeof(double));
+    float *values = malloc(capacity * sizeof(float));
+    bool success = false;
+    if (NULL == args || NULL == values) {
+        printf("Can't allocate memory!\n");
+        goto CLEAR;
+    }
+
+    double arg, val;
+    while (2 == fscanf(in_stream,"%lf %le",&arg,&val)) {
+        if (count == capacity) { //массивы растут вдвое, как в 33_dynamic_memory.c
+            capacity *= 2;
+            double *new_args = realloc(args,capacity * sizeof(double));
+            if (NULL == new_args) goto CLEAR;
+            args = new_args;
+            float *new_values = realloc(values,capacity * sizeof(float));
+            if (NULL == new_values) goto CLEAR;
+            values = new_values;
+        }
+        args[count] = arg;
+        values[count++] = (float)val;
+    }
+    if (!feof(in_stream) || count < 2) {
+        printf("Input format error!\n");
+        goto CLEAR;
+    }
+    double step = (args[count - 1] - args[0]) / (double)(count - 1);
+    for (size_t idx = 0; idx != count; ++idx)
+        if (!(fabs(args[idx] - (args[0] + step * (double)idx)) <= 0.01 * fabs(step))) {
+            printf("Arguments are not equally spaced!\n");
+            goto CLEAR;
+        }
+    success = lut_init(lut,method,(float)args[0],(float)args[count - 1],values,count);
+
+CLEAR:
+    free(values);
+    free(args);
+    fclose(in_stream);
+    return success;
+}
+
+/**
+ * Значение в точке x. Функция static inline, чтобы встраиваться в горячие циклы.
+ * */
+static inline float lut_eval(lut_t const *lut, float x) {
+    float t = fminf(fmaxf((x - lut->begin) * lut->inv_step,0.f),(float)(lut->count - 1));
+    int last = (int)lut->count - 2, idx = (int)t; //перевод float в int - одна команда, в size_t - несколько
+    idx = idx < last ? idx : last; //в x = end отрезок - последний, а frac = 1
+    float frac = t - (float)idx;
+    float const *v = lut->values + idx;
+    if (LUT_LINEAR == lut->method)
+        return v[0] + frac * (v[1] - v[0]);
+    //Катмулл-Ром: кубический многочлен по v[-1], v[0], v[1], v[2] в схеме Горнера
+    return v[0] + 0.5f * frac * (v[1] - v[-1] + frac * (2.f * v[-1] - 5.f * v[0] + 4.f * v[1] - v[2] +
+                                                    frac * (3.f * (v[0] - v[1]) + v[2] - v[-1])));
+}
+
+static void lut_eval_batch_scalar(lut_t const *lut, float const *x, float *y, size_t count) {
+    for (size_t idx = 0; idx != count; ++idx)
+        y[idx] = lut_eval(lut,x[idx]);
+}
+
+#if defined(__AVX2__)
+static void lut_eval_batch_avx2(lut_t const *lut, float const *x, float *y, size_t count) {
+    __m256 begin = _mm256_set1_ps(lut->begin), inv_step = _mm256_set1_ps(lut->inv_step);
+    __m256 zero = _mm256_setzero_ps(), t_max = _mm256_set1_ps((float)(lut->count - 1));
+    __m256i last = _mm256_set1_epi32((int)(lut->count - 2));
+    float const *v = lut->values;
+    size_t idx = 0;
+    for (; idx + 8 <= count; idx += 8) {
+        __m256 t = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(x + idx),begin),inv_step);
+        t = _mm256_min_ps(_mm256_max_ps(t,zero),t_max);
+        __m256i i = _mm256_min_epi32(_mm256_cvttps_epi32(t),last);
+        __m256 frac = _mm256_sub_ps(t,_mm256_cvtepi32_ps(i));
+        __m256 v0 = _mm256_i32gather_ps(v,i,4), v1 = _mm256_i32gather_ps(v + 1,i,4), r;
+        if (LUT_LINEAR == lut->method) {
+            r = _mm256_add_ps(v0,_mm256_mul_ps(frac,_mm256_sub_ps(v1,v0)));
+        } else {
+            __m256 vm = _mm256_i32gather_ps(v - 1,i,4), v2 = _mm256_i32gather_ps(v + 2,i,4);
+            __m256 c3 = _mm256_sub_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(3.f),_mm256_sub_ps(v0,v1)),v2),vm);
+            __m256 c2 = _mm256_sub_ps(_mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(_mm256_set1_ps(2.f),vm),
+                                                                  _mm256_mul_ps(_mm256_set1_ps(5.f),v0)),
+                                                    _mm256_mul_ps(_mm256_set1_ps(4.f),v1)),v2);
+            __m256 c1 = _mm256_sub_ps(v1,vm);
+            r = _mm256_add_ps(c2,_mm256_mul_ps(frac,c3));
+            r = _mm256_add_ps(c1,_mm256_mul_ps(frac,r));
+            r = _mm256_add_ps(v0,_mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f),frac),r));
+        }
+        _mm256_storeu_ps(y + idx,r);
+    }
+    lut_eval_batch_scalar(lut,x + idx,y + idx,count - idx);
+}
+#endif
+
+/**
+ * Значения в count точках x. Если программа собрана с -mavx2, работает векторный вариант.
+ * */
+void lut_eval_batch(lut_t const *lut, float const *x, float *y, size_t count) {
+#if defined(__AVX2__)
+    lut_eval_batch_avx2(lut,x,y,count);
+#else
+    lut_eval_batch_scalar(lut,x,y,count);
+#endif
+}
+
+/**
+ * Наибольшая абсолютная ошибка таблицы относительно f на samples равноотстоящих
+ * точках отрезка таблицы (samples много больше count, так что проверяются
+ * и узлы таблицы, и середины отрезков). *worst_x - точка наибольшей ошибки.
+ * */
+double lut_max_error(lut_t const *lut, double (*f)(double), size_t samples, float *worst_x) {
+    double max_error = 0.;
+    double end = lut->begin + (double)lut->step * (double)(lut->count - 1);
+    *worst_x = lut->begin;
+    for (size_t idx = 0; idx < samples; ++idx) {
+        float x = (float)(lut->begin + (end - lut->begin) * (double)idx / (double)(samples > 1 ? samples - 1 : 1));
+        double error = fabs(lut_eval(lut,x) - f(x));
+        if (error > max_error) {
+            max_error = error;
+            *worst_x = x;
+        }
+    }
+    return max_error;
+}
+
+double seconds_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec + ts.tv_nsec * 1.e-9;
+}
+
+/**
+ * sin_tab.txt из function_infile_tabulation_test (101 точка на [0, pi])
+ * загружается в таблицу с линейной и кубической интерполяцией.
+ * Ошибка кубической таблицы ограничена точностью текста: "%e" - 7 значащих цифр.
+ * */
+void lut_from_sin_tab_test() {
+    FILE *out_stream = fopen("./sin_tab.txt","w");
+    if (NULL == out_stream) {
+        printf("Can't open file to write!\n");
+        return;
+    }
+    float arg_begin = 0.f, step = 3.14159265f/100.f;
+    for (unsigned counter = 0; counter != 101; ++counter)
+        fprintf(out_stream,"%f %e\n",arg_begin + step*counter, sin(arg_begin + step*counter));
+    if (0 != fclose(out_stream)) {
+        printf("File stream error!\n");
+        return;
+    }
+
+    char const *names[2] = {"linear", "cubic"};
+    for (unsigned method = LUT_LINEAR; method <= LUT_CUBIC; ++method) {
+        lut_t lut;
+        if (!lut_load_text(&lut,(lut_method_t)method,"./sin_tab.txt"))
+            return;
+        float worst_x;
+        double error = lut_max_error(&lut,sin,1000000,&worst_x);
+        printf("%-6s: %zu points, max error %.3e at x = %f, sin(1) ~ %f\n",names[method],lut.count,error,worst_x,
+               lut_eval(&lut,1.f));
+        lut_free(&lut);
+    }
+}
+
+/**
+ * Замена sinf в горячем цикле: таблица из 4096 точек на [0, 2 pi].
+ * Сравниваются sinf, скалярное и пакетное вычисление по таблице;
+ * таблица используется, только если её ошибка не больше допустимой.
+ * */
+void lut_speed_test() {
+    size_t const count = 10000000u, table_size = 4096u;
+    double const tolerance = 1.e-6;
+    float *x = malloc(count * sizeof(float)), *y = malloc(count * sizeof(float));
+    if (NULL == x || NULL == y) {
+        printf("Can't allocate memory!\n");
+        goto CLEAR;
+    }
+    srand(62);
+    for (size_t idx = 0; idx != count; ++idx)
+        x[idx] = (float)rand() / RAND_MAX * 6.2831853f;
+
+    double start = seconds_now(), check = 0.;
+    for (size_t idx = 0; idx != count; ++idx)
+        y[idx] = sinf(x[idx]);
+    double sinf_seconds = seconds_now() - start;
+    for (size_t idx = 0; idx != count; ++idx)
+        check += y[idx];
+    printf("%-22s %7.1f M/s (sum %f)\n","sinf",count / sinf_seconds / 1.e6,check);
+
+    char const *names[2] = {"linear", "cubic"};
+    for (unsigned method = LUT_LINEAR; method <= LUT_CUBIC; ++method) {
+        lut_t lut;
+        if (!lut_build(&lut,(lut_method_t)method,sin,0.f,6.2831853f,table_size)) {
+            printf("Can't allocate memory!\n");
+            goto CLEAR;
+        }
+        float worst_x;
+        double error = lut_max_error(&lut,sin,1000000,&worst_x);
+
+        start = seconds_now();
+        for (size_t idx = 0; idx != count; ++idx)
+            y[idx] = lut_eval(&lut,x[idx]);
+        double scalar_seconds = seconds_now() - start;
+        double scalar_check = 0.;
+        for (size_t idx = 0; idx != count; ++idx)
+            scalar_check += y[idx];
+
+        start = seconds_now();
+        lut_eval_batch(&lut,x,y,count);
+        double batch_seconds = seconds_now() - start;
+        double batch_check = 0.;
+        for (size_t idx = 0; idx != count; ++idx)
+            batch_check += y[idx];
+
+        printf("%-6s max error %.2e: scalar %7.1f M/s, batch %7.1f M/s (sums %f %f), %s\n",names[method],error,
+               count / scalar_seconds / 1.e6,count / batch_seconds / 1.e6,scalar_check,batch_check,
+               error <= tolerance ? "can replace sinf" : "too inaccurate");
+        lut_free(&lut);
+    }
+
+CLEAR:
+    free(y);
+    free(x);
+}
+
+int main() {
+    if (false) lut_from_sin_tab_test();
+    if (false) lut_speed_test();
+    return 0;
+}
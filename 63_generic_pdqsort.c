@@ -0,0 +1,520 @@
+/**
+ * universal_bubble_sort (41_function_pointers.c) сортирует массив любого типа:
+ * ей передаются адрес массива, размер элемента в байтах, количество элементов
+ * и функция сравнения greater_than. Но пузырьковая сортировка делает O(N^2)
+ * сравнений, а uniswap переставляет элементы по одному байту.
+ *
+ * Напишем сортировку с тем же интерфейсом, но быстрой на любых данных:
+ * "быстрая сортировка, побеждающая шаблоны" (pattern-defeating quicksort, pdqsort).
+ * Это быстрая сортировка (Хоара) со следующими дополнениями:
+ * 1) короткие отрезки (меньше 24 элементов) досортировываются вставками -
+ *    на малых размерах они быстрее рекурсии;
+ * 2) опорный элемент - медиана трёх (первого, среднего, последнего), а на
+ *    больших отрезках "девятка Тьюки" (ninther) - медиана трёх медиан трёх:
+ *    на упорядоченных и "пилообразных" данных он близок к настоящей медиане;
+ * 3) если разбиение получилось сильно неравным (меньшая часть < 1/8 отрезка),
+ *    несколько элементов переставляются, чтобы сломать неудачный шаблон данных,
+ *    а после log2(N) таких разбиений отрезок сортируется пирамидальной
+ *    сортировкой (heapsort) - худший случай остаётся O(N log N), как в introsort;
+ * 4) если при разбиении ни один элемент не переставлялся, отрезок, возможно,
+ *    уже упорядочен - проверяем это вставками, прерываясь после 8 перемещений.
+ *    Поэтому упорядоченный массив сортируется за O(N);
+ * 5) если опорный элемент равен элементу перед отрезком (а тот - наибольший
+ *    из всех левее), все равные опорному собираются слева и больше не сортируются:
+ *    массив из k различных значений сортируется за O(N log k).
+ *
+ * Перестановка элементов для размеров 4 и 8 байт выполняется одним
+ * копированием через целое число, для остальных - блоками по 8 байт.
+ *
+ * Компиляция:
+ * gcc 63_generic_pdqsort.c -o pdqsort -std=c99 -O2
+ * */
+
+#define _POSIX_C_SOURCE 200809L //clock_gettime
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>   //malloc free qsort rand
+#include <stdint.h>   //uint32_t uint64_t
+#include <string.h>   //memcpy memcmp
+#include <time.h>     //clock_gettime
+
+#define PDQ_INSERTION_SORT 24u   //отрезки короче сортируются вставками
+#define PDQ_NINTHER 128u         //начиная с этой длины опорный элемент - девятка Тьюки
+#define PDQ_PARTIAL_MOVES 8u     //предел перемещений при проверке "почти упорядоченности"
+#define PDQ_STACK_ELEMENT 256u   //элементы до этого размера копируются через буфер на стеке
+
+typedef bool (*greater_than_t)(void const *, void const *);
+
+typedef struct {
+    unsigned char *base;
+    size_t size;
+    greater_than_t greater_than;
+    unsigned char *tmp;  //место для одного элемента
+} pdq_t;
+
+static inline unsigned char *elem(pdq_t const *s, size_t idx) {
+    return s->base + idx * s->size;
+}
+
+//a < b, если b > a: вся сортировка выражается через greater_than
+static inline bool less(pdq_t const *s, void const *a, void const *b) {
+    return s->greater_than(b,a);
+}
+
+static inline bool less_idx(pdq_t const *s, size_t a, size_t b) {
+    return s->greater_than(elem(s,b),elem(s,a));
+}
+
+//memcpy с постоянным размером компилятор заменяет одной командой, с переменным - вызывает функцию
+static inline void copy_elem(pdq_t const *s, void *dst, void const *src) {
+    if (4 == s->size) memcpy(dst,src,4);
+    else if (8 == s->size) memcpy(dst,src,8);
+    else memcpy(dst,src,s->size);
+}
+
+static inline void swap_idx(pdq_t const *s, size_t a, size_t b) {
+    unsigned char *pa = elem(s,a), *pb = elem(s,b);
+    if (4 == s->size) {
+        uint32_t ta, tb;
+        memcpy(&ta,pa,4); memcpy(&tb,pb,4);
+        memcpy(pa,&tb,4); memcpy(pb,&ta,4);
+    } else if (8 == s->size) {
+        uint64_t ta, tb;
+        memcpy(&ta,pa,8); memcpy(&tb,pb,8);
+        memcpy(pa,&tb,8); memcpy(pb,&ta,8);
+    } else {
+        size_t done = 0;
+        for (; done + 8 <= s->size; done += 8) {
+            uint64_t ta, tb;
+            memcpy(&ta,pa + done,8); memcpy(&tb,pb + done,8);
+            memcpy(pa + done,&tb,8); memcpy(pb + done,&ta,8);
+        }
+        for (; done != s->size; ++done) {
+            unsigned char t = pa[done];
+            pa[done] = pb[done];
+            pb[done] = t;
+        }
+    }
+}
+
+/**
+ * Сортировка вставками [begin, end). Если guarded == false, слева от begin
+ * лежит элемент, не больший любого в отрезке, и проверка j > begin не нужна.
+ * */
+static void insertion_sort(pdq_t const *s, size_t begin, size_t end, bool guarded) {
+    for (size_t cur = begin + 1; cur < end; ++cur) {
+        if (!less_idx(s,cur,cur - 1))
+            continue;
+        copy_elem(s,s->tmp,elem(s,cur));
+        size_t sift = cur;
+        do {
+            copy_elem(s,elem(s,sift),elem(s,sift - 1));
+            --sift;
+        } while ((!guarded || sift != begin) && less(s,s->tmp,elem(s,sift - 1)));
+        copy_elem(s,elem(s,sift),s->tmp);
+    }
+}
+
+/**
+ * Вставки с ограничением: false, если понадобилось больше PDQ_PARTIAL_MOVES
+ * перемещений (тогда отрезок не почти упорядочен и его сортирует основной алгоритм).
+ * */
+static bool partial_insertion_sort(pdq_t const *s, size_t begin, size_t end) {
+    size_t moves = 0;
+    for (size_t cur = begin + 1; cur < end; ++cur) {
+        if (!less_idx(s,cur,cur - 1))
+            continue;
+        copy_elem(s,s->tmp,elem(s,cur));
+        size_t sift = cur;
+        do {
+            copy_elem(s,elem(s,sift),elem(s,sift - 1));
+            --sift;
+        } while (sift != begin && less(s,s->tmp,elem(s,sift - 1)));
+        copy_elem(s,elem(s,sift),s->tmp);
+        moves += cur - sift;
+        if (moves > PDQ_PARTIAL_MOVES)
+            return false;
+    }
+    return true;
+}
+
+static void sort2(pdq_t const *s, size_t a, size_t b) {
+    if (less_idx(s,b,a)) swap_idx(s,a,b);
+}
+
+//медиана трёх оказывается в b
+static void sort3(pdq_t const *s, size_t a, size_t b, size_t c) {
+    sort2(s,a,b);
+    sort2(s,b,c);
+    sort2(s,a,b);
+}
+
+/**
+ * Пирамидальная сортировка [begin, end) - запасной вариант с гарантией O(N log N).
+ * */
+static void sift_down(pdq_t const *s, size_t begin, size_t root, size_t count) {
+    for (size_t child; (child = 2 * root + 1) < count; root = child) {
+        if (child + 1 < count && less_idx(s,begin + child,begin + child + 1))
+            ++child;
+        if (!less_idx(s,begin + root,begin + child))
+            return;
+        swap_idx(s,begin + root,begin + child);
+    }
+}
+
+static void heap_sort(pdq_t const *s, size_t begin, size_t end) {
+    size_t count = end - begin;
+    for (size_t root = count / 2; root != 0; --root)
+        sift_down(s,begin,root - 1,count);
+    for (size_t last = count - 1; last != 0; --last) {
+        swap_idx(s,begin,begin + last);
+        sift_down(s,begin,0,last);
+    }
+}
+
+/**
+ * Разбиение относительно опорного элемента в begin: меньшие - левее, остальные -
+ * правее. Возвращает итоговое место опорного. *already_partitioned - ни одной перестановки не понадобилось.
+ * Поиск с обеих сторон идёт без проверки границ: движение вправо останавливает
+ * элемент, не меньший опорного (при выборе медианы такой оказался в конце отрезка),
+ * движение влево - сам опорный элемент в begin.
+ * */
+static size_t partition_right(pdq_t const *s, size_t begin, size_t end, bool *already_partitioned) {
+    copy_elem(s,s->tmp,elem(s,begin));
+    size_t first = begin, last = end;
+    while (less(s,elem(s,++first),s->tmp));
+    if (first - 1 == begin)
+        while (first < last && !less(s,elem(s,--last),s->tmp));
+    else
+        while (!less(s,elem(s,--last),s->tmp));
+
+    *already_partitioned = first >= last;
+    while (first < last) {
+        swap_idx(s,first,last);
+        while (less(s,elem(s,++first),s->tmp));
+        while (!less(s,elem(s,--last),s->tmp));
+    }
+    size_t pivot_pos = first - 1;
+    copy_elem(s,elem(s,begin),elem(s,pivot_pos));
+    copy_elem(s,elem(s,pivot_pos),s->tmp);
+    return pivot_pos;
+}
+
+/**
+ * Разбиение, при котором равные опорному собираются слева.
+ * Вызывается, когда опорный равен элементу перед отрезком: тогда меньших
+ * опорного в отрезке нет, и левая часть - только равные ему.
+ * */
+static size_t partition_left(pdq_t const *s, size_t begin, size_t end) {
+    copy_elem(s,s->tmp,elem(s,begin));
+    size_t first = begin, last = end;
+    while (less(s,s->tmp,elem(s,--last)));
+    if (last + 1 == end)
+        while (first < last && !less(s,s->tmp,elem(s,++first)));
+    else
+        while (!less(s,s->tmp,elem(s,++first)));
+
+    while (first < last) {
+        swap_idx(s,first,last);
+        while (less(s,s->tmp,elem(s,--last)));
+        while (!less(s,s->tmp,elem(s,++first)));
+    }
+    copy_elem(s,elem(s,begin),elem(s,last));
+    copy_elem(s,elem(s,last),s->tmp);
+    return last;
+}
+
+/**
+ * Основной цикл. Рекурсия идёт в меньшую часть, большая обрабатывается
+ * в цикле - глубина рекурсии не больше log2(N).
+ * leftmost - отрезок начинается с начала массива (слева от него ничего нет).
+ * */
+static void pdq_loop(pdq_t const *s, size_t begin, size_t end, unsigned bad_allowed, bool leftmost) {
+    for (;;) {
+        size_t size = end - begin;
+        if (size < PDQ_INSERTION_SORT) {
+            insertion_sort(s,begin,end,leftmost);
+            return;
+        }
+
+        size_t half = size / 2;
+        if (size > PDQ_NINTHER) {
+            sort3(s,begin,begin + half,end - 1);
+            sort3(s,begin + 1,begin + half - 1,end - 2);
+            sort3(s,begin + 2,begin + half + 1,end - 3);
+            sort3(s,begin + half - 1,begin + half,begin + half + 1);
+            swap_idx(s,begin,begin + half);
+        } else {
+            sort3(s,begin + half,begin,end - 1);
+        }
+
+        if (!leftmost && !less_idx(s,begin - 1,begin)) {
+            begin = partition_left(s,begin,end) + 1;
+            continue;
+        }
+
+        bool already_partitioned;
+        size_t pivot_pos = partition_right(s,begin,end,&already_partitioned);
+        size_t l_size = pivot_pos - begin, r_size = end - (pivot_pos + 1);
+        if (l_size < size / 8 || r_size < size / 8) {
+            if (0 == --bad_allowed) {
+                heap_sort(s,begin,end);
+                return;
+            }
+            //перестановки ломают шаблон, из-за которого медиана оказалась плохой
+            if (l_size >= PDQ_INSERTION_SORT) {
+                swap_idx(s,begin,begin + l_size / 4);
+                swap_idx(s,pivot_pos - 1,pivot_pos - l_size / 4);
+                if (l_size > PDQ_NINTHER) {
+                    swap_idx(s,begin + 1,begin + (l_size / 4 + 1));
+                    swap_idx(s,begin + 2,begin + (l_size / 4 + 2));
+                    swap_idx(s,pivot_pos - 2,pivot_pos - (l_size / 4 + 1));
+                    swap_idx(s,pivot_pos - 3,pivot_pos - (l_size / 4 + 2));
+                }
+            }
+            if (r_size >= PDQ_INSERTION_SORT) {
+                swap_idx(s,pivot_pos + 1,pivot_pos + 1 + r_size / 4);
+                swap_idx(s,end - 1,end - r_size / 4);
+                if (r_size > PDQ_NINTHER) {
+                    swap_idx(s,pivot_pos + 2,pivot_pos + 2 + r_size / 4);
+                    swap_idx(s,pivot_pos + 3,pivot_pos + 3 + r_size / 4);
+                    swap_idx(s,end - 2,end - (1 + r_size / 4));
+                    swap_idx(s,end - 3,end - (2 + r_size / 4));
+                }
+            }
+        } else if (already_partitioned && partial_insertion_sort(s,begin,pivot_pos) &&
+                   partial_insertion_sort(s,pivot_pos + 1,end)) {
+            return;
+        }
+
+        if (l_size < r_size) {
+            pdq_loop(s,begin,pivot_pos,bad_allowed,leftmost);
+            begin = pivot_pos + 1;
+            leftmost = false;
+        } else {
+            pdq_loop(s,pivot_pos + 1,end,bad_allowed,false);
+            end = pivot_pos;
+        }
+    }
+}
+
+/**
+ * Замена universal_bubble_sort с тем же набором параметров.
+ * Сортировка неустойчивая: равные элементы могут поменяться местами.
+ * */
+void universal_quick_sort(void *arr, unsigned element_size, unsigned element_count, greater_than_t greater_than) {
+    if (element_count < 2 || 0 == element_size)
+        return;
+    unsigned char stack_tmp[PDQ_STACK_ELEMENT];
+    pdq_t s = {arr, element_size, greater_than, stack_tmp};
+    if (element_size > PDQ_STACK_ELEMENT) {
+        s.tmp = malloc(element_size);
+        if (NULL == s.tmp) { //без буфера обходимся перестановками
+            heap_sort(&s,0,element_count);
+            return;
+        }
+    }
+    unsigned bad_allowed = 1;
+    for (unsigned count = element_count; count > 1; count /= 2)
+        ++bad_allowed;
+    pdq_loop(&s,0,element_count,bad_allowed,true);
+    if (stack_tmp != s.tmp)
+        free(s.tmp);
+}
+
+/**
+ * Функции сравнения из 41_function_pointers.c.
+ * */
+bool int_greater_than(void const *a_ptr, void const *b_ptr) {
+    int const *a_int_ptr = a_ptr, *b_int_ptr = b_ptr;
+    return *a_int_ptr > *b_int_ptr;
+}
+
+bool double_greater_than(void const *a_ptr, void const *b_ptr) {
+    double const *a_double_ptr = a_ptr, *b_double_ptr = b_ptr;
+    return *a_double_ptr > *b_double_ptr;
+}
+
+int int_cmp(void const *lha, void const *rha) {
+    int const *int_l = lha, *int_r = rha;
+    if (*int_l < *int_r) return -1;
+    if (*int_l > *int_r) return 1;
+    return 0;
+}
+
+int double_cmp(void const *lha, void const *rha) {
+    double const *l = lha, *r = rha;
+    return (*l > *r) - (*l < *r);
+}
+
+void uniswap(void *a_ptr, void *b_ptr, unsigned byte_size) {
+    unsigned char *a_char = a_ptr, *b_char = b_ptr;
+    for (unsigned count = 0; count != byte_size; ++count) {
+        unsigned char tmp = *(a_char + count);
+        *(a_char + count) = *(b_char + count);
+        *(b_char + count) = tmp;
+    }
+}
+
+void universal_bubble_sort(void *arr, unsigned element_size, unsigned element_count, bool (*greater_than) (void const*, void const*)) {
+    unsigned char *arr_char = arr;
+    for (unsigned count = 0; count != element_count-1; ++count)
+        for (unsigned idx = 0; idx != element_count-1-count; ++idx)
+            if (greater_than(arr_char + idx * element_size, arr_char + (idx + 1) * element_size) )
+                uniswap(arr_char + idx * element_size, arr_char + (idx + 1) * element_size, element_size);
+}
+
+double seconds_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec + ts.tv_nsec * 1.e-9;
+}
+
+typedef enum {
+    PATTERN_RANDOM,
+    PATTERN_FEW_UNIQUE,  //rand()%100, как в new_file.txt
+    PATTERN_SORTED,
+    PATTERN_REVERSED,
+    PATTERN_ORGAN_PIPE,  //возрастание, затем убывание
+    PATTERN_COUNT
+} pattern_t;
+
+static char const *pattern_names[PATTERN_COUNT] = {"random", "rand()%100", "sorted", "reversed", "organ pipe"};
+
+static void fill_pattern(int *arr, size_t count, pattern_t pattern) {
+    for (size_t idx = 0; idx != count; ++idx) {
+        switch (pattern) {
+        case PATTERN_RANDOM: arr[idx] = (int)((unsigned)rand() << 16 ^ (unsigned)rand()); break;
+        case PATTERN_FEW_UNIQUE: arr[idx] = rand()%100; break;
+        case PATTERN_SORTED: arr[idx] = (int)idx; break;
+        case PATTERN_REVERSED: arr[idx] = (int)(count - idx); break;
+        default: arr[idx] = (int)(idx < count / 2 ? idx : count - idx); break;
+        }
+    }
+}
+
+/**
+ * Элемент размером 24 байта: проверка перестановки "блоками по 8 байт".
+ * */
+typedef struct {
+    double mass;
+    int id;
+    char name[12];
+} body_t;
+
+bool body_greater_than(void const *a_ptr, void const *b_ptr) {
+    body_t const *a = a_ptr, *b = b_ptr;
+    return a->mass > b->mass || (a->mass == b->mass && a->id > b->id);
+}
+
+int body_cmp(void const *lha, void const *rha) {
+    return body_greater_than(lha,rha) ? 1 : body_greater_than(rha,lha) ? -1 : 0;
+}
+
+/**
+ * Результат universal_quick_sort сравнивается с qsort на всех шаблонах
+ * и разных размерах (в том числе около порогов 24 и 128), для int, double и body_t.
+ * */
+void universal_quick_sort_test() {
+    size_t const max_count = 100000u;
+    int *a = malloc(max_count * sizeof(int)), *b = malloc(max_count * sizeof(int));
+    double *da = malloc(max_count * sizeof(double)), *db = malloc(max_count * sizeof(double));
+    body_t *ba = malloc(max_count * sizeof(body_t)), *bb = malloc(max_count * sizeof(body_t));
+    if (NULL == a || NULL == b || NULL == da || NULL == db || NULL == ba || NULL == bb) {
+        printf("Can't allocate memory!\n");
+        goto CLEAR;
+    }
+    srand(63);
+    size_t sizes[10] = {0, 1, 2, 23, 24, 25, 128, 129, 1000, max_count};
+    unsigned errors = 0;
+    for (unsigned pattern = 0; pattern != PATTERN_COUNT; ++pattern)
+        for (unsigned size_idx = 0; size_idx != 10; ++size_idx) {
+            size_t count = sizes[size_idx];
+            fill_pattern(a,count,(pattern_t)pattern);
+            for (size_t idx = 0; idx != count; ++idx) {
+                da[idx] = a[idx] / 7.;
+                ba[idx] = (body_t){a[idx] % 1000 / 10., (int)idx, "body"};
+            }
+            memcpy(b,a,count * sizeof(int));
+            memcpy(db,da,count * sizeof(double));
+            memcpy(bb,ba,count * sizeof(body_t));
+            universal_quick_sort(a,sizeof(int),(unsigned)count,int_greater_than);
+            qsort(b,count,sizeof(int),int_cmp);
+            universal_quick_sort(da,sizeof(double),(unsigned)count,double_greater_than);
+            qsort(db,count,sizeof(double),double_cmp);
+            universal_quick_sort(ba,sizeof(body_t),(unsigned)count,body_greater_than);
+            qsort(bb,count,sizeof(body_t),body_cmp);
+            if (0 != memcmp(a,b,count * sizeof(int)) || 0 != memcmp(da,db,count * sizeof(double)) ||
+                0 != memcmp(ba,bb,count * sizeof(body_t))) {
+                printf("%s, %zu elements: RESULTS DIFFER!\n",pattern_names[pattern],count);
+                ++errors;
+            }
+        }
+    printf("%u errors\n",errors);
+
+CLEAR:
+    free(bb);
+    free(ba);
+    free(db);
+    free(da);
+    free(b);
+    free(a);
+}
+
+/**
+ * Время сортировки массивов int от 10^3 до 10^8 элементов: universal_quick_sort
+ * с int_greater_than против qsort с int_cmp (обе вызывают сравнение через указатель).
+ * Короткие массивы сортируются многократно, чтобы время было измеримым.
+ * universal_bubble_sort - только на 10^3 элементов.
+ * */
+void universal_quick_sort_speed_test() {
+    size_t const max_count = 100000000u;
+    int *source = malloc(max_count * sizeof(int)), *work = malloc(max_count * sizeof(int));
+    if (NULL == source || NULL == work) {
+        printf("Can't allocate memory!\n");
+        goto CLEAR;
+    }
+    srand(23);
+    pattern_t patterns[3] = {PATTERN_RANDOM, PATTERN_FEW_UNIQUE, PATTERN_SORTED};
+    for (unsigned p = 0; p != 3; ++p) {
+        printf("%s:\n",pattern_names[patterns[p]]);
+        for (size_t count = 1000; count <= max_count; count *= 10) {
+            size_t repeats = 10000000u / count > 0 ? 10000000u / count : 1;
+            double seconds[2];
+            for (unsigned variant = 0; variant != 2; ++variant) {
+                srand(23);
+                double total = 0.;
+                for (size_t repeat = 0; repeat != repeats; ++repeat) {
+                    if (0 == repeat || PATTERN_SORTED != patterns[p])
+                        fill_pattern(source,count,patterns[p]);
+                    memcpy(work,source,count * sizeof(int));
+                    double start = seconds_now();
+                    if (0 == variant)
+                        universal_quick_sort(work,sizeof(int),(unsigned)count,int_greater_than);
+                    else
+                        qsort(work,count,sizeof(int),int_cmp);
+                    total += seconds_now() - start;
+                }
+                seconds[variant] = total / repeats;
+            }
+            printf("%10zu: pdqsort %10.3f ms, qsort %10.3f ms, x%.2f\n",count,seconds[0] * 1.e3,seconds[1] * 1.e3,
+                   seconds[1] / seconds[0]);
+        }
+    }
+
+    fill_pattern(source,1000,PATTERN_RANDOM);
+    double start = seconds_now();
+    universal_bubble_sort(source,sizeof(int),1000,int_greater_than);
+    printf("universal_bubble_sort, 1000 elements: %.3f ms\n",(seconds_now() - start) * 1.e3);
+
+CLEAR:
+    free(work);
+    free(source);
+}
+
+int main() {
+    if (false) universal_quick_sort_test();
+    if (false) universal_quick_sort_speed_test();
+    return 0;
+}
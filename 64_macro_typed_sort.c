@@ -0,0 +1,431 @@
+/**
+ * В 41_function_pointers.c функции int_bubble_sort и double_bubble_sort
+ * написаны дважды и отличаются только типом. universal_bubble_sort и
+ * universal_quick_sort (63_generic_pdqsort.c) избавляют от повторения, но
+ * платят за это: каждое сравнение - косвенный вызов функции по указателю,
+ * который компилятор не может встроить, а каждое перемещение элемента -
+ * копирование заранее неизвестного числа байт.
+ *
+ * Препроцессор позволяет получить и то и другое: код алгоритма пишется один раз
+ * внутри макроса, а макрос "штампует" отдельную функцию для каждого типа
+ * и выражения сравнения. Сравнение подставляется в код как обычное выражение,
+ * элементы копируются присваиванием - компилятор видит всё и оптимизирует так же,
+ * как сортировку, написанную вручную для int.
+ *
+ * Цена подхода: код каждого экземпляра занимает место в программе, ошибки в макросе
+ * компилятор показывает в строке его использования, а внутри макроса нельзя писать
+ * комментарии "//" - они закомментировали бы все следующие строки макроса,
+ * склеенные символом '\'.
+ *
+ * Компиляция:
+ * gcc 64_macro_typed_sort.c -o typed_sort -std=c99 -O2
+ * */
+
+#define _POSIX_C_SOURCE 200809L //clock_gettime
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>   //malloc free qsort rand
+#include <string.h>   //memcpy memcmp
+#include <time.h>     //clock_gettime
+
+/**
+ * Самый простой шаблон: пузырьковая сортировка из 41_function_pointers.c.
+ * DEFINE_BUBBLE_SORT(int_bubble_sort, int) создаёт функцию
+ * void int_bubble_sort(int *arr, unsigned size).
+ * */
+#define DEFINE_BUBBLE_SORT(NAME, TYPE) \
+void NAME(TYPE *arr, unsigned size) { \
+    for (unsigned count = 0; count + 1 < size; ++count) \
+        for (unsigned idx = 0; idx != size-1-count; ++idx) \
+            if (arr[idx] > arr[idx+1]) { \
+                TYPE tmp = arr[idx]; \
+                arr[idx] = arr[idx+1]; \
+                arr[idx+1] = tmp; \
+            } \
+}
+
+DEFINE_BUBBLE_SORT(int_bubble_sort, int)
+DEFINE_BUBBLE_SORT(double_bubble_sort, double)
+
+#define TYPED_INSERTION_SORT 24u
+#define TYPED_NINTHER 128u
+#define TYPED_PARTIAL_MOVES 8u
+
+/**
+ * Тот же алгоритм pdqsort, что и universal_quick_sort в 63_generic_pdqsort.c,
+ * но для массива TYPE и сравнения LESS(a, b) - макроса или функции,
+ * которая возвращает true, если a должен стоять раньше b.
+ * DEFINE_TYPED_SORT(int_sort, int, INT_LESS) создаёт функцию
+ * void int_sort(int *arr, size_t count) и вспомогательные функции
+ * с префиксом int_sort_.
+ * LESS может вычислять свои аргументы несколько раз (как BODY_LESS ниже),
+ * поэтому внутри шаблона аргументы LESS не содержат ++ и --.
+ * */
+#define DEFINE_TYPED_SORT(NAME, TYPE, LESS) \
+static inline void NAME##_swap(TYPE *arr, size_t a, size_t b) { \
+    TYPE tmp = arr[a]; \
+    arr[a] = arr[b]; \
+    arr[b] = tmp; \
+} \
+\
+static inline void NAME##_sort2(TYPE *arr, size_t a, size_t b) { \
+    if (LESS(arr[b], arr[a])) NAME##_swap(arr, a, b); \
+} \
+\
+static inline void NAME##_sort3(TYPE *arr, size_t a, size_t b, size_t c) { \
+    NAME##_sort2(arr, a, b); \
+    NAME##_sort2(arr, b, c); \
+    NAME##_sort2(arr, a, b); \
+} \
+\
+static void NAME##_insertion(TYPE *arr, size_t begin, size_t end, bool guarded) { \
+    for (size_t cur = begin + 1; cur < end; ++cur) { \
+        if (!LESS(arr[cur], arr[cur - 1])) \
+            continue; \
+        TYPE tmp = arr[cur]; \
+        size_t sift = cur; \
+        do { \
+            arr[sift] = arr[sift - 1]; \
+            --sift; \
+        } while ((!guarded || sift != begin) && LESS(tmp, arr[sift - 1])); \
+        arr[sift] = tmp; \
+    } \
+} \
+\
+static bool NAME##_partial_insertion(TYPE *arr, size_t begin, size_t end) { \
+    size_t moves = 0; \
+    for (size_t cur = begin + 1; cur < end; ++cur) { \
+        if (!LESS(arr[cur], arr[cur - 1])) \
+            continue; \
+        TYPE tmp = arr[cur]; \
+        size_t sift = cur; \
+        do { \
+            arr[sift] = arr[sift - 1]; \
+            --sift; \
+        } while (sift != begin && LESS(tmp, arr[sift - 1])); \
+        arr[sift] = tmp; \
+        moves += cur - sift; \
+        if (moves > TYPED_PARTIAL_MOVES) \
+            return false; \
+    } \
+    return true; \
+} \
+\
+static void NAME##_heap(TYPE *arr, size_t begin, size_t end) { \
+    TYPE *h = arr + begin; \
+    size_t count = end - begin; \
+    for (size_t start = count / 2; start-- != 0;) \
+        for (size_t root = start, child; (child = 2 * root + 1) < count; root = child) { \
+            if (child + 1 < count && LESS(h[child], h[child + 1])) ++child; \
+            if (!LESS(h[root], h[child])) break; \
+            NAME##_swap(h, root, child); \
+        } \
+    for (size_t last = count - 1; last != 0; --last) { \
+        NAME##_swap(h, 0, last); \
+        for (size_t root = 0, child; (child = 2 * root + 1) < last; root = child) { \
+            if (child + 1 < last && LESS(h[child], h[child + 1])) ++child; \
+            if (!LESS(h[root], h[child])) break; \
+            NAME##_swap(h, root, child); \
+        } \
+    } \
+} \
+\
+static size_t NAME##_partition_right(TYPE *arr, size_t begin, size_t end, bool *already_partitioned) { \
+    TYPE pivot = arr[begin]; \
+    size_t first = begin, last = end; \
+    do ++first; while (LESS(arr[first], pivot)); \
+    if (first - 1 == begin) \
+        do --last; while (first < last && !LESS(arr[last], pivot)); \
+    else \
+        do --last; while (!LESS(arr[last], pivot)); \
+    *already_partitioned = first >= last; \
+    while (first < last) { \
+        NAME##_swap(arr, first, last); \
+        do ++first; while (LESS(arr[first], pivot)); \
+        do --last; while (!LESS(arr[last], pivot)); \
+    } \
+    size_t pivot_pos = first - 1; \
+    arr[begin] = arr[pivot_pos]; \
+    arr[pivot_pos] = pivot; \
+    return pivot_pos; \
+} \
+\
+static size_t NAME##_partition_left(TYPE *arr, size_t begin, size_t end) { \
+    TYPE pivot = arr[begin]; \
+    size_t first = begin, last = end; \
+    do --last; while (LESS(pivot, arr[last])); \
+    if (last + 1 == end) \
+        do ++first; while (first < last && !LESS(pivot, arr[first])); \
+    else \
+        do ++first; while (!LESS(pivot, arr[first])); \
+    while (first < last) { \
+        NAME##_swap(arr, first, last); \
+        do --last; while (LESS(pivot, arr[last])); \
+        do ++first; while (!LESS(pivot, arr[first])); \
+    } \
+    arr[begin] = arr[last]; \
+    arr[last] = pivot; \
+    return last; \
+} \
+\
+static void NAME##_loop(TYPE *arr, size_t begin, size_t end, unsigned bad_allowed, bool leftmost) { \
+    for (;;) { \
+        size_t size = end - begin; \
+        if (size < TYPED_INSERTION_SORT) { \
+            NAME##_insertion(arr, begin, end, leftmost); \
+            return; \
+        } \
+        size_t half = size / 2; \
+        if (size > TYPED_NINTHER) { \
+            NAME##_sort3(arr, begin, begin + half, end - 1); \
+            NAME##_sort3(arr, begin + 1, begin + half - 1, end - 2); \
+            NAME##_sort3(arr, begin + 2, begin + half + 1, end - 3); \
+            NAME##_sort3(arr, begin + half - 1, begin + half, begin + half + 1); \
+            NAME##_swap(arr, begin, begin + half); \
+        } else { \
+            NAME##_sort3(arr, begin + half, begin, end - 1); \
+        } \
+        if (!leftmost && !LESS(arr[begin - 1], arr[begin])) { \
+            begin = NAME##_partition_left(arr, begin, end) + 1; \
+            continue; \
+        } \
+        bool already_partitioned; \
+        size_t pivot_pos = NAME##_partition_right(arr, begin, end, &already_partitioned); \
+        size_t l_size = pivot_pos - begin, r_size = end - (pivot_pos + 1); \
+        if (l_size < size / 8 || r_size < size / 8) { \
+            if (0 == --bad_allowed) { \
+                NAME##_heap(arr, begin, end); \
+                return; \
+            } \
+            if (l_size >= TYPED_INSERTION_SORT) { \
+                NAME##_swap(arr, begin, begin + l_size / 4); \
+                NAME##_swap(arr, pivot_pos - 1, pivot_pos - l_size / 4); \
+                if (l_size > TYPED_NINTHER) { \
+                    NAME##_swap(arr, begin + 1, begin + (l_size / 4 + 1)); \
+                    NAME##_swap(arr, begin + 2, begin + (l_size / 4 + 2)); \
+                    NAME##_swap(arr, pivot_pos - 2, pivot_pos - (l_size / 4 + 1)); \
+                    NAME##_swap(arr, pivot_pos - 3, pivot_pos - (l_size / 4 + 2)); \
+                } \
+            } \
+            if (r_size >= TYPED_INSERTION_SORT) { \
+                NAME##_swap(arr, pivot_pos + 1, pivot_pos + 1 + r_size / 4); \
+                NAME##_swap(arr, end - 1, end - r_size / 4); \
+                if (r_size > TYPED_NINTHER) { \
+                    NAME##_swap(arr, pivot_pos + 2, pivot_pos + 2 + r_size / 4); \
+                    NAME##_swap(arr, pivot_pos + 3, pivot_pos + 3 + r_size / 4); \
+                    NAME##_swap(arr, end - 2, end - (1 + r_size / 4)); \
+                    NAME##_swap(arr, end - 3, end - (2 + r_size / 4)); \
+                } \
+            } \
+        } else if (already_partitioned && NAME##_partial_insertion(arr, begin, pivot_pos) && \
+                   NAME##_partial_insertion(arr, pivot_pos + 1, end)) { \
+            return; \
+        } \
+        if (l_size < r_size) { \
+            NAME##_loop(arr, begin, pivot_pos, bad_allowed, leftmost); \
+            begin = pivot_pos + 1; \
+            leftmost = false; \
+        } else { \
+            NAME##_loop(arr, pivot_pos + 1, end, bad_allowed, false); \
+            end = pivot_pos; \
+        } \
+    } \
+} \
+\
+void NAME(TYPE *arr, size_t count) { \
+    if (count < 2) \
+        return; \
+    unsigned bad_allowed = 1; \
+    for (size_t n = count; n > 1; n /= 2) \
+        ++bad_allowed; \
+    NAME##_loop(arr, 0, count, bad_allowed, true); \
+}
+
+/**
+ * Экземпляры шаблона. Сравнение - макрос, поэтому подставляется как выражение.
+ * */
+#define INT_LESS(a, b) ((a) < (b))
+#define DOUBLE_LESS(a, b) ((a) < (b))
+
+DEFINE_TYPED_SORT(int_sort, int, INT_LESS)
+DEFINE_TYPED_SORT(double_sort, double, DOUBLE_LESS)
+
+/**
+ * Структура сортируется по массе, при равной массе - по номеру.
+ * Элемент копируется присваиванием структуры целиком.
+ * */
+typedef struct {
+    double mass;
+    int id;
+    char name[12];
+} body_t;
+
+#define BODY_LESS(a, b) ((a).mass < (b).mass || ((a).mass == (b).mass && (a).id < (b).id))
+
+DEFINE_TYPED_SORT(body_sort, body_t, BODY_LESS)
+
+/**
+ * Для сравнения - тот же алгоритм, но сравнение вызывается через указатель
+ * на функцию с сигнатурой int_greater_than из 41_function_pointers.c,
+ * как в universal_quick_sort. Перемещения элементов остаются типизированными,
+ * так что разница во времени - это цена именно косвенных вызовов.
+ * */
+bool int_greater_than(void const *a_ptr, void const *b_ptr) {
+    int const *a_int_ptr = a_ptr, *b_int_ptr = b_ptr;
+    return *a_int_ptr > *b_int_ptr;
+}
+
+bool (*int_greater_than_ptr)(void const *, void const *) = int_greater_than; //не static: компилятор не знает, что указатель не меняется
+
+#define INT_LESS_INDIRECT(a, b) int_greater_than_ptr(&(b), &(a))
+
+DEFINE_TYPED_SORT(int_sort_indirect, int, INT_LESS_INDIRECT)
+
+int int_cmp(void const *lha, void const *rha) {
+    int const *int_l = lha, *int_r = rha;
+    if (*int_l < *int_r) return -1;
+    if (*int_l > *int_r) return 1;
+    return 0;
+}
+
+int double_cmp(void const *lha, void const *rha) {
+    double const *l = lha, *r = rha;
+    return (*l > *r) - (*l < *r);
+}
+
+int body_cmp(void const *lha, void const *rha) {
+    body_t const *a = lha, *b = rha;
+    return BODY_LESS(*b, *a) - BODY_LESS(*a, *b);
+}
+
+double seconds_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec + ts.tv_nsec * 1.e-9;
+}
+
+/**
+ * Экземпляры шаблонов сравниваются с qsort: случайные данные, rand()%100,
+ * упорядоченные и обратные, размеры около порогов алгоритма.
+ * */
+void typed_sort_test() {
+    size_t const max_count = 100000u;
+    int *a = malloc(max_count * sizeof(int)), *b = malloc(max_count * sizeof(int));
+    double *da = malloc(max_count * sizeof(double)), *db = malloc(max_count * sizeof(double));
+    body_t *ba = malloc(max_count * sizeof(body_t)), *bb = malloc(max_count * sizeof(body_t));
+    if (NULL == a || NULL == b || NULL == da || NULL == db || NULL == ba || NULL == bb) {
+        printf("Can't allocate memory!\n");
+        goto CLEAR;
+    }
+
+    int arri[5] = {2, 3, 4, 1, -4};
+    double arrd[5] = {2.1, 2.3, -1.2, 0., 5.};
+    int_bubble_sort(arri,5);
+    double_bubble_sort(arrd,5);
+    for (unsigned idx = 0; idx != 5; ++idx)
+        printf("%d ",arri[idx]);
+    printf("\n");
+    for (unsigned idx = 0; idx != 5; ++idx)
+        printf("%f ",arrd[idx]);
+    printf("\n");
+
+    srand(64);
+    size_t sizes[9] = {0, 1, 2, 23, 24, 129, 1000, 10007, max_count};
+    unsigned errors = 0;
+    for (unsigned pattern = 0; pattern != 4; ++pattern)
+        for (unsigned size_idx = 0; size_idx != 9; ++size_idx) {
+            size_t count = sizes[size_idx];
+            for (size_t idx = 0; idx != count; ++idx) {
+                a[idx] = 0 == pattern ? (int)((unsigned)rand() << 16 ^ (unsigned)rand()) : 1 == pattern ? rand()%100 :
+                         2 == pattern ? (int)idx : (int)(count - idx);
+                da[idx] = a[idx] / 3.;
+                ba[idx] = (body_t){a[idx] % 100 / 10., (int)idx, "body"};
+            }
+            memcpy(b,a,count * sizeof(int));
+            memcpy(db,da,count * sizeof(double));
+            memcpy(bb,ba,count * sizeof(body_t));
+            int_sort(a,count);
+            qsort(b,count,sizeof(int),int_cmp);
+            bool same = 0 == memcmp(a,b,count * sizeof(int));
+            memcpy(a,b,count * sizeof(int)); //упорядоченный массив - ещё один случай
+            int_sort_indirect(a,count);
+            same = same && 0 == memcmp(a,b,count * sizeof(int));
+            double_sort(da,count);
+            qsort(db,count,sizeof(double),double_cmp);
+            body_sort(ba,count);
+            qsort(bb,count,sizeof(body_t),body_cmp);
+            if (!same || 0 != memcmp(da,db,count * sizeof(double)) || 0 != memcmp(ba,bb,count * sizeof(body_t))) {
+                printf("pattern %u, %zu elements: RESULTS DIFFER!\n",pattern,count);
+                ++errors;
+            }
+        }
+    printf("%u errors\n",errors);
+
+CLEAR:
+    free(bb);
+    free(ba);
+    free(db);
+    free(da);
+    free(b);
+    free(a);
+}
+
+/**
+ * Цена косвенного вызова: одинаковый алгоритм со встроенным сравнением
+ * и со сравнением через указатель, и qsort, на массивах int от 10^3 до 10^7.
+ * Для double - шаблон против qsort.
+ * */
+void typed_sort_speed_test() {
+    size_t const max_count = 10000000u;
+    int *source = malloc(max_count * sizeof(int)), *work = malloc(max_count * sizeof(int));
+    double *dsource = malloc(max_count * sizeof(double)), *dwork = malloc(max_count * sizeof(double));
+    if (NULL == source || NULL == work || NULL == dsource || NULL == dwork) {
+        printf("Can't allocate memory!\n");
+        goto CLEAR;
+    }
+    srand(23);
+    for (size_t idx = 0; idx != max_count; ++idx) {
+        source[idx] = (int)((unsigned)rand() << 16 ^ (unsigned)rand());
+        dsource[idx] = (double)rand() / RAND_MAX;
+    }
+
+    printf("%10s %13s %13s %13s %13s %13s\n","count","int inline","int pointer","int qsort","double inline","double qsort");
+    for (size_t count = 1000; count <= max_count; count *= 10) {
+        size_t repeats = 10000000u / count;
+        double seconds[5] = {0., 0., 0., 0., 0.};
+        for (unsigned variant = 0; variant != 5; ++variant)
+            for (size_t repeat = 0; repeat != repeats; ++repeat) {
+                size_t offset = (repeat * count) % (max_count - count + 1); //каждый повтор - другие данные
+                if (variant < 3)
+                    memcpy(work,source + offset,count * sizeof(int));
+                else
+                    memcpy(dwork,dsource + offset,count * sizeof(double));
+                double start = seconds_now();
+                switch (variant) {
+                case 0: int_sort(work,count); break;
+                case 1: int_sort_indirect(work,count); break;
+                case 2: qsort(work,count,sizeof(int),int_cmp); break;
+                case 3: double_sort(dwork,count); break;
+                default: qsort(dwork,count,sizeof(double),double_cmp); break;
+                }
+                seconds[variant] += seconds_now() - start;
+            }
+        printf("%10zu",count);
+        for (unsigned variant = 0; variant != 5; ++variant)
+            printf(" %10.2f ns",seconds[variant] / repeats / count * 1.e9); //время на один элемент
+        printf("\n");
+    }
+
+CLEAR:
+    free(dwork);
+    free(dsource);
+    free(work);
+    free(source);
+}
+
+int main() {
+    if (false) typed_sort_test();
+    if (false) typed_sort_speed_test();
+    return 0;
+}
@@ -0,0 +1,362 @@
+/**
+ * Сортировка массива широких записей (структур в десятки и сотни байт)
+ * напрямую перемещает записи при каждом обмене: qsort и universal_quick_sort
+ * делают O(N log N) перестановок, и каждая копирует запись целиком, а uniswap
+ * из 41_function_pointers.c к тому же копирует её по одному байту.
+ * Кроме того, каждое сравнение заново читает из записей поля, по которым сортируем.
+ *
+ * Косвенная сортировка разделяет эти две работы:
+ * 1) для каждой записи один раз вычисляется ключ (число double) и сохраняется
+ *    рядом с номером записи в массив пар "ключ, номер" по 16 байт;
+ * 2) сортируется массив пар - он компактный, сравнения читают ключ
+ *    без обращения к записям и встраиваются в код сортировки. При равных ключах
+ *    пары упорядочены по номеру, поэтому сортировка устойчива: равные записи
+ *    сохраняют исходный порядок;
+ * 3) номера из отсортированных пар - перестановка: order[i] - номер записи,
+ *    которая должна оказаться на месте i. Перестановка применяется к массиву
+ *    записей на месте, обходом циклов: запись из order[i] переносится на место i,
+ *    освободившееся место order[i] заполняется записью order[order[i]] и так далее,
+ *    пока цикл не замкнётся. Каждая запись перемещается ровно один раз,
+ *    плюс одно копирование во временный буфер на каждый цикл.
+ *
+ * Дополнительная память - 24 байта на запись (пара и элемент перестановки).
+ * apply_permutation можно использовать и отдельно, например чтобы упорядочить
+ * несколько массивов по одной перестановке.
+ *
+ * Компиляция:
+ * gcc 65_indirect_sort.c -o indirect_sort -std=c99 -O2
+ * */
+
+#define _POSIX_C_SOURCE 200809L //clock_gettime
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>   //malloc free qsort rand
+#include <string.h>   //memcpy memcmp
+#include <time.h>     //clock_gettime
+
+/**
+ * Функция, вычисляющая ключ сортировки по адресу записи.
+ * */
+typedef double (*sort_key_t)(void const *);
+
+typedef struct {
+    double key;
+    size_t index;
+} key_index_t;
+
+static inline bool key_index_less(key_index_t a, key_index_t b) {
+    return a.key < b.key || (a.key == b.key && a.index < b.index);
+}
+
+static inline void key_index_swap(key_index_t *a, key_index_t *b) {
+    key_index_t tmp = *a;
+    *a = *b;
+    *b = tmp;
+}
+
+static void key_index_heap_sort(key_index_t *arr, size_t count) {
+    for (size_t start = count / 2, last = count; last > 1;) {
+        size_t root;
+        if (start > 0)
+            root = --start; //построение пирамиды
+        else {
+            key_index_swap(arr,arr + --last); //наибольший - в конец
+            root = 0;
+        }
+        for (size_t child; (child = 2 * root + 1) < last; root = child) {
+            if (child + 1 < last && key_index_less(arr[child],arr[child + 1])) ++child;
+            if (!key_index_less(arr[root],arr[child])) break;
+            key_index_swap(arr + root,arr + child);
+        }
+    }
+}
+
+/**
+ * Пары сортируются своей быстрой сортировкой (introsort): сравнение
+ * встраивается в код, а не вызывается по указателю, как в qsort.
+ * Все пары различны (номера уникальны), поэтому разбиение Хоара
+ * с медианой трёх всегда делит отрезок на две непустые части.
+ * */
+static void key_index_sort(key_index_t *arr, size_t count, unsigned depth) {
+    while (count > 16) {
+        if (0 == depth--) {
+            key_index_heap_sort(arr,count);
+            return;
+        }
+        size_t mid = count / 2;
+        if (key_index_less(arr[mid],arr[0])) key_index_swap(arr + mid,arr);
+        if (key_index_less(arr[count - 1],arr[mid])) {
+            key_index_swap(arr + count - 1,arr + mid);
+            if (key_index_less(arr[mid],arr[0])) key_index_swap(arr + mid,arr);
+        }
+        key_index_t pivot = arr[mid];
+        size_t first = 0, last = count - 1;
+        for (;;) {
+            while (key_index_less(arr[first],pivot)) ++first;
+            while (key_index_less(pivot,arr[last])) --last;
+            if (first >= last) break;
+            key_index_swap(arr + first++,arr + last--);
+        }
+        size_t left = last + 1; //[0, left) не больше опорного, [left, count) не меньше
+        if (left < count - left) { //рекурсия в меньшую часть
+            key_index_sort(arr,left,depth);
+            arr += left;
+            count -= left;
+        } else {
+            key_index_sort(arr + left,count - left,depth);
+            count = left;
+        }
+    }
+    for (size_t cur = 1; cur < count; ++cur) {
+        key_index_t tmp = arr[cur];
+        size_t sift = cur;
+        for (; sift != 0 && key_index_less(tmp,arr[sift - 1]); --sift)
+            arr[sift] = arr[sift - 1];
+        arr[sift] = tmp;
+    }
+}
+
+/**
+ * Переставляет записи массива arr так, что на месте i оказывается запись,
+ * стоявшая на месте order[i]. order должен быть перестановкой чисел 0..count-1;
+ * после вызова order[i] == i.
+ * Возвращает false, если не удалось выделить буфер под одну запись.
+ * */
+bool apply_permutation(void *arr, size_t element_size, size_t count, size_t *order) {
+    unsigned char *records = arr;
+    unsigned char *tmp = malloc(element_size);
+    if (NULL == tmp) {
+        printf("Can't allocate memory!\n");
+        return false;
+    }
+    for (size_t start = 0; start != count; ++start) {
+        if (order[start] == start)
+            continue; //запись на месте или цикл уже обработан
+        memcpy(tmp,records + start * element_size,element_size);
+        size_t dst = start;
+        while (order[dst] != start) {
+            size_t src = order[dst];
+            memcpy(records + dst * element_size,records + src * element_size,element_size);
+            order[dst] = dst;
+            dst = src;
+        }
+        memcpy(records + dst * element_size,tmp,element_size);
+        order[dst] = dst;
+    }
+    free(tmp);
+    return true;
+}
+
+/**
+ * Устойчивая косвенная сортировка массива записей по возрастанию ключа key.
+ * key вызывается ровно один раз для каждой записи.
+ * Если order не NULL, в него (массив из count элементов) записывается
+ * порядок записей до перестановки: order[i] - исходный номер записи,
+ * оказавшейся на месте i. Возвращает false при нехватке памяти,
+ * массив arr при этом не меняется.
+ * */
+bool indirect_sort(void *arr, size_t element_size, size_t count, sort_key_t key, size_t *order) {
+    if (count < 2) {
+        if (NULL != order && 1 == count)
+            order[0] = 0;
+        return true;
+    }
+    unsigned char const *records = arr;
+    bool result = false;
+    key_index_t *pairs = malloc(count * sizeof(key_index_t));
+    size_t *perm = malloc(count * sizeof(size_t));
+    if (NULL == pairs || NULL == perm) {
+        printf("Can't allocate memory!\n");
+        goto CLEAR;
+    }
+    for (size_t idx = 0; idx != count; ++idx)
+        pairs[idx] = (key_index_t){key(records + idx * element_size), idx};
+    unsigned depth = 0;
+    for (size_t n = count; n > 1; n /= 2)
+        depth += 2;
+    key_index_sort(pairs,count,depth);
+    for (size_t idx = 0; idx != count; ++idx)
+        perm[idx] = pairs[idx].index;
+    if (NULL != order)
+        memcpy(order,perm,count * sizeof(size_t));
+    free(pairs);
+    pairs = NULL;
+    result = apply_permutation(arr,element_size,count,perm);
+
+CLEAR:
+    free(perm);
+    free(pairs);
+    return result;
+}
+
+/**
+ * Записи из 36_structures_gravity_force_example.c и 36_structures.c.
+ * */
+typedef struct _Body {
+    float x, y, m;
+} Body_t;
+
+struct rational_t {
+    int numerator, denominator;
+};
+
+double body_mass_key(void const *record) {
+    Body_t const *body = record;
+    return body->m;
+}
+
+double body_distance_key(void const *record) {
+    Body_t const *body = record;
+    return (double)body->x * body->x + (double)body->y * body->y; //квадрат расстояния до начала координат
+}
+
+double rational_key(void const *record) {
+    struct rational_t const *r = record;
+    return (double)r->numerator / r->denominator;
+}
+
+int body_mass_cmp(void const *lha, void const *rha) {
+    Body_t const *l = lha, *r = rha;
+    return (l->m > r->m) - (l->m < r->m);
+}
+
+int rational_cmp(void const *lha, void const *rha) {
+    struct rational_t const *l = lha, *r = rha;
+    long long lhs = (long long)l->numerator * r->denominator, rhs = (long long)r->numerator * l->denominator; //знаменатели положительны
+    return (lhs > rhs) - (lhs < rhs);
+}
+
+double seconds_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec + ts.tv_nsec * 1.e-9;
+}
+
+/**
+ * Рой тел сортируется по массе и по расстоянию, массив дробей - по значению.
+ * Проверяется, что ключи упорядочены, равные по ключу записи сохранили
+ * исходный порядок, а перестановка order указывает на исходные записи.
+ * */
+void indirect_sort_test() {
+    Body_t swarm[5] = { {-1.f, -0.5f, 1.f}, {1.f, -0.5f, 1.f}, {0.f, 1.f, 0.9f}, {3.f, 0.f, 0.1f}, {0.f, 0.f, 2.f} };
+    size_t order[5];
+    indirect_sort(swarm,sizeof(Body_t),5,body_mass_key,order);
+    for (unsigned idx = 0; idx != 5; ++idx)
+        printf("(%.1f, %.1f, m=%.1f) from %zu\n",swarm[idx].x,swarm[idx].y,swarm[idx].m,order[idx]);
+
+    struct rational_t fractions[6] = {{1,2}, {2,3}, {-1,4}, {3,6}, {5,7}, {0,1}};
+    indirect_sort(fractions,sizeof(struct rational_t),6,rational_key,NULL);
+    for (unsigned idx = 0; idx != 6; ++idx)
+        printf("%d/%d ",fractions[idx].numerator,fractions[idx].denominator);
+    printf("\n");
+
+    size_t const count = 1000000u;
+    Body_t *bodies = malloc(count * sizeof(Body_t)), *source = malloc(count * sizeof(Body_t));
+    size_t *big_order = malloc(count * sizeof(size_t));
+    struct rational_t *rationals = malloc(count * sizeof(struct rational_t));
+    if (NULL == bodies || NULL == source || NULL == big_order || NULL == rationals) {
+        printf("Can't allocate memory!\n");
+        goto CLEAR;
+    }
+    srand(65);
+    for (size_t idx = 0; idx != count; ++idx) {
+        source[idx] = (Body_t){(float)(rand() % 1000), (float)(rand() % 1000), (float)(rand() % 100)}; //много равных масс
+        rationals[idx] = (struct rational_t){rand() % 2001 - 1000, rand() % 1000 + 1};
+    }
+    unsigned errors = 0;
+    sort_key_t keys[2] = {body_mass_key, body_distance_key};
+    for (unsigned key_idx = 0; key_idx != 2; ++key_idx) {
+        memcpy(bodies,source,count * sizeof(Body_t));
+        if (!indirect_sort(bodies,sizeof(Body_t),count,keys[key_idx],big_order)) {
+            ++errors;
+            continue;
+        }
+        for (size_t idx = 0; idx != count; ++idx) {
+            bool same_record = 0 == memcmp(bodies + idx,source + big_order[idx],sizeof(Body_t));
+            bool ordered = 0 == idx || keys[key_idx](bodies + idx - 1) < keys[key_idx](bodies + idx) ||
+                           (keys[key_idx](bodies + idx - 1) == keys[key_idx](bodies + idx) && big_order[idx - 1] < big_order[idx]);
+            if (!same_record || !ordered) {
+                printf("key %u, position %zu: WRONG ORDER!\n",key_idx,idx);
+                ++errors;
+                break;
+            }
+        }
+    }
+    if (!indirect_sort(rationals,sizeof(struct rational_t),count,rational_key,NULL))
+        ++errors;
+    for (size_t idx = 1; idx < count; ++idx)
+        if (rational_cmp(rationals + idx - 1,rationals + idx) > 0) {
+            printf("rationals, position %zu: WRONG ORDER!\n",idx);
+            ++errors;
+            break;
+        }
+    printf("%u errors\n",errors);
+
+CLEAR:
+    free(rationals);
+    free(big_order);
+    free(source);
+    free(bodies);
+}
+
+/**
+ * Записи разной ширины с ключом double в начале: qsort по записям
+ * против косвенной сортировки. Объём массива для всех размеров одинаков.
+ * Записи по 16 байт не шире пары "ключ, номер" - для них косвенная сортировка
+ * только добавляет работы. Заметим, что qsort из glibc (до версии 2.37) для
+ * элементов больше 32 байт сама сортирует указатели на записи и переставляет
+ * их циклами, поэтому выигрыш на широких записях даёт в основном
+ * сохранённый ключ и встроенное сравнение.
+ * */
+double record_key(void const *record) {
+    double key;
+    memcpy(&key,record,sizeof(double));
+    return key;
+}
+
+int record_cmp(void const *lha, void const *rha) {
+    double l = record_key(lha), r = record_key(rha);
+    return (l > r) - (l < r);
+}
+
+void indirect_sort_speed_test() {
+    size_t const total_bytes = 256u << 20;
+    unsigned char *source = malloc(total_bytes), *work = malloc(total_bytes);
+    if (NULL == source || NULL == work) {
+        printf("Can't allocate memory!\n");
+        goto CLEAR;
+    }
+    srand(23);
+    for (size_t idx = 0; idx != total_bytes; ++idx)
+        source[idx] = (unsigned char)rand();
+
+    printf("%8s %10s %12s %12s\n","bytes","count","qsort, s","indirect, s");
+    for (size_t element_size = 16; element_size <= 1024; element_size *= 4) {
+        size_t count = total_bytes / element_size;
+        for (size_t idx = 0; idx != count; ++idx) {
+            double key = (double)rand() / RAND_MAX;
+            memcpy(source + idx * element_size,&key,sizeof(double));
+        }
+        memcpy(work,source,count * element_size);
+        double start = seconds_now();
+        qsort(work,count,element_size,record_cmp);
+        double qsort_seconds = seconds_now() - start;
+
+        memcpy(work,source,count * element_size);
+        start = seconds_now();
+        indirect_sort(work,element_size,count,record_key,NULL);
+        double indirect_seconds = seconds_now() - start;
+        printf("%8zu %10zu %12.3f %12.3f\n",element_size,count,qsort_seconds,indirect_seconds);
+    }
+
+CLEAR:
+    free(work);
+    free(source);
+}
+
+int main() {
+    if (false) indirect_sort_test();
+    if (false) indirect_sort_speed_test();
+    return 0;
+}
@@ -0,0 +1,488 @@
+/**
+ * Все сортировки до сих пор (28_array_sort.c, int_q_sort_test, universal_quick_sort)
+ * основаны на сравнениях и делают O(N log N) операций. Для целых чисел
+ * и чисел с плавающей точкой есть сортировка без сравнений - поразрядная
+ * (radix sort): ключ делится на цифры по 8 бит, и элементы раскладываются
+ * по 256 "корзинам" в соответствии со значением цифры.
+ *
+ * LSD (least significant digit) - от младшей цифры к старшей. Каждый проход:
+ * 1) гистограмма - сколько элементов попадает в каждую корзину;
+ * 2) префиксная сумма гистограммы - с какой позиции начинается каждая корзина;
+ * 3) раскладка элементов во второй массив по своим позициям.
+ * Раскладка устойчива (равные цифры сохраняют порядок предыдущего прохода),
+ * поэтому после прохода по старшей цифре массив упорядочен. Для 32-битных ключей
+ * 4 прохода, для 64-битных - 8, время O(N) независимо от данных.
+ * Если все элементы попали в одну корзину (например, у всех чисел старший
+ * байт нулевой), проход пропускается.
+ *
+ * Проходы распараллеливаются так же, как подсчёт в 59_line_offset_index.c:
+ * каждый поток строит гистограмму своего куска массива, затем по гистограммам
+ * вычисляется, куда каждый поток пишет элементы каждой корзины
+ * (корзина d: сначала элементы потока 0, затем потока 1 и т.д.), и потоки
+ * раскладывают свои куски независимо, не нарушая устойчивости.
+ *
+ * MSD (most significant digit) - от старшей цифры: массив раскладывается
+ * по корзинам старшей цифры на месте (American flag sort), и каждая корзина
+ * сортируется рекурсивно по следующей цифре, маленькие корзины - вставками.
+ * На неравномерных данных (много маленьких чисел, небольшие группы значений)
+ * рекурсия быстро доходит до маленьких корзин, и младшие цифры не просматриваются.
+ * Дополнительной памяти MSD не требует.
+ *
+ * Порядок беззнаковых чисел совпадает с порядком их битов. Чтобы сортировать
+ * другие типы, ключ преобразуется в беззнаковое число с тем же порядком:
+ * - int: инвертируется знаковый бит, -2^31 становится 0, а 2^31-1 - 2^32-1;
+ *   достаточно инвертировать старший бит старшей цифры при раскладке;
+ * - double (IEEE 754): у положительных чисел инвертируется знаковый бит,
+ *   у отрицательных - все биты (чем больше модуль отрицательного числа,
+ *   тем оно меньше). -0.0 оказывается перед +0.0, NaN - по краям массива.
+ *
+ * Компиляция:
+ * gcc 66_radix_sort.c -o radix_sort -std=c99 -O2 -pthread
+ * */
+
+#define _POSIX_C_SOURCE 200809L //clock_gettime
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>   //malloc free qsort rand
+#include <stdint.h>   //uint64_t
+#include <string.h>   //memcpy memset
+#include <time.h>     //clock_gettime
+#include <unistd.h>   //sysconf
+#include <pthread.h>  //pthread_create pthread_join
+
+#define RADIX_BITS 8u
+#define RADIX_BUCKETS (1u << RADIX_BITS)
+#define RADIX_MAX_THREADS 64u
+#define RADIX_MIN_CHUNK 65536u   //меньшие куски не стоят запуска потока
+#define MSD_INSERTION_SORT 32u
+
+/**
+ * Задание одного потока на одном проходе LSD: кусок [begin, end) массива src.
+ * counts - гистограмма куска, после префиксной суммы - позиции в dst,
+ * куда пишутся элементы каждой корзины.
+ * flip - маска, которой инвертируются биты цифры (знаковый бит для int).
+ * */
+typedef struct {
+    void const *src;
+    void *dst;
+    size_t begin, end;
+    unsigned key_bytes; //4 или 8
+    unsigned shift;
+    unsigned flip;
+    size_t counts[RADIX_BUCKETS];
+} radix_task_t;
+
+static void *radix_count_worker(void *arg) {
+    radix_task_t *task = arg;
+    memset(task->counts,0,sizeof(task->counts));
+    if (4 == task->key_bytes) {
+        unsigned const *src = task->src;
+        for (size_t idx = task->begin; idx != task->end; ++idx)
+            ++task->counts[((src[idx] >> task->shift) & (RADIX_BUCKETS - 1)) ^ task->flip];
+    } else {
+        uint64_t const *src = task->src;
+        for (size_t idx = task->begin; idx != task->end; ++idx)
+            ++task->counts[((src[idx] >> task->shift) & (RADIX_BUCKETS - 1)) ^ task->flip];
+    }
+    return NULL;
+}
+
+static void *radix_scatter_worker(void *arg) {
+    radix_task_t *task = arg;
+    size_t *pos = task->counts;
+    if (4 == task->key_bytes) {
+        unsigned const *src = task->src;
+        unsigned *dst = task->dst;
+        for (size_t idx = task->begin; idx != task->end; ++idx)
+            dst[pos[((src[idx] >> task->shift) & (RADIX_BUCKETS - 1)) ^ task->flip]++] = src[idx];
+    } else {
+        uint64_t const *src = task->src;
+        uint64_t *dst = task->dst;
+        for (size_t idx = task->begin; idx != task->end; ++idx)
+            dst[pos[((src[idx] >> task->shift) & (RADIX_BUCKETS - 1)) ^ task->flip]++] = src[idx];
+    }
+    return NULL;
+}
+
+/**
+ * Запуск worker в thread_count потоках, как в run_index_workers
+ * (59_line_offset_index.c): задание 0 выполняет вызывающий поток,
+ * а задания, для которых не удалось создать поток, - он же после остальных.
+ * */
+static void run_radix_workers(void *(*worker)(void *), radix_task_t *tasks, size_t thread_count) {
+    pthread_t threads[RADIX_MAX_THREADS];
+    size_t started = 1;
+    for (; started != thread_count; ++started)
+        if (0 != pthread_create(threads + started,NULL,worker,tasks + started))
+            break;
+    worker(tasks + 0);
+    for (size_t idx = 1; idx < started; ++idx)
+        pthread_join(threads[idx],NULL);
+    for (size_t idx = started; idx < thread_count; ++idx)
+        worker(tasks + idx);
+}
+
+/**
+ * LSD-сортировка ключей шириной key_bytes байт между буферами keys и tmp.
+ * signed_top - старшая цифра знаковая (int).
+ * Возвращает буфер с результатом: keys или tmp, в зависимости от числа
+ * выполненных (не пропущенных) проходов. NULL - нет памяти под задания.
+ * */
+static void *lsd_radix_sort(void *keys, void *tmp, size_t count, unsigned key_bytes, bool signed_top, unsigned threads) {
+    size_t thread_count = threads;
+    if (thread_count > RADIX_MAX_THREADS)
+        thread_count = RADIX_MAX_THREADS;
+    if (thread_count > count / RADIX_MIN_CHUNK)
+        thread_count = count / RADIX_MIN_CHUNK;
+    if (0 == thread_count)
+        thread_count = 1;
+    radix_task_t *tasks = malloc(thread_count * sizeof(radix_task_t));
+    if (NULL == tasks) {
+        printf("Can't allocate memory!\n");
+        return NULL;
+    }
+
+    void *src = keys, *dst = tmp;
+    unsigned const digits = key_bytes * 8 / RADIX_BITS;
+    for (unsigned digit = 0; digit != digits; ++digit) {
+        for (size_t t = 0; t != thread_count; ++t)
+            tasks[t] = (radix_task_t){src, dst, count * t / thread_count, count * (t + 1) / thread_count,
+                                      key_bytes, digit * RADIX_BITS,
+                                      signed_top && digit + 1 == digits ? RADIX_BUCKETS / 2 : 0, {0}};
+        run_radix_workers(radix_count_worker,tasks,thread_count);
+
+        //позиции: корзина за корзиной, внутри корзины - поток за потоком
+        size_t position = 0;
+        bool trivial = false;
+        for (unsigned bucket = 0; bucket != RADIX_BUCKETS; ++bucket) {
+            size_t bucket_size = 0;
+            for (size_t t = 0; t != thread_count; ++t) {
+                size_t thread_size = tasks[t].counts[bucket];
+                tasks[t].counts[bucket] = position;
+                position += thread_size;
+                bucket_size += thread_size;
+            }
+            trivial = trivial || bucket_size == count;
+        }
+        if (trivial)
+            continue; //все элементы в одной корзине: проход ничего не меняет
+        run_radix_workers(radix_scatter_worker,tasks,thread_count);
+        void *swap = src;
+        src = dst;
+        dst = swap;
+    }
+    free(tasks);
+    return src;
+}
+
+/**
+ * Поразрядная сортировка массивов unsigned и int в threads потоков.
+ * Нужен дополнительный буфер такого же размера, как массив.
+ * Возвращают false, если не хватило памяти; массив при этом не меняется.
+ * */
+static bool radix_sort_32(unsigned *arr, size_t count, bool is_signed, unsigned threads) {
+    if (count < 2)
+        return true;
+    unsigned *tmp = malloc(count * sizeof(unsigned));
+    if (NULL == tmp) {
+        printf("Can't allocate memory!\n");
+        return false;
+    }
+    unsigned *result = lsd_radix_sort(arr,tmp,count,sizeof(unsigned),is_signed,threads);
+    if (NULL != result && result != arr)
+        memcpy(arr,result,count * sizeof(unsigned));
+    free(tmp);
+    return NULL != result;
+}
+
+bool radix_sort_uint(unsigned *arr, size_t count, unsigned threads) {
+    return radix_sort_32(arr,count,false,threads);
+}
+
+bool radix_sort_int(int *arr, size_t count, unsigned threads) {
+    return radix_sort_32((unsigned *)arr,count,true,threads); //int и unsigned могут обращаться к одной памяти
+}
+
+/**
+ * Преобразование double в uint64_t с тем же порядком и обратно.
+ * */
+static inline uint64_t double_to_key(double value) {
+    uint64_t bits;
+    memcpy(&bits,&value,sizeof(bits));
+    uint64_t mask = ((uint64_t)0 - (bits >> 63)) | (uint64_t)1 << 63; //отрицательные - все биты, положительные - знаковый
+    return bits ^ mask;
+}
+
+static inline double key_to_double(uint64_t key) {
+    uint64_t mask = ((key >> 63) - 1) | (uint64_t)1 << 63; //старший бит ключа 1 - число было положительным
+    uint64_t bits = key ^ mask;
+    double value;
+    memcpy(&value,&bits,sizeof(value));
+    return value;
+}
+
+/**
+ * Поразрядная сортировка массива double в threads потоков.
+ * Ключи сортируются в отдельных буферах: нужно 16 байт дополнительной
+ * памяти на элемент. Возвращает false, если не хватило памяти.
+ * */
+bool radix_sort_double(double *arr, size_t count, unsigned threads) {
+    if (count < 2)
+        return true;
+    bool result = false;
+    uint64_t *keys = malloc(count * sizeof(uint64_t)), *tmp = malloc(count * sizeof(uint64_t));
+    if (NULL == keys || NULL == tmp) {
+        printf("Can't allocate memory!\n");
+        goto CLEAR;
+    }
+    for (size_t idx = 0; idx != count; ++idx)
+        keys[idx] = double_to_key(arr[idx]);
+    uint64_t const *sorted = lsd_radix_sort(keys,tmp,count,sizeof(uint64_t),false,threads);
+    if (NULL == sorted)
+        goto CLEAR;
+    for (size_t idx = 0; idx != count; ++idx)
+        arr[idx] = key_to_double(sorted[idx]);
+    result = true;
+
+CLEAR:
+    free(tmp);
+    free(keys);
+    return result;
+}
+
+/**
+ * MSD-сортировка на месте по цифре со сдвигом shift и всем младшим.
+ * flip инвертирует биты старшей цифры (для int) и сбрасывается при рекурсии.
+ * */
+static void msd_radix_sort(unsigned *arr, size_t count, unsigned shift, unsigned flip) {
+    size_t counts[RADIX_BUCKETS]; //гистограмма последней просмотренной цифры - по ней и раскладываем
+    for (;;) {
+        if (count < MSD_INSERTION_SORT) {
+            for (size_t cur = 1; cur < count; ++cur) {
+                unsigned tmp = arr[cur];
+                size_t sift = cur;
+                for (; sift != 0 && (arr[sift - 1] ^ flip << shift) > (tmp ^ flip << shift); --sift)
+                    arr[sift] = arr[sift - 1];
+                arr[sift] = tmp;
+            }
+            return;
+        }
+        memset(counts,0,sizeof(counts));
+        for (size_t idx = 0; idx != count; ++idx)
+            ++counts[((arr[idx] >> shift) & (RADIX_BUCKETS - 1)) ^ flip];
+        if (counts[((arr[0] >> shift) & (RADIX_BUCKETS - 1)) ^ flip] != count)
+            break;
+        if (0 == shift)
+            return; //все элементы равны
+        shift -= RADIX_BITS; //все в одной корзине: сразу к следующей цифре
+        flip = 0;
+    }
+
+    size_t next[RADIX_BUCKETS], end[RADIX_BUCKETS];
+    size_t position = 0;
+    for (unsigned bucket = 0; bucket != RADIX_BUCKETS; ++bucket) {
+        next[bucket] = position;
+        position += counts[bucket];
+        end[bucket] = position;
+    }
+    //каждый элемент переносится сразу в свою корзину, вытесненный - в свою и т.д.
+    for (unsigned bucket = 0; bucket != RADIX_BUCKETS; ++bucket)
+        while (next[bucket] != end[bucket]) {
+            unsigned value = arr[next[bucket]];
+            unsigned digit = ((value >> shift) & (RADIX_BUCKETS - 1)) ^ flip;
+            while (digit != bucket) {
+                unsigned displaced = arr[next[digit]];
+                arr[next[digit]++] = value;
+                value = displaced;
+                digit = ((value >> shift) & (RADIX_BUCKETS - 1)) ^ flip;
+            }
+            arr[next[bucket]++] = value;
+        }
+    if (0 == shift)
+        return;
+    for (unsigned bucket = 0, begin = 0; bucket != RADIX_BUCKETS; begin = end[bucket++])
+        if (end[bucket] - begin > 1)
+            msd_radix_sort(arr + begin,end[bucket] - begin,shift - RADIX_BITS,0);
+}
+
+void msd_radix_sort_uint(unsigned *arr, size_t count) {
+    msd_radix_sort(arr,count,32 - RADIX_BITS,0);
+}
+
+void msd_radix_sort_int(int *arr, size_t count) {
+    msd_radix_sort((unsigned *)arr,count,32 - RADIX_BITS,RADIX_BUCKETS / 2);
+}
+
+int int_cmp(void const *lha, void const *rha) {
+    int const *int_l = lha, *int_r = rha;
+    if (*int_l < *int_r) return -1;
+    if (*int_l > *int_r) return 1;
+    return 0;
+}
+
+int uint_cmp(void const *lha, void const *rha) {
+    unsigned const *l = lha, *r = rha;
+    return (*l > *r) - (*l < *r);
+}
+
+int double_cmp(void const *lha, void const *rha) {
+    double const *l = lha, *r = rha;
+    return (*l > *r) - (*l < *r);
+}
+
+double seconds_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec + ts.tv_nsec * 1.e-9;
+}
+
+/**
+ * Случайные 32 бита: rand() даёт только 31.
+ * */
+static unsigned rand32() {
+    return (unsigned)rand() << 16 ^ (unsigned)rand();
+}
+
+/**
+ * Неравномерные данные: модуль распределён по степенному закону,
+ * большинство чисел маленькие, но встречаются и очень большие.
+ * */
+static int skewed_int() {
+    unsigned magnitude = rand32() >> (rand() % 32);
+    return rand() % 2 ? (int)(magnitude >> 1) : -(int)(magnitude >> 1);
+}
+
+/**
+ * Результаты всех сортировок сравниваются с qsort на массивах разных размеров
+ * и распределений, с разным числом потоков.
+ * */
+void radix_sort_test() {
+    size_t const max_count = 1000000u;
+    int *a = malloc(max_count * sizeof(int)), *b = malloc(max_count * sizeof(int)), *sorted = malloc(max_count * sizeof(int));
+    double *da = malloc(max_count * sizeof(double)), *db = malloc(max_count * sizeof(double));
+    if (NULL == a || NULL == b || NULL == sorted || NULL == da || NULL == db) {
+        printf("Can't allocate memory!\n");
+        goto CLEAR;
+    }
+    srand(66);
+    size_t sizes[8] = {0, 1, 2, 31, 32, 1000, 140000, max_count};
+    unsigned thread_counts[3] = {1, 3, 8};
+    unsigned errors = 0;
+    for (unsigned pattern = 0; pattern != 4; ++pattern)
+        for (unsigned size_idx = 0; size_idx != 8; ++size_idx)
+            for (unsigned thread_idx = 0; thread_idx != 3; ++thread_idx) {
+                size_t count = sizes[size_idx];
+                unsigned threads = thread_counts[thread_idx];
+                for (size_t idx = 0; idx != count; ++idx) {
+                    a[idx] = 0 == pattern ? (int)rand32() : 1 == pattern ? rand() % 100 - 50 :
+                             2 == pattern ? skewed_int() : (int)idx;
+                    da[idx] = 0 == pattern ? (double)a[idx] * rand() / 7. : 1 == pattern ? a[idx] / 8. :
+                              2 == pattern ? 1. / a[idx] : -(double)idx; //в 2: 1/0 - бесконечность
+                }
+
+                memcpy(b,a,count * sizeof(int));
+                qsort(b,count,sizeof(int),int_cmp);
+                memcpy(sorted,a,count * sizeof(int));
+                bool same = radix_sort_int(sorted,count,threads) && 0 == memcmp(sorted,b,count * sizeof(int));
+                memcpy(sorted,a,count * sizeof(int));
+                msd_radix_sort_int(sorted,count);
+                same = same && 0 == memcmp(sorted,b,count * sizeof(int));
+                memcpy(b,a,count * sizeof(int));
+                qsort(b,count,sizeof(unsigned),uint_cmp);
+                memcpy(sorted,a,count * sizeof(int));
+                same = same && radix_sort_uint((unsigned *)sorted,count,threads) && 0 == memcmp(sorted,b,count * sizeof(int));
+                memcpy(sorted,a,count * sizeof(int));
+                msd_radix_sort_uint((unsigned *)sorted,count);
+                same = same && 0 == memcmp(sorted,b,count * sizeof(int));
+
+                memcpy(db,da,count * sizeof(double));
+                qsort(db,count,sizeof(double),double_cmp);
+                same = same && radix_sort_double(da,count,threads);
+                for (size_t idx = 0; idx != count; ++idx)
+                    same = same && da[idx] == db[idx]; //не memcmp: qsort не различает -0.0 и +0.0
+                if (!same) {
+                    printf("pattern %u, %zu elements, %u threads: RESULTS DIFFER!\n",pattern,count,threads);
+                    ++errors;
+                }
+            }
+
+    double special[6] = {0., -0., 1. / 0., -1. / 0., -1e-300, 1e-300};
+    radix_sort_double(special,6,1);
+    for (unsigned idx = 0; idx != 6; ++idx)
+        printf("%g ",special[idx]);
+    printf("\n%u errors\n",errors);
+
+CLEAR:
+    free(db);
+    free(da);
+    free(sorted);
+    free(b);
+    free(a);
+}
+
+/**
+ * Сравнение с qsort на 10^6..3*10^7 элементах: равномерные и неравномерные int,
+ * double. LSD - в одном потоке и во всех доступных.
+ * */
+void radix_sort_speed_test() {
+    size_t const max_count = 30000000u;
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned threads = cores > 0 ? (unsigned)cores : 1;
+    int *source = malloc(max_count * sizeof(int)), *work = malloc(max_count * sizeof(int));
+    double *dsource = malloc(max_count * sizeof(double)), *dwork = malloc(max_count * sizeof(double));
+    if (NULL == source || NULL == work || NULL == dsource || NULL == dwork) {
+        printf("Can't allocate memory!\n");
+        goto CLEAR;
+    }
+
+    printf("%u threads\n",threads);
+    printf("%10s %10s %10s %10s %10s %10s\n","count","data","qsort","LSD 1","LSD all","MSD");
+    for (size_t count = 1000000; count <= max_count; count = count < 10000000 ? count * 10 : count * 3) {
+        for (unsigned pattern = 0; pattern != 2; ++pattern) {
+            srand(23);
+            for (size_t idx = 0; idx != count; ++idx)
+                source[idx] = 0 == pattern ? (int)rand32() : skewed_int();
+            double seconds[4];
+            for (unsigned variant = 0; variant != 4; ++variant) {
+                memcpy(work,source,count * sizeof(int));
+                double start = seconds_now();
+                switch (variant) {
+                case 0: qsort(work,count,sizeof(int),int_cmp); break;
+                case 1: radix_sort_int(work,count,1); break;
+                case 2: radix_sort_int(work,count,threads); break;
+                default: msd_radix_sort_int(work,count); break;
+                }
+                seconds[variant] = seconds_now() - start;
+            }
+            printf("%10zu %10s %10.3f %10.3f %10.3f %10.3f\n",count,0 == pattern ? "int" : "skewed int",
+                   seconds[0],seconds[1],seconds[2],seconds[3]);
+        }
+
+        for (size_t idx = 0; idx != count; ++idx)
+            dsource[idx] = ((double)rand() / RAND_MAX - 0.5) * 1e6;
+        double seconds[3];
+        for (unsigned variant = 0; variant != 3; ++variant) {
+            memcpy(dwork,dsource,count * sizeof(double));
+            double start = seconds_now();
+            if (0 == variant)
+                qsort(dwork,count,sizeof(double),double_cmp);
+            else
+                radix_sort_double(dwork,count,1 == variant ? 1 : threads);
+            seconds[variant] = seconds_now() - start;
+        }
+        printf("%10zu %10s %10.3f %10.3f %10.3f %10s\n",count,"double",seconds[0],seconds[1],seconds[2],"-");
+    }
+
+CLEAR:
+    free(dwork);
+    free(dsource);
+    free(work);
+    free(source);
+}
+
+int main() {
+    if (false) radix_sort_test();
+    if (false) radix_sort_speed_test();
+    return 0;
+}
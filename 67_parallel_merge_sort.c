@@ -0,0 +1,308 @@
+/**
+ * Все сортировки в предыдущих уроках однопоточные. Для массивов из 10^8
+ * и более элементов используем все ядра: параллельная сортировка слиянием.
+ *
+ * 1) Массив делится на T кусков (T - число потоков), каждый поток сортирует
+ *    свой кусок: короткие отрезки по 32 элемента - вставками, затем
+ *    слияние отрезков попарно, пока кусок не станет упорядоченным.
+ * 2) Упорядоченные куски сливаются попарно за log2(T) проходов. Если на
+ *    каждом проходе сливать каждую пару в одном потоке, то на последнем
+ *    проходе работает один поток из T, на предпоследнем - два и т.д.
+ *    Поэтому результат каждого прохода (весь массив) делится на T равных
+ *    частей, и каждый поток пишет свою часть, даже если она лежит
+ *    внутри одного слияния.
+ *
+ * Как потоку узнать, какие элементы сливаемых отрезков A и B попадут
+ * в его часть результата [k0, k1)? Первые k элементов результата слияния
+ * состоят из первых i элементов A и первых j = k - i элементов B
+ * (co-rank, разбиение по "пути слияния", merge path). i находится двоичным
+ * поиском: это наименьшее i, при котором B[j-1] < A[i], то есть все
+ * оставшиеся в A элементы больше уже взятых из B. Поиск - O(log N),
+ * после него поток сливает A[i0, i1) и B[j0, j1) независимо от других.
+ * При равных элементах первыми идут элементы из A - сортировка устойчива.
+ *
+ * Нужен дополнительный буфер размером с массив: проходы слияния пишут
+ * попеременно в него и в исходный массив.
+ *
+ * Компиляция:
+ * gcc 67_parallel_merge_sort.c -o parallel_merge_sort -std=c99 -O2 -pthread
+ * */
+
+#define _POSIX_C_SOURCE 200809L //clock_gettime
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>   //malloc free qsort rand
+#include <string.h>   //memcpy memcmp
+#include <time.h>     //clock_gettime
+#include <unistd.h>   //sysconf
+#include <pthread.h>  //pthread_create pthread_join
+
+#define MERGE_MAX_THREADS 256u
+#define MERGE_MIN_CHUNK 16384u   //меньшие куски не стоят запуска потока
+#define MERGE_INSERTION_SORT 32u
+
+/**
+ * Задание одного потока.
+ * Сортировка кусков: кусок [begin, end) массива arr, tmp - буфер того же размера.
+ * Проход слияния: отрезки ширины width в src сливаются попарно в dst,
+ * поток пишет dst[begin, end).
+ * */
+typedef struct {
+    int *arr, *tmp;
+    int const *src;
+    int *dst;
+    size_t count;
+    size_t width;
+    size_t begin, end;
+} merge_task_t;
+
+/**
+ * Слияние a[0, a_count) и b[0, b_count) в dst, равные - сначала из a.
+ * */
+static void merge(int const *a, size_t a_count, int const *b, size_t b_count, int *dst) {
+    int const *a_end = a + a_count, *b_end = b + b_count;
+    while (a != a_end && b != b_end)
+        *dst++ = *b < *a ? *b++ : *a++;
+    memcpy(dst,a,(size_t)(a_end - a) * sizeof(int));
+    dst += a_end - a;
+    memcpy(dst,b,(size_t)(b_end - b) * sizeof(int));
+}
+
+/**
+ * Сколько элементов из a входит в первые k элементов слияния a и b.
+ * */
+static size_t co_rank(size_t k, int const *a, size_t a_count, int const *b, size_t b_count) {
+    size_t lo = k > b_count ? k - b_count : 0, hi = k < a_count ? k : a_count;
+    while (lo < hi) {
+        size_t i = lo + (hi - lo) / 2, j = k - i; //i < a_count, j > 0
+        if (b[j - 1] < a[i])
+            hi = i;
+        else
+            lo = i + 1;
+    }
+    return lo;
+}
+
+/**
+ * Однопоточная сортировка куска слиянием снизу вверх. Результат - в arr.
+ * */
+static void *chunk_sort_worker(void *arg) {
+    merge_task_t *task = arg;
+    int *src = task->arr + task->begin, *dst = task->tmp + task->begin;
+    size_t count = task->end - task->begin;
+    for (size_t run = 0; run < count; run += MERGE_INSERTION_SORT) {
+        size_t run_end = run + MERGE_INSERTION_SORT < count ? run + MERGE_INSERTION_SORT : count;
+        for (size_t cur = run + 1; cur < run_end; ++cur) {
+            int tmp = src[cur];
+            size_t sift = cur;
+            for (; sift != run && tmp < src[sift - 1]; --sift)
+                src[sift] = src[sift - 1];
+            src[sift] = tmp;
+        }
+    }
+    for (size_t width = MERGE_INSERTION_SORT; width < count; width *= 2) {
+        for (size_t left = 0; left < count; left += 2 * width) {
+            size_t mid = left + width < count ? left + width : count;
+            size_t right = mid + width < count ? mid + width : count;
+            merge(src + left,mid - left,src + mid,right - mid,dst + left);
+        }
+        int *swap = src;
+        src = dst;
+        dst = swap;
+    }
+    if (src != task->arr + task->begin)
+        memcpy(task->arr + task->begin,src,count * sizeof(int));
+    return NULL;
+}
+
+/**
+ * Часть [begin, end) одного прохода слияния. Часть может начинаться и
+ * заканчиваться внутри слияний и захватывать несколько слияний целиком.
+ * */
+static void *merge_pass_worker(void *arg) {
+    merge_task_t *task = arg;
+    size_t const count = task->count, width = task->width;
+    for (size_t pos = task->begin; pos < task->end;) {
+        size_t left = pos / (2 * width) * (2 * width);
+        size_t mid = left + width < count ? left + width : count;
+        size_t right = mid + width < count ? mid + width : count;
+        size_t part_end = task->end < right ? task->end : right;
+        int const *a = task->src + left, *b = task->src + mid;
+        size_t a_count = mid - left, b_count = right - mid;
+        size_t i0 = co_rank(pos - left,a,a_count,b,b_count), i1 = co_rank(part_end - left,a,a_count,b,b_count);
+        size_t j0 = pos - left - i0, j1 = part_end - left - i1;
+        merge(a + i0,i1 - i0,b + j0,j1 - j0,task->dst + pos);
+        pos = part_end;
+    }
+    return NULL;
+}
+
+/**
+ * Запуск worker в thread_count потоках, как в run_index_workers
+ * (59_line_offset_index.c).
+ * */
+static void run_merge_workers(void *(*worker)(void *), merge_task_t *tasks, pthread_t *threads, size_t thread_count) {
+    size_t started = 1;
+    for (; started != thread_count; ++started)
+        if (0 != pthread_create(threads + started,NULL,worker,tasks + started))
+            break;
+    worker(tasks + 0);
+    for (size_t idx = 1; idx < started; ++idx)
+        pthread_join(threads[idx],NULL);
+    for (size_t idx = started; idx < thread_count; ++idx)
+        worker(tasks + idx);
+}
+
+/**
+ * Устойчивая сортировка массива int по возрастанию в threads потоков.
+ * Возвращает false, если не хватило памяти; массив при этом не меняется.
+ * */
+bool parallel_merge_sort(int *arr, size_t count, unsigned threads) {
+    if (count < 2)
+        return true;
+    size_t thread_count = threads;
+    if (thread_count > MERGE_MAX_THREADS)
+        thread_count = MERGE_MAX_THREADS;
+    if (thread_count > count / MERGE_MIN_CHUNK)
+        thread_count = count / MERGE_MIN_CHUNK;
+    if (0 == thread_count)
+        thread_count = 1;
+
+    bool result = false;
+    int *tmp = malloc(count * sizeof(int));
+    merge_task_t *tasks = malloc(thread_count * sizeof(merge_task_t));
+    pthread_t *threads_id = malloc(thread_count * sizeof(pthread_t));
+    if (NULL == tmp || NULL == tasks || NULL == threads_id) {
+        printf("Can't allocate memory!\n");
+        goto CLEAR;
+    }
+
+    //куски одинаковой ширины (кроме последнего), чтобы проходы слияния шли по границам кусков
+    size_t const chunk = (count + thread_count - 1) / thread_count;
+    for (size_t t = 0; t != thread_count; ++t) {
+        size_t begin = t * chunk < count ? t * chunk : count;
+        size_t end = begin + chunk < count ? begin + chunk : count;
+        tasks[t] = (merge_task_t){arr, tmp, NULL, NULL, count, 0, begin, end};
+    }
+    run_merge_workers(chunk_sort_worker,tasks,threads_id,thread_count);
+
+    int *src = arr, *dst = tmp;
+    for (size_t width = chunk; width < count; width *= 2) {
+        for (size_t t = 0; t != thread_count; ++t)
+            tasks[t] = (merge_task_t){arr, tmp, src, dst, count, width, count * t / thread_count, count * (t + 1) / thread_count};
+        run_merge_workers(merge_pass_worker,tasks,threads_id,thread_count);
+        int *swap = src;
+        src = dst;
+        dst = swap;
+    }
+    if (src != arr)
+        memcpy(arr,src,count * sizeof(int));
+    result = true;
+
+CLEAR:
+    free(threads_id);
+    free(tasks);
+    free(tmp);
+    return result;
+}
+
+int int_cmp(void const *lha, void const *rha) {
+    int const *int_l = lha, *int_r = rha;
+    if (*int_l < *int_r) return -1;
+    if (*int_l > *int_r) return 1;
+    return 0;
+}
+
+double seconds_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec + ts.tv_nsec * 1.e-9;
+}
+
+/**
+ * Результат сравнивается с qsort для разных размеров, данных и числа потоков,
+ * в том числе для числа потоков, не являющегося степенью двойки.
+ * */
+void parallel_merge_sort_test() {
+    size_t const max_count = 2000000u;
+    int *a = malloc(max_count * sizeof(int)), *b = malloc(max_count * sizeof(int)), *c = malloc(max_count * sizeof(int));
+    if (NULL == a || NULL == b || NULL == c) {
+        printf("Can't allocate memory!\n");
+        goto CLEAR;
+    }
+    srand(67);
+    size_t sizes[8] = {0, 1, 2, 33, 16384, 100003, 1000000, max_count};
+    unsigned thread_counts[5] = {1, 2, 3, 7, 16};
+    unsigned errors = 0;
+    for (unsigned pattern = 0; pattern != 4; ++pattern)
+        for (unsigned size_idx = 0; size_idx != 8; ++size_idx) {
+            size_t count = sizes[size_idx];
+            for (size_t idx = 0; idx != count; ++idx)
+                a[idx] = 0 == pattern ? rand() - RAND_MAX / 2 : 1 == pattern ? rand() % 10 :
+                         2 == pattern ? (int)idx : (int)(count - idx);
+            memcpy(b,a,count * sizeof(int));
+            qsort(b,count,sizeof(int),int_cmp);
+            for (unsigned thread_idx = 0; thread_idx != 5; ++thread_idx) {
+                memcpy(c,a,count * sizeof(int));
+                if (!parallel_merge_sort(c,count,thread_counts[thread_idx]) || 0 != memcmp(b,c,count * sizeof(int))) {
+                    printf("pattern %u, %zu elements, %u threads: RESULTS DIFFER!\n",pattern,count,thread_counts[thread_idx]);
+                    ++errors;
+                }
+            }
+        }
+    printf("%u errors\n",errors);
+
+CLEAR:
+    free(c);
+    free(b);
+    free(a);
+}
+
+/**
+ * 10^8 случайных int: qsort и параллельная сортировка в 1, 2, 4, ...
+ * потоков до числа ядер. Ускорение считается относительно одного потока.
+ * */
+void parallel_merge_sort_speed_test() {
+    size_t const count = 100000000u;
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned cores = online > 0 ? (unsigned)online : 1;
+    int *source = malloc(count * sizeof(int)), *work = malloc(count * sizeof(int));
+    if (NULL == source || NULL == work) {
+        printf("Can't allocate memory!\n");
+        goto CLEAR;
+    }
+    srand(23);
+    for (size_t idx = 0; idx != count; ++idx)
+        source[idx] = rand();
+
+    memcpy(work,source,count * sizeof(int));
+    double start = seconds_now();
+    qsort(work,count,sizeof(int),int_cmp);
+    printf("qsort: %.3f s\n",seconds_now() - start);
+
+    double one_thread = 0.;
+    for (unsigned threads = 1;; threads *= 2) {
+        if (threads > cores)
+            threads = cores; //последний замер - на всех ядрах
+        memcpy(work,source,count * sizeof(int));
+        start = seconds_now();
+        parallel_merge_sort(work,count,threads);
+        double seconds = seconds_now() - start;
+        if (1 == threads)
+            one_thread = seconds;
+        printf("%3u threads: %.3f s, speedup %.2f\n",threads,seconds,one_thread / seconds);
+        if (threads == cores)
+            break;
+    }
+
+CLEAR:
+    free(work);
+    free(source);
+}
+
+int main() {
+    if (false) parallel_merge_sort_test();
+    if (false) parallel_merge_sort_speed_test();
+    return 0;
+}